@@ -191,8 +191,10 @@ typedef unsigned short mode_t;
 #endif /* FPTA_ENABLE_ABORT_ON_PANIC */
 
 #ifdef __cplusplus
-#include <array>  // for std::array
-#include <string> // for std::string
+#include <array>       // for std::array
+#include <string>      // for std::string
+#include <type_traits> // for std::remove_reference
+#include <utility>     // for std::forward
 
 extern "C" {
 #endif
@@ -915,11 +917,11 @@ typedef enum fpta_durability {
              * Достаточно быстрый режим, но с риском потери последних
              * изменений при аварии.
              *
-             * FIXME: Скорректировать описание после перехода на версию libmdbx
-             * с "догоняющей" фиксацией.
-             *
-             * Периодически формируются сильные точки фиксации. В случае
-             * системной аварии могут быть потеряны последние транзакции.
+             * Сильные точки фиксации формируются фоновым потоком согласно
+             * порогам flush_threshold и flush_period_ms, заданным
+             * в fpta_db_creation_params_ex, либо по запросу посредством
+             * fpta_db_wait_durable(). В случае системной аварии могут быть
+             * потеряны транзакции после последней сильной точки фиксации.
              *
              * Производительность по записи в основном определяется
              * скоростью диска, порядка 50K TPS для SSD. */
@@ -970,6 +972,11 @@ typedef enum fpta_regime_flags {
                     * повреждения вследствие некорректно использования
                     * указателей в коде приложения. */
   ,
+  fpta_shared_snapshot = 16 /* Транзакции чтения не привязываются к потокам
+                             * (MDBX_NOTLS). Позволяет разделять один
+                             * MVCC-снимок между несколькими потоками,
+                             * см fpta_transaction_share(). */
+  ,
 #ifdef FPTA_INTERNALS
   /* "Безумный" режим для работы юнит-тестов: Позволяет двойное открытие
        БД, неуклюжие индексы и т.п. */
@@ -978,6 +985,19 @@ typedef enum fpta_regime_flags {
 } fpta_regime_flags;
 FPT_ENUM_FLAG_OPERATORS(fpta_regime_flags)
 
+/* Функции пользовательского распределителя памяти, которые могут быть заданы
+ * в fpta_db_creation_params_ex для размещения служебных объектов (экземпляров
+ * транзакций и курсоров). Функция выделения должна возвращать блок памяти
+ * выравненный не менее чем на 16 байт, либо NULL при нехватке памяти.
+ * Функция освобождения получает размер блока, который был передан при его
+ * выделении. Аргумент ctx передается без изменений из
+ * fpta_db_creation_params_ex.
+ *
+ * Функции могут вызываться из любых потоков работающих с БД, в том числе
+ * конкурентно, поэтому они должны быть потокобезопасными. */
+typedef void *(fpta_alloc_func)(size_t bytes, void *ctx);
+typedef void(fpta_free_func)(void *ptr, size_t bytes, void *ctx);
+
 /* Структура аккумулирующая параметры требуемые для создания новой или
  * корректировки геометрии существующей БД. */
 typedef struct fpta_db_creation_params {
@@ -1055,6 +1075,50 @@ typedef struct fpta_db_creation_params {
       ;
 } fpta_db_creation_params_t;
 
+/* Расширенные параметры создания или открытия БД.
+ *
+ * Передаются в fpta_db_create_or_open() посредством указателя на поле base,
+ * в котором params_size должен быть равен sizeof(fpta_db_creation_params_ex).
+ * Приложения передающие только fpta_db_creation_params (с соответствующим
+ * params_size) продолжают работать без изменений, а для дополнительных
+ * параметров используются значения по умолчанию. */
+typedef struct fpta_db_creation_params_ex {
+  fpta_db_creation_params_t base;
+  fpta_alloc_func *alloc_func /* Опциональная функция выделения памяти для
+                                 пула транзакций и курсоров. Значение NULL
+                                 означает использование malloc(). */
+      ;
+  fpta_free_func *free_func /* Парная к alloc_func функция освобождения
+                               памяти. Должна быть задана одновременно
+                               с alloc_func, либо также быть NULL. */
+      ;
+  void *alloc_ctx /* Контекст передаваемый в alloc_func и free_func. */;
+  unsigned max_readers /* Размер таблицы читателей, т.е. максимальное
+                          количество одновременно работающих транзакций чтения
+                          во всех процессах использующих БД. Значение 0 означает
+                          "по умолчанию" (FPTA_DEFAULT_MAX_READERS). Размер
+                          таблицы определяется первым процессом открывающим БД
+                          и не может быть изменен пока БД используется. */
+      ;
+  size_t flush_threshold /* Объем (в байтах) несинхронизированных с диском
+                            изменений, по достижении которого фоновый поток
+                            формирует сильную точку фиксации. Используется
+                            только в режимах fpta_lazy и fpta_weak, значение 0
+                            отключает данный порог. */
+      ;
+  unsigned flush_period_ms /* Период (в миллисекундах) формирования сильных
+                              точек фиксации фоновым потоком при наличии
+                              несинхронизированных изменений. Используется
+                              только в режимах fpta_lazy и fpta_weak, значение
+                              0 отключает данный порог. Фоновый поток
+                              запускается если задан хотя-бы один из
+                              порогов. */
+      ;
+} fpta_db_creation_params_ex_t;
+
+/* Размер таблицы читателей по умолчанию. */
+#define FPTA_DEFAULT_MAX_READERS 42
+
 /* Информация о содержимом БД и/или создавшем её приложении. Позволяет задать
  * рамки совместимости содержимого БД и использующих её приложений.
  *
@@ -1150,6 +1214,119 @@ typedef struct fpta_db_stat {
 FPTA_API int fpta_db_info(const fpta_db *db, const fpta_txn *txn,
                           fpta_db_stat_t *stat);
 
+/* Возвращает в durable_version номер последней версии данных (см
+ * fpta_transaction_versions()), которая гарантированно сохранена на диске,
+ * т.е. переживет системную аварию.
+ *
+ * В режиме fpta_sync все зафиксированные версии являются "устойчивыми",
+ * а в режимах fpta_lazy и fpta_weak устойчивыми становятся версии
+ * до последней сильной точки фиксации.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_durable_version(fpta_db *db, uint64_t *durable_version);
+
+/* Ожидает пока версия данных db_version, полученная посредством
+ * fpta_transaction_versions() для пишущей транзакции, не станет устойчивой,
+ * т.е. не будет сохранена на диске.
+ *
+ * Если для БД запущен фоновый поток фиксации, то он формирует внеочередную
+ * сильную точку фиксации, а вызывающий поток ожидает её завершения. Иначе
+ * фиксация выполняется в контексте вызывающего потока. Таким образом,
+ * пишущие транзакции могут фиксироваться в "ленивом" режиме, а ожидать
+ * сохранения на диске только те, которым это необходимо.
+ *
+ * Потоки, ожидающие на момент вызова fpta_db_close(), будут освобождены
+ * после финальной фиксации фоновым потоком. Однако начинать ожидание
+ * параллельно с закрытием БД или после него нельзя.
+ *
+ * Возвращает ноль в случае успеха, FPTA_EINVAL если версия db_version ещё
+ * не зафиксирована, иначе код ошибки. */
+FPTA_API int fpta_db_wait_durable(fpta_db *db, uint64_t db_version);
+
+/* Информация о читателе, т.е. о транзакции удерживающей MVCC-снимок БД.
+ *
+ * Соответствует аргументам MDBX_reader_list_func и MDBX_hsr_func
+ * в API libmdbx. */
+typedef struct fpta_reader_info {
+  int slot; /* номер слота в таблице читателей, либо -1 если неизвестен */
+  intptr_t pid;   /* идентификатор процесса читателя */
+  uintptr_t tid;  /* идентификатор потока читателя */
+  uint64_t txnid; /* номер читаемого MVCC-снимка */
+  uint64_t lag; /* отставание от последней версии данных, т.е. количество
+                   зафиксированных транзакций после старта читателя */
+  uint64_t retained; /* объем (в байтах) страниц с устаревшими данными,
+                        которые читатель удерживает от повторного
+                        использования */
+} fpta_reader_info;
+
+/* Функция обратного вызова для перечисления читателей.
+ *
+ * Ненулевое значение прерывает перечисление и возвращается
+ * из fpta_db_readers(). */
+typedef int(fpta_reader_enum_func)(void *ctx, const fpta_reader_info *info);
+
+/* Перечисляет активные транзакции чтения всех процессов работающих с БД,
+ * вызывая для каждой из них функцию enum_func.
+ *
+ * Позволяет выявить "отстающих" читателей, которые удерживают старые
+ * MVCC-снимки и тем самым препятствуют повторному использованию страниц.
+ * При этом следует учитывать, что состояние читателей меняется асинхронно.
+ *
+ * В случае успеха возвращает ноль, FPTA_NODATA если активных читателей нет,
+ * результат enum_func если перечисление было прервано, иначе код ошибки. */
+FPTA_API int fpta_db_readers(fpta_db *db, fpta_reader_enum_func *enum_func,
+                             void *ctx);
+
+/* Действия над "отстающим" читателем, результат fpta_laggard_func.
+ *
+ * Соответствуют возвращаемым значениям MDBX_hsr_func в API libmdbx. */
+typedef enum fpta_laggard_action {
+  fpta_laggard_giveup = -1 /* Обработчик не смог решить проблему, БД будет
+                              увеличена либо пишущая транзакция получит
+                              ошибку FPTA_DB_FULL. */
+  ,
+  fpta_laggard_retry = 0 /* Читатель был уведомлен (например, о необходимости
+                            перезапуска транзакции) и/или обработчик подождал
+                            его реакции, таблицу читателей следует просмотреть
+                            повторно. */
+  ,
+  fpta_laggard_evicted = 1 /* Транзакция читателя прервана асинхронно и его
+                              слот следует немедленно освободить. Сама
+                              транзакция будет завершена читателем позже. */
+  ,
+  fpta_laggard_killed = 2 /* Процесс читателя завершен, его регистрацию
+                             следует полностью сбросить. */
+} fpta_laggard_action;
+
+/* Обработчик "отстающих" читателей.
+ *
+ * Вызывается в контексте пишущей транзакции, когда в БД не хватает места
+ * из-за читателя удерживающего старый MVCC-снимок (то есть перед
+ * увеличением размера БД или перед возвратом ошибки FPTA_DB_FULL).
+ * Аргумент retry содержит номер попытки начиная с 0. Если обработчик
+ * хотя-бы раз вернул fpta_laggard_retry, то по завершении цикла обработки
+ * он будет дополнительно вызван с отрицательным retry.
+ *
+ * Обработчик может уведомить читателя о необходимости перезапуска транзакции
+ * (см fpta_transaction_restart() и fpta_transaction_park()) и подождать,
+ * либо принудительно завершить читателя. Возвращаемое значение должно
+ * соответствовать выполненному действию, см fpta_laggard_action. */
+typedef fpta_laggard_action(fpta_laggard_func)(fpta_db *db,
+                                               const fpta_reader_info *laggard,
+                                               int retry, void *ctx);
+
+/* Устанавливает обработчик "отстающих" читателей, либо отключает его при
+ * нулевом laggard_func.
+ *
+ * Смена обработчика не синхронизируется с пишущими транзакциями, поэтому
+ * должна производиться при их отсутствии в текущем процессе (например,
+ * сразу после открытия БД).
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_set_laggard_handler(fpta_db *db,
+                                         fpta_laggard_func *laggard_func,
+                                         void *ctx);
+
 /* Открывает или создает базу по заданному пути в указанном durability режиме.
  *
  * Аргумент regime_flags задаёт дополнительные флаги для организации работы БД.
@@ -1157,11 +1334,13 @@ FPTA_API int fpta_db_info(const fpta_db *db, const fpta_txn *txn,
  *
  * Аргумент alterable_schema определяет намерения по созданию и/или
  * удалению таблиц в процессе работы. Обещание "не менять схему"
- * позволяет отказаться от захвата fpta_rwl_t в процессе работы.
+ * позволяет отказаться от регистрации читателей схемы в процессе работы.
  *
  * Аргумент creation_params используется при создании новой БД или корректировке
  * параметров геометрии уже существующей. При открытии существующей БД аргумент
- * creation_params может быть равен NULL.
+ * creation_params может быть равен NULL. Для задания дополнительных параметров
+ * creation_params должен указывать на поле base структуры
+ * fpta_db_creation_params_ex, см её описание.
  *
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
@@ -1178,7 +1357,7 @@ FPTA_API int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
  *
  * Аргумент alterable_schema определяет намерения по созданию и/или
  * удалению таблиц в процессе работы. Обещание "не менять схему"
- * позволяет отказаться от захвата fpta_rwl_t в процессе работы.
+ * позволяет отказаться от регистрации читателей схемы в процессе работы.
  *
  * В случае успеха возвращает ноль, иначе код ошибки. */
 static inline int fpta_db_open_existing(const fpta_appcontent_info *appcontent,
@@ -1314,7 +1493,9 @@ typedef enum fpta_level {
                    *
                    * Однако, транзакция изменения схемы также
                    * блокирует все читающие транзакции в рамках
-                   * своего процесса посредством fpta_rwl_t.
+                   * своего процесса: запускаемые читатели ожидают
+                   * её завершения, а она сама ожидает завершения
+                   * уже работающих читателей.
                    * Такая блокировка обусловлена двумя причинами:
                    *  - спецификой движков libmdbx/LMDB (удаление
                    *    таблицы приводит к закрытию её разделяемого
@@ -1328,8 +1509,8 @@ typedef enum fpta_level {
                    *
                    * С другой стороны, обещание не менять схему
                    * (указание alterable_schema = false) позволяет
-                   * экономить на захвате fpta_rwl_t при старте
-                   * читающих транзакций. */
+                   * экономить на регистрации читателей схемы при
+                   * старте и завершении транзакций. */
 } fpta_level;
 
 /* Инициация транзакции заданного уровня.
@@ -1355,6 +1536,85 @@ static __inline int fpta_transaction_abort(fpta_txn *txn) {
   return fpta_transaction_end(txn, true);
 }
 
+/* Создает точку сохранения внутри пишущей транзакции.
+ *
+ * Точка сохранения реализуется посредством вложенной транзакции libmdbx.
+ * Все последующие изменения в рамках txn могут быть отменены вызовом
+ * fpta_savepoint_rollback() без прерывания всей транзакции, либо приняты
+ * вызовом fpta_savepoint_release(). Точки сохранения могут быть вложенными,
+ * при этом откат или освобождение применяется к последней созданной.
+ * Незавершенные точки сохранения фиксируются или откатываются вместе
+ * с транзакцией в fpta_transaction_end().
+ *
+ * Если внутри точки сохранения возникает ошибка, которая в обычной ситуации
+ * приводит к прерыванию транзакции, то отменяются только изменения
+ * выполненные после создания точки сохранения, а сама она остается активной.
+ *
+ * Курсоры открытые до создания точки сохранения могут использоваться
+ * внутри неё. Курсоры открытые внутри точки сохранения остаются открытыми
+ * и после её освобождения, сохраняя свою позицию. При откате точки
+ * сохранения, в том числе неявном из-за ошибки, все открытые курсоры
+ * транзакции отменяются: последующие операции с ними возвращают
+ * FPTA_TXN_CANCELLED, а сами курсоры следует закрыть и при необходимости
+ * открыть заново.
+ *
+ * Текущая версия libmdbx не поддерживает вложенные транзакции в режиме
+ * MDBX_WRITEMAP, который используется для fpta_lazy и fpta_weak без
+ * опции fpta_saferam. В этом случае функция возвращает FPTA_ENOIMP.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_savepoint_begin(fpta_txn *txn);
+
+/* Откатывает изменения выполненные после создания последней точки
+ * сохранения и удаляет её.
+ *
+ * Все открытые курсоры транзакции отменяются, см fpta_savepoint_begin().
+ *
+ * Возвращает FPTA_EPERM если активных точек сохранения нет.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_savepoint_rollback(fpta_txn *txn);
+
+/* Удаляет последнюю точку сохранения, принимая выполненные после её
+ * создания изменения в состав объемлющей транзакции (или точки сохранения).
+ *
+ * Возвращает FPTA_EPERM если активных точек сохранения нет.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_savepoint_release(fpta_txn *txn);
+
+/* Функция-замыкание для групповой фиксации, см fpta_submit_write().
+ *
+ * Выполняет изменения данных в рамках переданной пишущей транзакции txn и
+ * возвращает ноль в случае успеха, иначе код ошибки. Функция не должна
+ * завершать транзакцию, а также не должна иметь побочных эффектов вне БД,
+ * так как при откате может быть вызвана повторно. */
+typedef int(fpta_write_func)(fpta_txn *txn, void *ctx);
+
+/* Выполняет изменения данных посредством групповой фиксации.
+ *
+ * Замыкания, одновременно переданные из нескольких потоков, собираются
+ * в группу и выполняются последовательно в рамках одной пишущей транзакции,
+ * которая затем фиксируется один раз. Таким образом, в режиме fpta_sync
+ * затраты на сброс данных на диск (fdatasync) разделяются между всеми
+ * участниками группы, что кратно увеличивает пропускную способность при
+ * большом количестве конкурирующих небольших транзакций.
+ *
+ * Замыкания выполняются в контексте одного из ожидающих потоков ("лидера"
+ * группы), поэтому не должны зависеть от текущего потока. Каждое замыкание
+ * выполняется внутри собственной точки сохранения (см fpta_savepoint_begin()),
+ * и если оно вернуло ошибку, то откатываются только его изменения. Когда точки
+ * сохранения недоступны (режим MDBX_WRITEMAP), при ошибке замыкания вся
+ * транзакция откатывается, а остальные замыкания группы выполняются повторно
+ * в новой транзакции. Поэтому неудачное замыкание не влияет на результат
+ * остальных, но может быть вызвано повторно любое из успешно выполненных.
+ *
+ * Функцию нельзя вызывать из потока, в котором есть незавершенная
+ * транзакция, а также из самих замыканий.
+ *
+ * Возвращает ноль если изменения замыкания успешно зафиксированы, ошибку
+ * вернутую замыканием, либо код ошибки старта или фиксации транзакции. */
+FPTA_API int fpta_submit_write(fpta_db *db, fpta_write_func *write_func,
+                               void *ctx);
+
 /* Возвращает отставание текущей читающей транзакции от самой свежей версии
  * данных, сформированной последней успешно завершенной пишущей транзакцией.
  *
@@ -1416,6 +1676,107 @@ FPTA_API int fpta_enough_for_restart(fpta_txn *txn, size_t lag_threshold,
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_transaction_restart(fpta_txn *txn);
 
+/* Включает режим управляемой сессии для транзакции чтения (и только чтения).
+ *
+ * В этом режиме транзакция самостоятельно перезапускается при превышении
+ * хотя-бы одного из заданных порогов, аналогичных fpta_enough_for_restart():
+ * отставания от последней зафиксированной версии данных (lag_threshold),
+ * объема удерживаемых от переработки страниц (retired_threshold), либо при
+ * уменьшении свободного места в БД ниже space_threshold. Нулевое значение
+ * отключает соответствующую проверку, а нулевые значения всех порогов
+ * выключают режим управляемой сессии.
+ *
+ * Проверка выполняется периодически при перемещении курсоров, а также
+ * явно посредством fpta_transaction_checkpoint(). При перезапуске все
+ * открытые в транзакции курсоры переустанавливаются на прежнюю позицию,
+ * т.е. на строку с тем же значением ключа (и первичного ключа для индексов
+ * с дубликатами). Если такая строка была удалена, то курсор устанавливается
+ * между соседними строками так, что следующее перемещение продолжит
+ * просмотр с прежнего места. Таким образом, долгий просмотр (например,
+ * экспорт данных) не удерживает старые MVCC-снимки и не приводит к росту
+ * БД, но видит изменения зафиксированные после очередного перезапуска.
+ *
+ * Переустанавливаются все открытые в транзакции курсоры, в том числе
+ * открытые до включения режима. Если при перезапуске выясняется изменение
+ * схемы, то все курсоры переводятся в ошибочное состояние, а перемещение
+ * курсора возвращает FPTA_SCHEMA_CHANGED. Управляемая сессия не может быть
+ * разделяемой (см fpta_transaction_share()) или припаркованной.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_transaction_autorestart(fpta_txn *txn, size_t lag_threshold,
+                                          size_t retired_threshold,
+                                          size_t space_threshold);
+
+/* Принудительно перезапускает управляемую сессию чтения, если она отстает
+ * от последней зафиксированной версии данных, с переустановкой курсоров
+ * как описано для fpta_transaction_autorestart().
+ *
+ * Возвращает FPTA_EPERM если режим управляемой сессии не включен.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_transaction_checkpoint(fpta_txn *txn);
+
+/* "Паркует" транзакцию чтения (и только чтения) для последующего повторного
+ * использования посредством fpta_transaction_resume().
+ *
+ * Функция освобождает читаемый MVCC-снимок и связанные с ним ресурсы,
+ * но сохраняет объект транзакции, закрепленный за ним слот читателя в таблице
+ * читателей libmdbx, а также кэш дескрипторов таблиц и схемы. Таким образом,
+ * припаркованная транзакция не препятствует переработке старых версий данных
+ * и не блокирует изменение схемы, а её возобновление обходится в разы дешевле
+ * пары вызовов fpta_transaction_end() и fpta_transaction_begin().
+ *
+ * Пока транзакция припаркована, для неё допустимы только вызовы
+ * fpta_transaction_resume() и fpta_transaction_end(). Все курсоры связанные
+ * с транзакцией должны быть закрыты до её парковки, иначе будет возвращена
+ * ошибка FPTA_EPERM.
+ *
+ * Так как слот читателя в libmdbx привязан к потоку, возобновлять и завершать
+ * припаркованную транзакцию следует в том же потоке, в котором она была
+ * запущена.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. При ошибке объект
+ * транзакции не разрушается и должен быть освобожден вызовом
+ * fpta_transaction_end(). */
+FPTA_API int fpta_transaction_park(fpta_txn *txn);
+
+/* Разрешает одновременное использование транзакции чтения (и только чтения)
+ * из нескольких потоков, например для параллельного выполнения запроса
+ * над одним согласованным MVCC-снимком.
+ *
+ * Требует открытия БД с опцией fpta_shared_snapshot, иначе возвращает
+ * FPTA_EFLAG. Разделяемая транзакция не может быть перезапущена или
+ * припаркована, а её снимок не меняется до завершения.
+ *
+ * Правила многопоточного использования:
+ *  - каждый поток использует только собственные курсоры, т.е. курсор
+ *    по-прежнему нельзя использовать одновременно из нескольких потоков;
+ *  - функции чтения (fpta_cursor_open(), fpta_get() и т.п.) можно вызывать
+ *    одновременно из разных потоков. Первое обращение к каждой таблице или
+ *    индексу внутри разделяемой транзакции выполняется под внутренней
+ *    блокировкой кэша dbi-хендлов, последующие - без блокировок;
+ *  - идентификаторы fpta_name изменяются при актуализации посредством
+ *    fpta_name_refresh() и fpta_name_refresh_couple(). Поэтому каждый поток
+ *    должен использовать собственные экземпляры fpta_name, либо общие
+ *    идентификаторы должны быть актуализированы в рамках разделяемой
+ *    транзакции до передачи другим потокам, после чего они используются
+ *    только для чтения;
+ *  - fpta_transaction_end() вызывается однократно из любого потока, после
+ *    закрытия всех курсоров и завершения работы остальных потоков.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_transaction_share(fpta_txn *txn);
+
+/* Возобновляет ранее припаркованную транзакцию чтения, т.е. обновляет её
+ * MVCC-снимок до самой свежей зафиксированной версии данных.
+ *
+ * Для возобновленной транзакции действуют все обычные правила, в том числе
+ * она может быть снова припаркована или перезапущена.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. При ошибке объект
+ * транзакции не разрушается и должен быть освобожден вызовом
+ * fpta_transaction_end(). */
+FPTA_API int fpta_transaction_resume(fpta_txn *txn);
+
 /* Получение версий схемы и данных.
  *
  * Для снимка базы (которая читается транзакцией)
@@ -2127,6 +2488,76 @@ FPTA_API int fpta_table_info_ex(fpta_txn *txn, fpta_name *table_id,
 FPTA_API int fpta_table_info(fpta_txn *txn, fpta_name *table_id,
                              size_t *row_count, fpta_table_stat *stat);
 
+/* Опции предварительного "прогрева" БД, см fpta_db_prewarm(). */
+typedef enum fpta_prewarm_flags {
+  fpta_prewarm_primary = 1 /* деревья первичных индексов, т.е. таблицы */,
+  fpta_prewarm_secondary = 2 /* деревья вторичных индексов */,
+  fpta_prewarm_rows = 4 /* дополнительно полностью читать строки таблиц,
+                           включая большие (вынужденно объединенные)
+                           страницы длинных записей */,
+  fpta_prewarm_default = fpta_prewarm_primary | fpta_prewarm_secondary
+} fpta_prewarm_flags;
+FPT_ENUM_FLAG_OPERATORS(fpta_prewarm_flags)
+
+/* Состояние "прогрева" БД, см fpta_db_prewarm_info(). */
+typedef struct fpta_prewarm_info {
+  size_t planned_bytes /* объем запланированный к прогреву с учетом бюджета */;
+  size_t warmed_bytes /* уже прогретый объем (оценка) */;
+  unsigned planned_trees /* количество запланированных деревьев индексов */;
+  unsigned warmed_trees /* количество обработанных деревьев индексов */;
+  int error /* результат, FPTA_TXN_CANCELLED если прогрев был прерван */;
+  bool running /* фоновый поток прогрева еще работает */;
+} fpta_prewarm_info;
+
+/* Запускает фоновый "прогрев" страниц таблиц и индексов.
+ *
+ * После перезапуска процесса страницы БД отображенные в память подгружаются
+ * по требованию, из-за чего задержки выполнения запросов могут быть
+ * многократно выше обычных до тех пор, пока рабочий набор страниц не окажется
+ * в памяти. Функция запускает фоновый поток, который в собственной транзакции
+ * чтения обходит деревья выбранных индексов и тем самым загружает их
+ * страницы (как не-листьевые, так и листьевые) в память.
+ *
+ * Аргументами table_ids и tables_count задаются таблицы для прогрева, либо
+ * все таблицы если table_ids равен nullptr. Идентификаторы таблиц должны
+ * быть инициализированы посредством fpta_table_init(), но после возврата
+ * из функции могут быть разрушены или использоваться без ограничений.
+ * Аргументом flags выбираются прогреваемые деревья, см fpta_prewarm_flags.
+ *
+ * Аргумент budget_bytes ограничивает суммарный прогреваемый объем, нулевое
+ * значение снимает ограничение. Объем каждого дерева оценивается по
+ * количеству страниц, аналогично fpta_table_info_ex(), а деревья обходятся
+ * в порядке перечисления таблиц (первичный индекс, затем вторичные) пока
+ * бюджет не будет исчерпан. Если прогреваются все таблицы и бюджет покрывает
+ * весь используемый объем файла БД, то дополнительно у ОС запрашивается
+ * упреждающее чтение файла.
+ *
+ * Обход выполняется в управляемой сессии (см fpta_transaction_autorestart()),
+ * поэтому не удерживает старые MVCC-снимки и не мешает изменению данных.
+ * Ход выполнения можно узнать посредством fpta_db_prewarm_info(), а дождаться
+ * завершения или прервать прогрев посредством fpta_db_prewarm_stop().
+ * Прогрев также прерывается при закрытии БД. Функции управления прогревом
+ * не должны вызываться одновременно из разных потоков.
+ *
+ * Возвращает FPTA_EBUSY если предыдущий прогрев еще не завершен.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_prewarm(fpta_db *db, fpta_name *const *table_ids,
+                             size_t tables_count, fpta_prewarm_flags flags,
+                             size_t budget_bytes);
+
+/* Возвращает состояние последнего запущенного прогрева БД.
+ *
+ * Возвращает FPTA_NODATA если прогрев не запускался.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_prewarm_info(fpta_db *db, fpta_prewarm_info *info);
+
+/* Дожидается завершения прогрева БД, либо прерывает его если аргумент
+ * cancel равен true.
+ *
+ * Возвращает FPTA_NODATA если прогрев не запускался, иначе результат
+ * прогрева, см fpta_prewarm_info.error. */
+FPTA_API int fpta_db_prewarm_stop(fpta_db *db, bool cancel);
+
 /* Возвращает общее количество колонок в таблице и отдельно количество
  * составных колонок.
  *
@@ -2361,6 +2792,10 @@ typedef enum fpta_filter_bits {
   fpta_node_ge = fptu_ge,
   fpta_node_eq = fptu_eq,
   fpta_node_ne = fptu_ne,
+
+  /* принадлежность значения колонки множеству значений (IN), узел
+   * формируется посредством fpta_filter_in_init() */
+  fpta_node_in = 16,
 } fpta_filter_bits;
 
 /* Фильтр, формируется пользователем как дерево из узлов-условий.
@@ -2415,6 +2850,14 @@ typedef struct fpta_filter {
       /* значение для сравнения */
       fpta_value right_value;
     } node_cmp;
+
+    /* параметры для условия принадлежности множеству (IN). */
+    struct {
+      /* идентификатор колонки */
+      fpta_name *left_id;
+      /* множество значений, см fpta_filter_in_init() */
+      struct fpta_value_set *set;
+    } node_in;
   };
 } fpta_filter;
 
@@ -2423,6 +2866,52 @@ typedef struct fpta_filter {
    Предполагается внутреннее использование, но функция также
    доступна извне. */
 FPTA_API bool fpta_filter_match(const fpta_filter *filter, fptu_ro tuple);
+
+/* Пакетная проверка n строк rows на соответствие условию фильтра.
+ *
+ * Результат помещается в битовую карту bitmap из (n + 63) / 64 слов:
+ * бит (i % 64) слова bitmap[i / 64] взводится, если строка rows[i]
+ * удовлетворяет фильтру, а неиспользуемые старшие биты последнего слова
+ * сбрасываются. Результат совпадает с построчным вызовом fpta_filter_match(),
+ * причем предикаты fpta_node_fncol и fpta_node_fnrow вызываются для тех же
+ * строк. Как и для fpta_filter_match(), идентификаторы колонок в фильтре
+ * должны быть актуализированы.
+ *
+ * Сравнения числовых колонок с числами выполняются сразу для пакета строк
+ * посредством векторных инструкций (SSE2/AVX2), выбираемых по возможностям
+ * процессора. Поэтому функция выгоднее построчной проверки для аналитических
+ * выборок по целочисленным колонкам и колонкам с плавающей точкой.
+ *
+ * Возвращает FPTA_SUCCESS (0) или код ошибки. */
+FPTA_API int fpta_filter_match_batch(const fpta_filter *filter,
+                                     const fptu_ro *rows, size_t n,
+                                     uint64_t *bitmap);
+
+/* Формирует в filter узел fpta_node_in с условием "значение колонки
+ * column_id равно одному из count значений values".
+ *
+ * Значения копируются во внутреннее представление множества: числа и даты
+ * размещаются в упорядоченных массивах для двоичного поиска, а строки
+ * и двоичные данные в хеш-таблице с открытой адресацией. Поэтому проверка
+ * строки выполняется за O(log n) или O(1), вместо перебора цепочки
+ * из count узлов fpta_node_eq, объединенных посредством fpta_node_or.
+ *
+ * Допускаются значения типов fpta_signed_int, fpta_unsigned_int,
+ * fpta_float_point, fpta_datetime, fpta_string и fpta_binary в любом
+ * сочетании, результат соответствует сравнению на равенство с каждым
+ * из них. Если ни одно из значений не сравнимо с типом колонки, то при
+ * открытии курсора условие заменяется на ложное, аналогично сравнениям.
+ *
+ * Множество принадлежит узлу и должно быть освобождено посредством
+ * fpta_filter_in_destroy(). В случае успеха возвращает ноль, иначе
+ * код ошибки. */
+FPTA_API int fpta_filter_in_init(fpta_filter *filter, fpta_name *column_id,
+                                 const fpta_value *values, size_t count);
+
+/* Освобождает множество значений узла, сформированного посредством
+ * fpta_filter_in_init(). В случае успеха возвращает ноль, иначе
+ * код ошибки. */
+FPTA_API int fpta_filter_in_destroy(fpta_filter *filter);
 #ifdef __cplusplus
 #define fpta_filter_any reinterpret_cast<fpta_filter *>(intptr_t(0))
 #define fpta_filter_none reinterpret_cast<fpta_filter *>(intptr_t(-1))
@@ -2472,6 +2961,41 @@ typedef enum fpta_cursor_options
      fpta_zeroed_range_is_point никак не влияет. */
   fpta_zeroed_range_is_point = 8,
 
+  /* Дополнительный флаг для курсоров "только по ключам" (покрывающий режим).
+     Такой курсор не обращается к строкам таблицы: значения ключевой колонки
+     и первичного ключа выбираются посредством fpta_cursor_get_keys()
+     непосредственно из индекса, без поиска строки по первичному ключу.
+     Соответственно, для такого курсора не допускается фильтр, а чтение строк
+     посредством fpta_cursor_get() и fpta_cursor_get_batch() не доступно. */
+  fpta_keys_only = 16,
+
+  /* Дополнительный флаг упреждающего чтения. Курсор отслеживает серии
+     последовательных переходов и, обнаружив такую серию, подсказывает ОС
+     посредством madvise(MADV_WILLNEED) о предстоящем чтении следующих
+     страниц БД. Это позволяет при просмотре "холодных" данных избежать
+     блокирующей page fault на каждой очередной странице.
+
+     Окно подсказки отсчитывается от адреса текущей позиции в файле БД,
+     поэтому полезно только для последовательно заполненных или
+     компактифицированных таблиц. В "состарившемся" дереве листья не
+     упорядочены в файле по ключам и подсказки порождают лишний ввод-вывод,
+     поэтому по-умолчанию они не выдаются.
+
+     Подсказки выдаются только в транзакциях чтения, так как в пишущих
+     транзакциях измененные страницы размещаются вне отображения БД в память.
+   */
+  fpta_readahead = 32,
+
+  /* Дополнительный флаг адаптивного упорядочивания условий фильтра. Курсор
+     подсчитывает для каждого условия частоту срабатывания и периодически
+     переставляет операнды узлов fpta_node_and и fpta_node_or так, чтобы
+     первыми проверялись дешевые и наиболее избирательные условия. Результат
+     выборки от этого не зависит, но функции-предикаты fpta_node_fncol и
+     fpta_node_fnrow могут вызываться в ином порядке и количестве, поэтому
+     не должны иметь побочных эффектов. Текущая перестановка доступна
+     посредством fpta_cursor_info(). */
+  fpta_adaptive_filter = 128,
+
   fpta_unsorted_dont_fetch = fpta_unsorted | fpta_dont_fetch,
   fpta_ascending_dont_fetch = fpta_ascending | fpta_dont_fetch,
   fpta_descending_dont_fetch = fpta_descending | fpta_dont_fetch,
@@ -2553,6 +3077,38 @@ FPTA_API int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id,
                               fpta_value range_from, fpta_value range_to,
                               fpta_filter *filter, fpta_cursor_options options,
                               fpta_cursor **cursor);
+
+/* Диапазон значений ключевой колонки для fpta_cursor_open_ranges(). */
+typedef struct fpta_range {
+  fpta_value from, to;
+} fpta_range;
+
+/* Открывает курсор для выборки из объединения нескольких диапазонов
+ * значений одной ключевой колонки, например для условия "value IN (...)".
+ *
+ * Каждый элемент ranges интерпретируется аналогично паре аргументов
+ * range_from и range_to функции fpta_cursor_open(), с тем ограничением, что
+ * псевдо-тип fpta_epsilon может сочетаться только с явным значением.
+ * Все остальные аргументы аналогичны fpta_cursor_open().
+ *
+ * При открытии диапазоны нормализуются: пустые отбрасываются, остальные
+ * упорядочиваются по значению ключа, а пересекающиеся и смежные
+ * объединяются. Поэтому каждая строка попадает в выборку не более одного
+ * раза, а порядок строк соответствует заданному в options, как если бы
+ * выборка производилась из одного диапазона. Переход между диапазонами
+ * выполняется одним позиционированием индекса, т.е. без просмотра строк
+ * в промежутках между ними.
+ *
+ * Для неупорядоченных индексов допускаются только точечные диапазоны
+ * (значение в паре с fpta_epsilon, либо равные значения при установленном
+ * флажке fpta_zeroed_range_is_point), а также диапазон fpta_begin..fpta_end.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_cursor_open_ranges(fpta_txn *txn, fpta_name *column_id,
+                                     const fpta_range *ranges,
+                                     size_t ranges_count, fpta_filter *filter,
+                                     fpta_cursor_options options,
+                                     fpta_cursor **cursor);
 FPTA_API int fpta_cursor_close(fpta_cursor *cursor);
 
 /* Структура для оценки размера выборки посредством функции fpta_estimate(). */
@@ -2699,6 +3255,17 @@ typedef struct fpta_cursor_stat {
              поиска и переходов по индексам. Значение формируется в десятых
              долях "двоичного" процента (домножено на 1024) */
       ;
+  size_t readaheads /* Количество выданных ОС подсказок об упреждающем
+                     * чтении страниц, см fpta_readahead. */
+      ;
+  size_t filter_reorders /* Количество перестановок условий фильтра,
+                          * см fpta_adaptive_filter. */
+      ;
+  uint64_t filter_swaps /* Маска узлов fpta_node_and и fpta_node_or фильтра,
+                         * операнды которых переставлены. Узлы нумеруются
+                         * в порядке обхода фильтра в глубину, начиная с
+                         * корня, учитываются первые 64 узла. */
+      ;
 } fpta_cursor_stat;
 
 /* Возвращает статистику использования курсора.
@@ -2770,6 +3337,96 @@ int fpta_apply_visitor(
     size_t *count, int (*visitor)(const fptu_ro *row, void *context, void *arg),
     void *visitor_context, void *visitor_arg);
 
+/* Пакетный вариант fpta_apply_visitor() для сплошного просмотра выборки.
+ *
+ * Открывает курсор аналогично fpta_apply_visitor() и передаёт функтору
+ * visitor последовательные пакеты строк выборки, посредством
+ * fpta_cursor_get_batch(). Таким образом косвенный вызов функтора выполняется
+ * не для каждой строки, а для пакета строк. Курсор размещается на стеке,
+ * без обращения к пулу курсоров. Строки пакета действительны только
+ * во время вызова функтора.
+ *
+ * Функтор может прервать просмотр вернув ненулевое значение, которое будет
+ * возвращено в качестве результата всей функции. Для C++ см также шаблон
+ * fpta::visit(), позволяющий компилятору встроить тело функтора в цикл
+ * обработки пакета.
+ *
+ * Возвращает FPTA_SUCCESS (0) если все строки выборки (в том числе пустой)
+ * были переданы функтору, иначе код ошибки или ненулевой результат
+ * полученный от функтора. */
+FPTA_API int fpta_apply_batch_visitor(
+    fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+    fpta_value range_to, fpta_filter *filter, fpta_cursor_options op,
+    int (*visitor)(const fptu_ro *rows, size_t count, void *context),
+    void *visitor_context);
+
+/* Параллельный просмотр выборки несколькими потоками.
+ *
+ * Диапазон range_from..range_to (интерпретируется аналогично
+ * fpta_cursor_open()) делится на партиции с примерно равным количеством
+ * строк. Границы партиций подбираются бисекцией в пространстве значений
+ * ключа с оценкой количества строк посредством mdbx_estimate_range(), т.е.
+ * без просмотра самих строк. Партиции обрабатываются пулом из nthreads
+ * потоков (включая вызывающий), каждый из которых использует собственный
+ * курсор над MVCC-снимком транзакции txn.
+ *
+ * Функтору visitor передаются последовательные пакеты строк аналогично
+ * fpta_apply_batch_visitor(), а также номер потока от 0 до nthreads - 1.
+ * Функтор вызывается одновременно из разных потоков, но для одного номера
+ * потока вызовы последовательны, что позволяет накапливать результаты без
+ * блокировок, например в массиве из nthreads элементов. Порядок строк
+ * и партиций не определен.
+ *
+ * При nthreads > 1 транзакция переводится в разделяемый режим посредством
+ * fpta_transaction_share(), поэтому БД должна быть открыта с опцией
+ * fpta_shared_snapshot, а экземпляры fpta_name внутри фильтра не должны
+ * одновременно использоваться в других потоках. Если диапазон не удается
+ * разделить (например, он содержит одно значение ключа или слишком мало
+ * строк), то просмотр выполняется в вызывающем потоке.
+ *
+ * Функтор может прервать просмотр вернув ненулевое значение, при этом
+ * остальные потоки прекращают работу после обработки текущего пакета.
+ *
+ * Возвращает FPTA_SUCCESS (0) если все строки выборки были переданы
+ * функтору, иначе код ошибки или первый ненулевой результат полученный
+ * от функтора. */
+FPTA_API int fpta_parallel_visit(
+    fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+    fpta_value range_to, fpta_filter *filter, unsigned nthreads,
+    int (*visitor)(const fptu_ro *rows, size_t count, void *context,
+                   unsigned worker),
+    void *visitor_context);
+
+/* Соединение слиянием (merge-join) двух упорядоченных выборок.
+ *
+ * Курсоры left и right должны быть открыты в одной транзакции чтения
+ * (для пишущих транзакций возвращается FPTA_EPERM) с одинаковым
+ * порядком сортировки (fpta_ascending или fpta_descending) по индексам
+ * с совместимыми значениями ключа: одного типа, с одинаковым направлением
+ * упорядоченности и допустимостью NULL. Составные индексы и курсоры
+ * с опцией fpta_keys_only не поддерживаются.
+ *
+ * Начиная с текущих позиций курсоры продвигаются навстречу совпадающим
+ * значениям ключа в режиме "чехарды": отстающий курсор сначала делает один
+ * шаг, а если этого недостаточно, то перемещается посредством
+ * fpta_cursor_locate(exactly = false) к ключу в позиции другого курсора.
+ * Таким образом стоимость соединения порядка одного линейного прохода плюс
+ * поиск на пропусках, вместо поиска по индексу для каждой строки.
+ *
+ * Для каждой пары строк с равными значениями ключа вызывается функтор
+ * visitor, при наличии дубликатов с обеих сторон - для каждого сочетания.
+ * Функтор не должен изменять таблицы и курсоры участвующие в соединении.
+ * Функтор может прервать соединение вернув ненулевое значение, которое
+ * будет возвращено в качестве результата всей функции.
+ *
+ * Возвращает FPTA_SUCCESS (0) если одна из выборок была исчерпана, иначе
+ * код ошибки или ненулевой результат полученный от функтора. */
+FPTA_API int fpta_merge_join(fpta_cursor *left, fpta_cursor *right,
+                             int (*visitor)(const fptu_ro *left_row,
+                                            const fptu_ro *right_row,
+                                            void *context),
+                             void *visitor_context);
+
 /* Проверяет наличие за курсором данных.
  *
  * Отсутствие данных означает, что нет возможности их прочитать, изменить
@@ -2800,11 +3457,18 @@ FPTA_API int fpta_cursor_state(const fpta_cursor *cursor);
 
 /* Возвращает количество строк попадающих в условие выборки курсора.
  *
- * Подсчет производится путем перестановки и пошагового движения курсора.
- * Операция затратна, стоимость порядка O(log(ALL) + RANGE),
+ * При наличии фильтра подсчет производится путем перестановки и пошагового
+ * движения курсора. Операция затратна, стоимость порядка O(log(ALL) + RANGE),
  * где ALL - общее количество строк в таблице, а RANGE - количество строк
  * попадающее под первичный (range from/to) критерий выборки.
  *
+ * Без фильтра подсчет производится аналогично fpta_count_range(), т.е. для
+ * полного диапазона за O(1), а иначе перебором только значений ключа внутри
+ * или вне диапазона (что меньше), без чтения строк. Фильтр, условия которого
+ * относятся только к ключевой колонке курсора с числовым типом без NULL,
+ * проверяется по значениям ключа, также без чтения строк. Индекс из одной
+ * страницы просматривается пошагово, так как это не дороже.
+ *
  * Текущая позиция курсора не используется и сбрасывается перед возвратом,
  * как если бы курсор был открыл с опцией fpta_dont_fetch.
  *
@@ -2815,6 +3479,25 @@ FPTA_API int fpta_cursor_state(const fpta_cursor *cursor);
 FPTA_API int fpta_cursor_count(fpta_cursor *cursor, size_t *count,
                                size_t limit);
 
+/* Возвращает точное количество строк попадающих в диапазон значений колонки
+ * без фильтрации, не требуя открытия курсора.
+ *
+ * Аргументы column_id, range_from и range_to имеют тот-же смысл, что и для
+ * fpta_cursor_open(), в том числе допускается использование fpta_epsilon для
+ * подсчета строк с заданным значением колонки.
+ *
+ * Для полного диапазона количество берется из статистики индекса, т.е. за
+ * O(1). Иначе перебираются только значения ключа (без чтения строк), причем
+ * дубликаты учитываются целиком, а для диапазонов покрывающих больше половины
+ * индекса перебираются ключи вне диапазона. Таким образом, стоимость подсчета
+ * порядка O(log(ALL) + MIN(RANGE, ALL - RANGE)). Индекс из одной страницы
+ * просматривается пошагово.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_count_range(fpta_txn *txn, fpta_name *column_id,
+                              fpta_value range_from, fpta_value range_to,
+                              size_t *count);
+
 /* Считает и возвращает количество дубликатов для ключа в текущей
  * позиции курсора, БЕЗ учета фильтра заданного при открытии курсора.
  *
@@ -2829,6 +3512,34 @@ FPTA_API int fpta_cursor_dups(fpta_cursor *cursor, size_t *dups);
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_cursor_get(fpta_cursor *cursor, fptu_ro *tuple);
 
+/* Пакетная выборка строк, начиная с текущей позиции курсора.
+ *
+ * Функция заполняет массив rows строками из текущей и последующих (в порядке
+ * курсора) позиций, но не более capacity штук, и возвращает их количество
+ * в fetched. После возврата курсор стоит на строке следующей за последней
+ * выбранной, либо в состоянии конца данных. Таким образом, пакетная выборка
+ * равноценна чередованию вызовов fpta_cursor_get() и fpta_cursor_move()
+ * с операцией fpta_next, но без повторения проверок аргументов и состояния
+ * курсора для каждой строки.
+ *
+ * Возвращаемые строки ссылаются непосредственно на данные в БД (без
+ * копирования) и остаются действительными до изменения данных в текущей
+ * транзакции, её завершения или перезапуска. В управляемой сессии (см
+ * fpta_transaction_autorestart()) перезапуск возможен только в начале
+ * очередного вызова fpta_cursor_get_batch() или fpta_cursor_move().
+ *
+ * Функция fpta_cursor_get_batch_ex() дополнительно заполняет массив keys
+ * значениями ключа, аналогично fpta_cursor_key(). Один из аргументов rows
+ * и keys может быть нулевым.
+ *
+ * Возвращает FPTA_NODATA если курсор не стоит на строке (конец данных).
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_cursor_get_batch(fpta_cursor *cursor, fptu_ro *rows,
+                                   size_t capacity, size_t *fetched);
+FPTA_API int fpta_cursor_get_batch_ex(fpta_cursor *cursor, fptu_ro *rows,
+                                      fpta_value *keys, size_t capacity,
+                                      size_t *fetched);
+
 /* Варианты перемещения курсора. */
 typedef enum fpta_seek_operations {
   /* Перемещение по диапазону строк за курсором. */
@@ -2860,6 +3571,22 @@ typedef enum fpta_seek_operations {
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op);
 
+/* Устанавливает курсор на строку с порядковым номером nth (начиная с нуля)
+ * в порядке курсора, с учетом диапазона и фильтра заданных при открытии.
+ *
+ * Функция предназначена для постраничного просмотра со смещением (OFFSET)
+ * и равноценна перемещению курсора к первой строке с последующим nth-кратным
+ * перемещением к следующей. Однако, для курсоров без фильтра:
+ *  - дубликаты значения ключа пропускаются целиком, без перебора;
+ *  - при отсутствии границ диапазона к строкам во второй половине выборки
+ *    курсор движется с конца, т.е. стоимость порядка O(log(ALL) +
+ *    MIN(nth, ALL - nth)), где ALL - количество строк в таблице.
+ *
+ * Возвращает FPTA_NODATA если в выборке меньше чем nth + 1 строк, при этом
+ * курсор оказывается в состоянии конца данных.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_cursor_seek_nth(fpta_cursor *cursor, size_t nth);
+
 /* Перемещение курсора к заданному ключу или к строке с аналогичным
  * значением ключевой колонки.
  *
@@ -2908,6 +3635,21 @@ FPTA_API int fpta_cursor_locate(fpta_cursor *cursor, bool exactly,
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_cursor_key(fpta_cursor *cursor, fpta_value *key);
 
+/* Возвращает значения ключевой колонки курсора и первичного ключа для строки
+ * в текущей позиции курсора, без чтения самой строки.
+ *
+ * Для курсора по вторичному индексу оба значения берутся непосредственно из
+ * индекса, т.е. без повторного спуска по дереву первичного индекса (см также
+ * флаг fpta_keys_only). Для курсора по первичному индексу значения совпадают.
+ * Один из аргументов key и pk может быть нулевым.
+ *
+ * Аналогично fpta_cursor_key() значения ссылаются на данные в БД и остаются
+ * действительными до изменения данных в текущей транзакции или её завершения.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_cursor_get_keys(fpta_cursor *cursor, fpta_value *key,
+                                  fpta_value *pk);
+
 //----------------------------------------------------------------------------
 /* Манипуляция данными без курсоров. */
 
@@ -3511,6 +4253,49 @@ describe_composite_index(const char *composite_name, fpta_index_type index_type,
                                        array.data(), array.size());
 }
 
+namespace details {
+template <typename VISITOR> struct visit_trampoline {
+  static int batch(const fptu_ro *rows, size_t count, void *context) {
+    VISITOR &visitor = *static_cast<VISITOR *>(context);
+    for (size_t i = 0; i < count; ++i) {
+      const int rc = visitor(rows[i]);
+      if (rc != FPTA_SUCCESS)
+        return rc;
+    }
+    return FPTA_SUCCESS;
+  }
+};
+} // namespace details
+
+/* Просмотр выборки с вызовом функтора для каждой строки, см
+ * fpta_apply_batch_visitor(). Функтор вида int(const fptu_ro &row) вызывается
+ * непосредственно из цикла обработки пакета строк и может быть встроен
+ * компилятором. Ненулевой результат функтора прерывает просмотр и
+ * возвращается в качестве результата.
+ *
+ * Встраиваемой является только обработка пакета, а выборка строк
+ * выполняется внутри библиотеки посредством fpta_apply_batch_visitor(),
+ * так как размещение курсора на стеке и пакетная проверка фильтра требуют
+ * доступа к внутренним структурам. Косвенный вызов выполняется один раз
+ * на пакет строк. */
+template <typename VISITOR>
+inline int visit(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+                 fpta_value range_to, fpta_filter *filter,
+                 fpta_cursor_options op, VISITOR &&visitor) {
+  using functor = typename std::remove_reference<VISITOR>::type;
+  return fpta_apply_batch_visitor(
+      txn, column_id, range_from, range_to, filter, op,
+      details::visit_trampoline<functor>::batch,
+      const_cast<void *>(static_cast<const void *>(&visitor)));
+}
+
+template <typename VISITOR>
+inline int visit(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+                 fpta_value range_to, fpta_filter *filter, VISITOR &&visitor) {
+  return visit(txn, column_id, range_from, range_to, filter, fpta_unsorted,
+               std::forward<VISITOR>(visitor));
+}
+
 /* TODO: describe */
 string_view inline schema_symbol(const fpta_schema_info *info,
                                  const fpta_name *id, int &error) {
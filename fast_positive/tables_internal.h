@@ -344,7 +344,12 @@ struct fpta_txn {
   fpta_db *db;
   MDBX_txn *mdbx_txn;
   fpta_level level;
-  int unused_gap;
+  bool parked /* транзакция припаркована, см fpta_transaction_park() */;
+  uint8_t schema_shard /* счетчик читателей схемы, см fpta_db_lock() */;
+  struct fpta_txn_shared *shared /* см fpta_transaction_share() */;
+  struct fpta_txn_managed *managed /* см fpta_transaction_autorestart() */;
+  struct fpta_cursor *cursors /* открытые курсоры, см fpta_cursor_attach() */;
+  unsigned savepoints /* глубина вложенности точек сохранения */;
   uint64_t db_version;
   uint64_t schema_tsn_;
 
@@ -378,6 +383,103 @@ struct fpta_key {
   } place;
 };
 
+/* Нормализованный диапазон курсора открытого посредством
+ * fpta_cursor_open_ranges(). */
+struct fpta_cursor_range {
+  MDBX_val from, to /* iov_base == nullptr при отсутствии границы */;
+  bool inclusive /* строки с ключом равным to входят в диапазон */;
+  uint64_t from_place[sizeof(fpta_key::place) / sizeof(uint64_t)];
+  uint64_t to_place[sizeof(fpta_key::place) / sizeof(uint64_t)];
+};
+
+/* Инструкция скомпилированного фильтра, см fpta_filter_compile(). */
+struct fpta_filter_op {
+  enum opcode : uint8_t {
+    op_false,
+    op_true,
+    op_cmp_null,
+    op_cmp_sint,
+    op_cmp_uint,
+    op_cmp_fp,
+    op_cmp_datetime,
+    op_cmp_string,
+    op_cmp_binary,
+    op_in,
+    op_fncol,
+    op_fnrow
+  };
+  enum : uint16_t {
+    /* Переходы за пределы программы означают её результат. */
+    goto_false = UINT16_MAX - 1,
+    goto_true = UINT16_MAX,
+    max_ops = goto_false
+  };
+
+  opcode code;
+  uint8_t bits /* маска fptu_lge для сравнений */;
+  uint8_t type /* тип колонки для fptu::lookup() */;
+  uint8_t slot /* индекс поля в таблице fpta_filter_program::tags */;
+  uint16_t column /* номер колонки */;
+  uint16_t on_true, on_false /* индексы следующих инструкций */;
+  uint16_t leaf /* номер листа в исходном порядке обхода фильтра */;
+  union {
+    int64_t sint;
+    uint64_t uint;
+    double fp;
+    uint64_t datetime;
+  } value /* значение для сравнения скалярных типов */;
+  const fpta_filter *node /* исходный узел с остальными операндами */;
+};
+
+/* Размеры поддерева фильтра в листьях и узлах AND/OR. */
+struct fpta_filter_shape {
+  unsigned leaves, junctions;
+};
+
+/* Счетчики вычислений листа фильтра для адаптивного упорядочивания. */
+struct fpta_filter_stat {
+  uint32_t evaluations, passes;
+};
+
+/* Фильтр курсора, скомпилированный в линейную программу. Короткие программы
+ * размещаются внутри курсора, чтобы открытие курсора не требовало выделения
+ * памяти.
+ *
+ * Если программа обращается к колонкам строки более одного раза, то вместо
+ * поиска каждого поля посредством fptu::lookup() заголовки полей строки
+ * просматриваются однократно с заполнением таблицы слотов для всех
+ * используемых колонок.
+ *
+ * Для курсоров с fpta_adaptive_filter программа подсчитывает вычисления
+ * и срабатывания каждого листа, и периодически перекомпилируется с такой
+ * перестановкой операндов узлов AND/OR, при которой ожидаемая стоимость
+ * проверки строки минимальна. При этом заново генерируются только
+ * поддеревья узлов с измененным порядком операндов. */
+struct fpta_filter_program {
+  enum {
+    place_ops = 8,
+    max_slots = 16,
+    max_swaps = 64 /* количество узлов AND/OR, допускающих перестановку */,
+    adapt_period = 256 /* количество проверок строк между перестановками */
+  };
+  fpta_filter_op *ops /* nullptr для fpta_filter_any/none */;
+  void *allocated;
+  const fpta_filter *root /* исходный фильтр для перекомпиляции */;
+  unsigned count /* количество инструкций */;
+  unsigned slots /* 0 при поиске каждого поля по-отдельности */;
+  uint64_t slots_bloom /* маска номеров колонок по модулю 64 */;
+  uint16_t tags[max_slots] /* теги полей используемых колонок */;
+  fpta_filter_shape *shapes /* размеры первых операндов узлов AND/OR
+                               в порядке обхода фильтра */;
+  fpta_filter_stat *stats /* nullptr без адаптивного упорядочивания */;
+  uint64_t swaps /* маска узлов AND/OR с переставленными операндами */;
+  unsigned evaluations /* проверки строк с последней перекомпиляции */;
+  unsigned reorders /* количество перекомпиляций с новым порядком */;
+  fpta_filter_op place[place_ops];
+  fpta_filter_stat stats_place[place_ops];
+  fpta_filter_shape shapes_place[place_ops - 1];
+};
+
 struct fpta_cursor {
   fpta_cursor(const fpta_cursor &) = delete;
   MDBX_cursor *mdbx_cursor;
@@ -391,9 +493,15 @@ struct fpta_cursor {
     size_t uniq_checks;
     size_t upserts;
     size_t deletions;
+    size_t readaheads;
   } metrics;
   int bring(MDBX_val *key, MDBX_val *data, const MDBX_cursor_op op);
 
+  unsigned sequential_steps /* длина текущей серии последовательных
+                               переходов, см fpta_cursor_readahead() */;
+  uintptr_t readahead_lo, readahead_hi /* окно последней подсказки
+                                          упреждающего чтения */;
+
   enum eof_mode : uintptr_t {
     poor = 0,
     before_first = 1,
@@ -427,6 +535,9 @@ struct fpta_cursor {
   /* uint8_t */ fpta_cursor_options options;
   uint8_t seek_range_state;
   uint8_t seek_range_flags;
+  bool stepped_back /* строка в позиции курсора была удалена, и курсор
+                       переустановлен на предшествующую строку,
+                       см fpta_cursor_position_restore() */;
   MDBX_dbi tbl_handle, idx_handle;
 
   fpta_table_schema *table_schema() const { return table_id->table_schema; }
@@ -443,7 +554,17 @@ struct fpta_cursor {
 
   fpta_key range_from_key;
   fpta_key range_to_key;
+  fpta_filter_program filter_program;
+  fpta_cursor_range *ranges /* упорядоченные по ключу диапазоны, границы
+                               активного из которых перенесены в
+                               range_from_key и range_to_key */;
+  unsigned ranges_count, range_index;
   fpta_db *db;
+  fpta_cursor *txn_next, **txn_pprev /* список открытых курсоров
+                                        транзакции, см fpta_cursor_attach() */;
+  unsigned savepoint /* глубина точек сохранения при открытии курсора */;
+  bool cancelled /* курсор отменен откатом точки сохранения */;
+  bool closed /* закрытие отложено до завершения точки сохранения */;
 };
 
 //----------------------------------------------------------------------------
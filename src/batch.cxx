@@ -0,0 +1,544 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||            \
+    defined(_M_IX86)
+#include <immintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FPTA_BATCH_SSE2 1
+#endif
+#if __GNUC_PREREQ(4, 9) || __CLANG_PREREQ(3, 8)
+#define FPTA_BATCH_AVX2 1
+#endif
+#endif
+
+/* Пакетная проверка строк фильтром.
+ *
+ * Строки обрабатываются порциями по 64, результат каждого узла фильтра
+ * представляется битовой маской порции, а узлы AND/OR/NOT сводятся
+ * к поразрядным операциям над масками. Каждый узел вычисляется только для
+ * "активных" строк, для которых его результат влияет на итог: второй операнд
+ * AND только там, где первый истинен, а второй операнд OR только там, где
+ * первый ложен. Поэтому предикаты fpta_node_fncol и fpta_node_fnrow
+ * вызываются для тех же строк, что и при проверке fpta_filter_match().
+ *
+ * Для сравнений числовых колонок с числами значения колонки сначала
+ * собираются для всей порции в непрерывный массив int64_t или double,
+ * а затем сравниваются ядрами SSE2/AVX2, выбираемыми во время исполнения
+ * по возможностям процессора. Результат в точности повторяет fpta_cmp_sint(),
+ * fpta_cmp_uint() и fpta_cmp_fp(), в том числе для отсутствующих полей.
+ * Исключение составляет NaN: библиотека собирается с -ffast-math, поэтому
+ * результат сравнения с NaN определяется компилятором и может отличаться
+ * у SIMD-ядер и построчной проверки. Поэтому условия с NaN в правом операнде
+ * проверяются построчно целиком, а строки с NaN в значении колонки
+ * отмечаются при сборе значений (по битовому представлению) и для них
+ * результат ядра заменяется результатом fpta_filter_match_internal().
+ * Собранные значения используются повторно всеми сравнениями с той же
+ * колонкой в пределах порции, например для диапазона "a <= x AND x < b".
+ * Остальные условия проверяются построчно. */
+
+namespace {
+
+enum fpta_batch_kind {
+  fpta_batch_none /* сравнение проверяется построчно */,
+  fpta_batch_constant /* результат одинаков для всех имеющихся полей */,
+  fpta_batch_signed /* значения как int64_t */,
+  fpta_batch_unsigned /* значения как uint64_t со сдвигом на 2^63 */,
+  fpta_batch_float /* значения как double */
+};
+
+enum { fpta_batch_lanes = 64, fpta_batch_columns = 4 };
+
+struct fpta_batch_leaf {
+  fpta_batch_kind kind;
+  fptu_lge constant;
+  union {
+    int64_t i64;
+    double f64;
+  } rhs;
+};
+
+struct alignas(32) fpta_batch_column {
+  union {
+    int64_t i64[fpta_batch_lanes];
+    double f64[fpta_batch_lanes];
+  } values;
+  uint64_t gathered /* строки, значения которых уже собраны */;
+  uint64_t present /* строки, в которых есть поле колонки */;
+  uint64_t nans /* строки, в которых значение колонки NaN */;
+  unsigned colnum;
+  fptu_type type;
+  fpta_batch_kind kind;
+};
+
+struct fpta_batch_chunk {
+  const fptu_ro *rows;
+  unsigned used, evict;
+  fpta_batch_column columns[fpta_batch_columns];
+
+  void reset(const fptu_ro *chunk_rows) {
+    rows = chunk_rows;
+    used = evict = 0;
+  }
+  fpta_batch_column &column(unsigned colnum, fptu_type type,
+                            fpta_batch_kind kind);
+};
+
+typedef void (*fpta_batch_kernel_i64)(const int64_t *values, int64_t rhs,
+                                      uint64_t &lt, uint64_t &eq);
+typedef void (*fpta_batch_kernel_f64)(const double *values, double rhs,
+                                      uint64_t &lt, uint64_t &eq);
+
+struct fpta_batch_kernels {
+  fpta_batch_kernel_i64 i64;
+  fpta_batch_kernel_f64 f64;
+};
+
+} // namespace
+
+static __inline unsigned fpta_batch_ctz(uint64_t mask) {
+  assert(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return unsigned(__builtin_ctzll(mask));
+#else
+  unsigned n = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    n += 1;
+  }
+  return n;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+/* Ядра сравнения 64 значений порции с правым операндом, возвращающие маски
+ * "меньше" и "равно". Маска "больше" вычисляется как дополнение, аналогично
+ * fptu_cmp2lge(). */
+
+template <typename T>
+static __hot void fpta_batch_cmp_generic(const T *values, T rhs, uint64_t &lt,
+                                         uint64_t &eq) {
+  uint64_t l = 0, e = 0;
+  for (unsigned i = 0; i < fpta_batch_lanes; ++i) {
+    l |= uint64_t(values[i] < rhs) << i;
+    e |= uint64_t(values[i] == rhs) << i;
+  }
+  lt = l;
+  eq = e;
+}
+
+#if FPTA_BATCH_SSE2
+/* В SSE2 нет сравнения 64-битных целых, поэтому для них остается
+ * обобщенное ядро. */
+static __hot void fpta_batch_cmp_f64_sse2(const double *values, double rhs,
+                                          uint64_t &lt, uint64_t &eq) {
+  const __m128d r = _mm_set1_pd(rhs);
+  uint64_t l = 0, e = 0;
+  for (unsigned i = 0; i < fpta_batch_lanes; i += 2) {
+    const __m128d v = _mm_load_pd(values + i);
+    l |= uint64_t(_mm_movemask_pd(_mm_cmplt_pd(v, r))) << i;
+    e |= uint64_t(_mm_movemask_pd(_mm_cmpeq_pd(v, r))) << i;
+  }
+  lt = l;
+  eq = e;
+}
+#endif /* FPTA_BATCH_SSE2 */
+
+#if FPTA_BATCH_AVX2
+__attribute__((__target__("avx2"))) static __hot void
+fpta_batch_cmp_f64_avx2(const double *values, double rhs, uint64_t &lt,
+                        uint64_t &eq) {
+  const __m256d r = _mm256_set1_pd(rhs);
+  uint64_t l = 0, e = 0;
+  for (unsigned i = 0; i < fpta_batch_lanes; i += 4) {
+    const __m256d v = _mm256_load_pd(values + i);
+    l |= uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_LT_OQ))) << i;
+    e |= uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_EQ_OQ))) << i;
+  }
+  lt = l;
+  eq = e;
+}
+
+__attribute__((__target__("avx2"))) static __hot void
+fpta_batch_cmp_i64_avx2(const int64_t *values, int64_t rhs, uint64_t &lt,
+                        uint64_t &eq) {
+  const __m256i r = _mm256_set1_epi64x(rhs);
+  uint64_t l = 0, e = 0;
+  for (unsigned i = 0; i < fpta_batch_lanes; i += 4) {
+    const __m256i v =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(values + i));
+    l |= uint64_t(_mm256_movemask_pd(
+             _mm256_castsi256_pd(_mm256_cmpgt_epi64(r, v))))
+         << i;
+    e |= uint64_t(_mm256_movemask_pd(
+             _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, r))))
+         << i;
+  }
+  lt = l;
+  eq = e;
+}
+#endif /* FPTA_BATCH_AVX2 */
+
+static fpta_batch_kernels fpta_batch_select_kernels() {
+  fpta_batch_kernels kernels = {fpta_batch_cmp_generic<int64_t>,
+                                fpta_batch_cmp_generic<double>};
+#if FPTA_BATCH_SSE2
+  kernels.f64 = fpta_batch_cmp_f64_sse2;
+#endif /* FPTA_BATCH_SSE2 */
+#if FPTA_BATCH_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.i64 = fpta_batch_cmp_i64_avx2;
+    kernels.f64 = fpta_batch_cmp_f64_avx2;
+  }
+#endif /* FPTA_BATCH_AVX2 */
+  return kernels;
+}
+
+static const fpta_batch_kernels &fpta_batch_dispatch() {
+  static const fpta_batch_kernels kernels = fpta_batch_select_kernels();
+  return kernels;
+}
+
+//----------------------------------------------------------------------------
+
+/* Определяет способ пакетного сравнения для условия f, повторяя логику
+ * fpta_filter_cmp() для типа колонки и правого операнда. */
+static fpta_batch_leaf fpta_batch_classify(const fpta_filter *f) {
+  fpta_batch_leaf leaf;
+  leaf.kind = fpta_batch_none;
+  leaf.constant = fptu_ic;
+  leaf.rhs.i64 = 0;
+
+  switch (f->type) {
+  default:
+    return leaf;
+  case fpta_node_lt:
+  case fpta_node_gt:
+  case fpta_node_le:
+  case fpta_node_ge:
+  case fpta_node_eq:
+  case fpta_node_ne:
+    break;
+  }
+
+  const fptu_type type = fpta_id2type(f->node_cmp.left_id);
+  const fpta_value &right = f->node_cmp.right_value;
+  const bool integer = type == fptu_uint16 || type == fptu_uint32 ||
+                       type == fptu_int32 || type == fptu_int64;
+  const bool fp = type == fptu_fp32 || type == fptu_fp64;
+
+  switch (right.type) {
+  default:
+    break;
+
+  case fpta_float_point:
+    if ((integer || fp || type == fptu_uint64) &&
+        !erthink::fpclassify_from_uint(right.uint).is_nan()) {
+      leaf.kind = fpta_batch_float;
+      leaf.rhs.f64 = right.fp;
+    }
+    break;
+
+  case fpta_signed_int:
+    if (fp) {
+      leaf.kind = fpta_batch_float;
+      leaf.rhs.f64 = double(right.sint);
+    } else if (integer) {
+      leaf.kind = fpta_batch_signed;
+      leaf.rhs.i64 = right.sint;
+    } else if (type == fptu_uint64) {
+      if (right.sint < 0) {
+        leaf.kind = fpta_batch_constant;
+        leaf.constant = fptu_gt;
+      } else {
+        leaf.kind = fpta_batch_unsigned;
+        leaf.rhs.i64 = int64_t(uint64_t(right.sint) ^ UINT64_C(1) << 63);
+      }
+    }
+    break;
+
+  case fpta_unsigned_int:
+    if (fp) {
+      leaf.kind = fpta_batch_float;
+      leaf.rhs.f64 = double(right.uint);
+    } else if (integer) {
+      if (right.uint > uint64_t(INT64_MAX)) {
+        leaf.kind = fpta_batch_constant;
+        leaf.constant = fptu_lt;
+      } else {
+        leaf.kind = fpta_batch_signed;
+        leaf.rhs.i64 = int64_t(right.uint);
+      }
+    } else if (type == fptu_uint64) {
+      leaf.kind = fpta_batch_unsigned;
+      leaf.rhs.i64 = int64_t(right.uint ^ UINT64_C(1) << 63);
+    }
+    break;
+
+  case fpta_datetime:
+    if (type == fptu_datetime) {
+      leaf.kind = fpta_batch_unsigned;
+      leaf.rhs.i64 = int64_t(right.datetime.fixedpoint ^ UINT64_C(1) << 63);
+    }
+    break;
+  }
+  return leaf;
+}
+
+bool fpta_filter_batchable(const fpta_filter *filter) {
+  if (filter == fpta_filter_any || filter == fpta_filter_none)
+    return false;
+
+  switch (filter->type) {
+  case fpta_node_not:
+    return fpta_filter_batchable(filter->node_not);
+  case fpta_node_or:
+  case fpta_node_and:
+    return fpta_filter_batchable(filter->node_and.a) ||
+           fpta_filter_batchable(filter->node_and.b);
+  default:
+    return fpta_batch_classify(filter).kind != fpta_batch_none;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+fpta_batch_column &fpta_batch_chunk::column(unsigned colnum, fptu_type type,
+                                            fpta_batch_kind kind) {
+  for (unsigned i = 0; i < used; ++i) {
+    fpta_batch_column &c = columns[i];
+    if (c.colnum == colnum && c.type == type && c.kind == kind)
+      return c;
+  }
+
+  fpta_batch_column &c = columns[(used < fpta_batch_columns)
+                                     ? used++
+                                     : evict++ % fpta_batch_columns];
+  memset(&c.values, 0, sizeof(c.values));
+  c.gathered = c.present = c.nans = 0;
+  c.colnum = colnum;
+  c.type = type;
+  c.kind = kind;
+  return c;
+}
+
+static __hot void fpta_batch_gather(fpta_batch_column &c, const fptu_ro *rows,
+                                    uint64_t wanted) {
+  wanted &= ~c.gathered;
+  c.gathered |= wanted;
+  for (; wanted; wanted &= wanted - 1) {
+    const unsigned i = fpta_batch_ctz(wanted);
+    const fptu_field *pf = fptu::lookup(rows[i], c.colnum, c.type);
+    if (!pf)
+      continue;
+
+    c.present |= UINT64_C(1) << i;
+    const auto payload = pf->payload();
+    switch (c.kind) {
+    case fpta_batch_signed:
+      switch (c.type) {
+      case fptu_uint16:
+        c.values.i64[i] = pf->get_payload_uint16();
+        break;
+      case fptu_uint32:
+        c.values.i64[i] = payload->peek_u32();
+        break;
+      case fptu_int32:
+        c.values.i64[i] = payload->peek_i32();
+        break;
+      default:
+        c.values.i64[i] = payload->peek_i64();
+        break;
+      }
+      break;
+
+    case fpta_batch_unsigned:
+      c.values.i64[i] = int64_t(payload->peek_u64() ^ UINT64_C(1) << 63);
+      break;
+
+    case fpta_batch_float:
+      switch (c.type) {
+      case fptu_uint16:
+        c.values.f64[i] = pf->get_payload_uint16();
+        break;
+      case fptu_uint32:
+        c.values.f64[i] = payload->peek_u32();
+        break;
+      case fptu_int32:
+        c.values.f64[i] = payload->peek_i32();
+        break;
+      case fptu_int64:
+        c.values.f64[i] = double(payload->peek_i64());
+        break;
+      case fptu_uint64:
+        c.values.f64[i] = double(payload->peek_u64());
+        break;
+      case fptu_fp32:
+        c.values.f64[i] = payload->peek_fp32();
+        if (unlikely(
+                erthink::fpclassify_from_uint(payload->peek_u32()).is_nan()))
+          c.nans |= UINT64_C(1) << i;
+        break;
+      default:
+        c.values.f64[i] = payload->peek_fp64();
+        if (unlikely(
+                erthink::fpclassify_from_uint(payload->peek_u64()).is_nan()))
+          c.nans |= UINT64_C(1) << i;
+        break;
+      }
+      break;
+
+    default /* fpta_batch_constant, достаточно наличия поля */:
+      break;
+    }
+  }
+}
+
+static __hot uint64_t fpta_batch_compare(const fpta_filter *f,
+                                         const fpta_batch_leaf &leaf,
+                                         fpta_batch_chunk &chunk,
+                                         uint64_t active) {
+  fpta_batch_column &c =
+      chunk.column(f->node_cmp.left_id->column.num,
+                   fpta_id2type(f->node_cmp.left_id), leaf.kind);
+  fpta_batch_gather(c, chunk.rows, active);
+
+  uint64_t lt, eq;
+  switch (leaf.kind) {
+  case fpta_batch_signed:
+  case fpta_batch_unsigned:
+    fpta_batch_dispatch().i64(c.values.i64, leaf.rhs.i64, lt, eq);
+    break;
+  case fpta_batch_float:
+    fpta_batch_dispatch().f64(c.values.f64, leaf.rhs.f64, lt, eq);
+    break;
+  default:
+    assert(leaf.kind == fpta_batch_constant);
+    lt = (leaf.constant == fptu_lt) ? ~UINT64_C(0) : 0;
+    eq = 0;
+    break;
+  }
+
+  const unsigned want = f->type;
+  uint64_t match = 0;
+  if (want & fptu_lt)
+    match |= lt;
+  if (want & fptu_eq)
+    match |= eq;
+  if (want & fptu_gt)
+    match |= ~(lt | eq);
+  match &= c.present;
+  if (want & fptu_ic /* отсутствующее поле несравнимо с числом */)
+    match |= ~c.present;
+  match &= active;
+
+  /* Для NaN результат ядра не совпадает с построчной проверкой,
+   * в частности "больше" получается как дополнение. */
+  for (uint64_t nans = c.nans & active; unlikely(nans); nans &= nans - 1) {
+    const unsigned i = fpta_batch_ctz(nans);
+    const uint64_t bit = UINT64_C(1) << i;
+    match = fpta_filter_match_internal(f, chunk.rows[i]) ? match | bit
+                                                          : match & ~bit;
+  }
+  return match;
+}
+
+/* Возвращает маску строк порции из active, удовлетворяющих условию f. */
+static __hot uint64_t fpta_batch_eval(const fpta_filter *f,
+                                      fpta_batch_chunk &chunk,
+                                      uint64_t active) {
+  if (unlikely(active == 0))
+    return 0;
+
+  switch (f->type) {
+  case fpta_node_collapsed_true:
+  case fpta_node_cond_true:
+    return active;
+  case fpta_node_collapsed_false:
+  case fpta_node_cond_false:
+    return 0;
+
+  case fpta_node_not:
+    return active & ~fpta_batch_eval(f->node_not, chunk, active);
+
+  case fpta_node_or: {
+    const uint64_t a = fpta_batch_eval(f->node_or.a, chunk, active);
+    return a | fpta_batch_eval(f->node_or.b, chunk, active & ~a);
+  }
+
+  case fpta_node_and:
+    return fpta_batch_eval(f->node_and.b, chunk,
+                           fpta_batch_eval(f->node_and.a, chunk, active));
+
+  default:
+    const fpta_batch_leaf leaf = fpta_batch_classify(f);
+    if (leaf.kind != fpta_batch_none)
+      return fpta_batch_compare(f, leaf, chunk, active);
+    break;
+  }
+
+  uint64_t match = 0;
+  for (uint64_t rest = active; rest; rest &= rest - 1) {
+    const unsigned i = fpta_batch_ctz(rest);
+    if (fpta_filter_match_internal(f, chunk.rows[i]))
+      match |= UINT64_C(1) << i;
+  }
+  return match;
+}
+
+int fpta_filter_match_batch(const fpta_filter *filter, const fptu_ro *rows,
+                            size_t n, uint64_t *bitmap) {
+  if (unlikely(n && (rows == nullptr || bitmap == nullptr)))
+    return FPTA_EINVAL;
+
+  fpta_batch_chunk chunk;
+  for (size_t offset = 0; offset < n; offset += fpta_batch_lanes) {
+    const size_t left = n - offset;
+    const uint64_t active = (left < fpta_batch_lanes)
+                                ? (UINT64_C(1) << left) - 1
+                                : ~UINT64_C(0);
+    uint64_t &word = bitmap[offset / fpta_batch_lanes];
+    if (filter == fpta_filter_any)
+      word = active;
+    else if (filter == fpta_filter_none)
+      word = 0;
+    else {
+      chunk.reset(rows + offset);
+      word = fpta_batch_eval(filter, chunk, active);
+    }
+  }
+  return FPTA_SUCCESS;
+}
+
+size_t fpta_filter_select_batch(const fpta_filter *filter, fptu_ro *rows,
+                                size_t n) {
+  size_t kept = 0;
+  for (size_t offset = 0; offset < n; offset += fpta_batch_lanes) {
+    const size_t count = std::min(n - offset, size_t(fpta_batch_lanes));
+    uint64_t match;
+    int err = fpta_filter_match_batch(filter, rows + offset, count, &match);
+    assert(err == FPTA_SUCCESS);
+    (void)err;
+    for (; match; match &= match - 1)
+      rows[kept++] = rows[offset + fpta_batch_ctz(match)];
+  }
+  return kept;
+}
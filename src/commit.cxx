@@ -0,0 +1,208 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+/* Групповая фиксация.
+ *
+ * Каждый вызов fpta_submit_write() ставит в очередь запрос, размещенный
+ * в стеке вызывающего потока. Если в данный момент нет "лидера", то поток
+ * становится им, забирает из очереди все накопившиеся запросы и выполняет их
+ * в одной пишущей транзакции. Запросы поступающие пока лидер выполняет
+ * и фиксирует транзакцию, накапливаются для следующей группы. По завершении
+ * лидер отмечает запросы группы выполненными и будит ожидающие потоки,
+ * один из которых становится следующим лидером.
+ *
+ * Каждое замыкание выполняется внутри точки сохранения, что позволяет
+ * откатить только неудачное замыкание. Однако, текущая версия libmdbx не
+ * поддерживает вложенные транзакции в режиме MDBX_WRITEMAP (используемом
+ * по-умолчанию), поэтому в этом случае для отката неудачного замыкания вся
+ * транзакция прерывается, а остальные замыкания группы выполняются повторно. */
+
+struct fpta_write_request {
+  fpta_write_func *func;
+  void *ctx;
+  fpta_write_request *next;
+  int rc;
+  bool failed /* замыкание вернуло ошибку и исключено из группы */;
+  bool done /* результат rc окончателен */;
+};
+
+struct fpta_group_commit {
+  fpta_mutex_t mutex;
+  fpta_cond_t cond;
+  fpta_write_request *head, **tail;
+  bool leader_active;
+};
+
+static fpta_group_commit *fpta_group_commit_get(fpta_db *db) {
+  fpta_group_commit *gc = db->group_commit.load(std::memory_order_acquire);
+  if (likely(gc))
+    return gc;
+
+  fpta_group_commit *fresh =
+      (fpta_group_commit *)calloc(1, sizeof(fpta_group_commit));
+  if (unlikely(fresh == nullptr))
+    return nullptr;
+  fresh->tail = &fresh->head;
+  if (unlikely(fpta_mutex_init(&fresh->mutex) != 0)) {
+    free(fresh);
+    return nullptr;
+  }
+  if (unlikely(fpta_cond_init(&fresh->cond) != 0)) {
+    fpta_mutex_destroy(&fresh->mutex);
+    free(fresh);
+    return nullptr;
+  }
+
+  if (db->group_commit.compare_exchange_strong(gc, fresh,
+                                               std::memory_order_acq_rel))
+    return fresh;
+  /* Другой поток успел создать очередь раньше. */
+  fpta_cond_destroy(&fresh->cond);
+  fpta_mutex_destroy(&fresh->mutex);
+  free(fresh);
+  return gc;
+}
+
+void fpta_group_commit_destroy(fpta_db *db) {
+  fpta_group_commit *gc =
+      db->group_commit.exchange(nullptr, std::memory_order_acq_rel);
+  if (gc) {
+    assert(gc->head == nullptr && !gc->leader_active);
+    int err = fpta_cond_destroy(&gc->cond);
+    assert(err == 0);
+    err = fpta_mutex_destroy(&gc->mutex);
+    assert(err == 0);
+    (void)err;
+    free(gc);
+  }
+}
+
+static void fpta_group_execute(fpta_db *db, fpta_write_request *batch) {
+  for (;;) {
+    fpta_txn *txn = nullptr;
+    int rc = fpta_transaction_begin(db, fpta_write, &txn);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      for (fpta_write_request *r = batch; r; r = r->next)
+        if (!r->failed)
+          r->rc = rc;
+      return;
+    }
+
+    fpta_write_request *culprit = nullptr;
+    for (fpta_write_request *r = batch; r; r = r->next) {
+      if (r->failed)
+        continue;
+      const bool savepoint = fpta_savepoint_begin(txn) == FPTA_SUCCESS;
+      rc = r->func(txn, r->ctx);
+      if (likely(savepoint)) {
+        if (likely(rc == FPTA_SUCCESS))
+          rc = fpta_savepoint_release(txn);
+        else {
+          /* Откатываем только неудачное замыкание. */
+          r->failed = true;
+          r->rc = rc;
+          rc = fpta_savepoint_rollback(txn);
+        }
+      }
+      if (unlikely(rc != FPTA_SUCCESS)) {
+        culprit = r;
+        break;
+      }
+    }
+
+    if (unlikely(culprit)) {
+      /* Откатываем транзакцию и повторяем группу без неудачного замыкания. */
+      if (!culprit->failed) {
+        culprit->failed = true;
+        culprit->rc = rc;
+      }
+      int err = fpta_transaction_end(txn, true);
+      if (unlikely(err != FPTA_SUCCESS && err != FPTA_TXN_CANCELLED)) {
+        for (fpta_write_request *r = batch; r; r = r->next)
+          if (!r->failed)
+            r->rc = err;
+        return;
+      }
+      continue;
+    }
+
+    rc = fpta_transaction_end(txn, false);
+    for (fpta_write_request *r = batch; r; r = r->next)
+      if (!r->failed)
+        r->rc = rc;
+    return;
+  }
+}
+
+int fpta_submit_write(fpta_db *db, fpta_write_func *write_func, void *ctx) {
+  if (unlikely(!fpta_db_validate(db) || !write_func))
+    return FPTA_EINVAL;
+
+  fpta_group_commit *gc = fpta_group_commit_get(db);
+  if (unlikely(gc == nullptr))
+    return FPTA_ENOMEM;
+
+  fpta_write_request request;
+  request.func = write_func;
+  request.ctx = ctx;
+  request.next = nullptr;
+  request.rc = FPTA_SUCCESS;
+  request.failed = false;
+  request.done = false;
+
+  int rc = fpta_mutex_lock(&gc->mutex);
+  if (unlikely(rc != 0))
+    return rc;
+  *gc->tail = &request;
+  gc->tail = &request.next;
+
+  while (gc->leader_active && !request.done) {
+    rc = fpta_cond_wait(&gc->cond, &gc->mutex);
+    assert(rc == 0);
+  }
+  if (request.done) {
+    rc = fpta_mutex_unlock(&gc->mutex);
+    assert(rc == 0);
+    return request.rc;
+  }
+
+  /* Становимся лидером и забираем всю очередь. */
+  gc->leader_active = true;
+  fpta_write_request *const batch = gc->head;
+  gc->head = nullptr;
+  gc->tail = &gc->head;
+  rc = fpta_mutex_unlock(&gc->mutex);
+  assert(rc == 0);
+
+  fpta_group_execute(db, batch);
+
+  rc = fpta_mutex_lock(&gc->mutex);
+  assert(rc == 0);
+  /* Владельцы запросов проверяют done только под мьютексом, поэтому
+   * запросы остаются действительными до его освобождения. */
+  for (fpta_write_request *r = batch; r; r = r->next)
+    r->done = true;
+  gc->leader_active = false;
+  rc = fpta_cond_broadcast(&gc->cond);
+  assert(rc == 0);
+  rc = fpta_mutex_unlock(&gc->mutex);
+  assert(rc == 0);
+  (void)rc;
+  return request.rc;
+}
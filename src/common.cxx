@@ -17,41 +17,85 @@
 
 #include "details.h"
 
-static int fpta_db_lock(fpta_db *db, fpta_level level) {
+/* Номер счетчика читателей схемы для текущего потока. Потоки распределяются
+ * по счетчикам по кругу, что минимизирует конкуренцию за линии кэша. */
+static unsigned fpta_schema_shard_self() {
+  static std::atomic<unsigned> sequence;
+  static thread_local unsigned self =
+      sequence.fetch_add(1, std::memory_order_relaxed) % fpta_schema_shards;
+  return self;
+}
+
+static int fpta_db_lock(fpta_db *db, fpta_level level, unsigned *shard) {
   assert(level >= fpta_read && level <= fpta_schema);
 
-  int rc;
-  if (db->alterable_schema) {
-    if (level < fpta_schema)
-      rc = fpta_rwl_sharedlock(&db->schema_rwlock);
-    else
-      rc = fpta_rwl_exclusivelock(&db->schema_rwlock);
-    assert(rc == FPTA_SUCCESS);
-  } else {
-    rc = (level < fpta_schema) ? FPTA_SUCCESS : FPTA_EPERM;
+  *shard = 0;
+  if (!db->alterable_schema)
+    return (level < fpta_schema) ? FPTA_SUCCESS : FPTA_EPERM;
+
+  if (level < fpta_schema) {
+    const unsigned self = fpta_schema_shard_self();
+    std::atomic<ptrdiff_t> &readers = db->schema_shards[self].readers;
+    for (;;) {
+      /* Пара seq_cst-операций (инкремент счетчика и проверка флага у читателя,
+       * взвод флага и чтение счетчиков у изменяющего схему) гарантирует,
+       * что хотя-бы одна из сторон увидит другую. */
+      readers.fetch_add(1, std::memory_order_seq_cst);
+      if (likely(!db->schema_altering.load(std::memory_order_seq_cst)))
+        break;
+
+      /* Схема изменяется, отступаем и ждем завершения. */
+      readers.fetch_sub(1, std::memory_order_release);
+      int rc = fpta_mutex_lock(&db->schema_mutex);
+      if (unlikely(rc != 0))
+        return rc;
+      rc = fpta_mutex_unlock(&db->schema_mutex);
+      assert(rc == 0);
+    }
+    *shard = self;
+    return FPTA_SUCCESS;
   }
 
-  return rc;
+  int rc = fpta_mutex_lock(&db->schema_mutex);
+  if (unlikely(rc != 0))
+    return rc;
+
+  /* Ждем завершения уже работающих читателей. Сумма счетчиков может быть
+   * прочитана не атомарно, но после взвода флага она может только убывать. */
+  db->schema_altering.store(true, std::memory_order_seq_cst);
+  for (unsigned attempt = 0;; ++attempt) {
+    ptrdiff_t total = 0;
+    for (const auto &it : db->schema_shards)
+      total += it.readers.load(std::memory_order_seq_cst);
+    assert(total >= 0);
+    if (total == 0)
+      break;
+    fpta_backoff(attempt);
+  }
+  return FPTA_SUCCESS;
 }
 
-static int fpta_db_unlock(fpta_db *db, fpta_level level) {
-  (void)level;
+static int fpta_db_unlock(fpta_db *db, fpta_level level, unsigned shard) {
   assert(level >= fpta_read && level <= fpta_schema);
 
-  int rc;
-  if (db->alterable_schema) {
-    rc = fpta_rwl_unlock(&db->schema_rwlock);
-  } else {
-    rc = (level < fpta_schema) ? FPTA_SUCCESS : FPTA_EOOPS;
+  if (!db->alterable_schema)
+    return (level < fpta_schema) ? FPTA_SUCCESS : FPTA_EOOPS;
+
+  if (level < fpta_schema) {
+    assert(shard < fpta_schema_shards);
+    db->schema_shards[shard].readers.fetch_sub(1, std::memory_order_release);
+    return FPTA_SUCCESS;
   }
+
+  assert(db->schema_altering.load(std::memory_order_relaxed));
+  db->schema_altering.store(false, std::memory_order_release);
+  int rc = fpta_mutex_unlock(&db->schema_mutex);
   assert(rc == FPTA_SUCCESS);
   return rc;
 }
 
 static fpta_txn *fpta_txn_alloc(fpta_db *db, fpta_level level) {
-  // TODO: use pool
-  (void)level;
-  fpta_txn *txn = (fpta_txn *)calloc(1, sizeof(fpta_txn));
+  fpta_txn *txn = static_cast<fpta_txn *>(db->txn_pool.get());
   if (likely(txn)) {
     txn->db = db;
     txn->level = level;
@@ -60,35 +104,72 @@ static fpta_txn *fpta_txn_alloc(fpta_db *db, fpta_level level) {
 }
 
 static void fpta_txn_free(fpta_db *db, fpta_txn *txn) {
-  // TODO: use pool
-  (void)db;
   if (likely(txn)) {
     assert(txn->db == db);
     txn->db = nullptr;
-    free(txn);
+    db->txn_pool.put(txn);
   }
 }
 
 fpta_cursor *fpta_cursor_alloc(fpta_db *db) {
-  // TODO: use pool
-  fpta_cursor *cursor = (fpta_cursor *)calloc(1, sizeof(fpta_cursor));
+  fpta_cursor *cursor = static_cast<fpta_cursor *>(db->cursor_pool.get());
   if (likely(cursor))
     cursor->db = db;
   return cursor;
 }
 
 void fpta_cursor_free(fpta_db *db, fpta_cursor *cursor) {
-  // TODO: use pool
   if (likely(cursor)) {
     assert(cursor->db == db);
-    (void)db;
     cursor->db = nullptr;
-    free(cursor);
+    db->cursor_pool.put(cursor);
   }
 }
 
 //----------------------------------------------------------------------------
 
+static int fpta_hsr_callback(const MDBX_env *env, const MDBX_txn *txn,
+                             mdbx_pid_t pid, mdbx_tid_t tid, uint64_t laggard,
+                             unsigned gap, size_t space,
+                             int retry) MDBX_CXX17_NOEXCEPT {
+  (void)txn;
+  fpta_db *db = static_cast<fpta_db *>(mdbx_env_get_userctx(env));
+  if (unlikely(db == nullptr || db->laggard_func == nullptr))
+    return fpta_laggard_giveup;
+
+  fpta_reader_info info;
+  info.slot = -1;
+  info.pid = intptr_t(pid);
+  info.tid = uintptr_t(tid);
+  info.txnid = laggard;
+  info.lag = gap;
+  info.retained = space;
+  return db->laggard_func(db, &info, retry, db->laggard_ctx);
+}
+
+/* Экземпляр fpta_db размещается с выравниванием на линию кэша,
+ * см fpta_schema_shard. */
+static fpta_db *fpta_db_alloc() {
+  void *ptr;
+#if defined(_WIN32) || defined(_WIN64)
+  ptr = _aligned_malloc(sizeof(fpta_db), alignof(fpta_db));
+#else
+  if (unlikely(posix_memalign(&ptr, alignof(fpta_db), sizeof(fpta_db)) != 0))
+    ptr = nullptr;
+#endif
+  if (likely(ptr != nullptr))
+    memset(ptr, 0, sizeof(fpta_db));
+  return static_cast<fpta_db *>(ptr);
+}
+
+static void fpta_db_free(fpta_db *db) {
+#if defined(_WIN32) || defined(_WIN64)
+  _aligned_free(db);
+#else
+  free(db);
+#endif
+}
+
 int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
                            const char *path, fpta_durability durability,
                            fpta_regime_flags regime_flags,
@@ -108,10 +189,20 @@ int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
   if (appcontent && unlikely(appcontent->newest < appcontent->oldest))
     return FPTA_EINVAL;
 
+  /* Дополнительные параметры читаются только если params_size их покрывает,
+   * иначе остаются нулевыми (т.е. "по умолчанию"). */
+  fpta_db_creation_params_ex_t params;
+  memset(&params, 0, sizeof(params));
   if (creation_params) {
     if (unlikely(durability == fpta_readonly ||
-                 creation_params->params_size !=
-                     sizeof(fpta_db_creation_params_t)))
+                 creation_params->params_size <
+                     sizeof(fpta_db_creation_params_t) ||
+                 creation_params->params_size >
+                     sizeof(fpta_db_creation_params_ex_t)))
+      return FPTA_EINVAL;
+    memcpy(&params, creation_params, creation_params->params_size);
+    if (unlikely((params.alloc_func == nullptr) !=
+                 (params.free_func == nullptr)))
       return FPTA_EINVAL;
   }
 
@@ -140,8 +231,10 @@ int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
       mdbx_flags |= MDBX_COALESCE;
     break;
   }
+  if (regime_flags & fpta_shared_snapshot)
+    mdbx_flags |= MDBX_NOTLS;
 
-  fpta_db *db = (fpta_db *)calloc(1, sizeof(fpta_db));
+  fpta_db *db = fpta_db_alloc();
   if (unlikely(db == nullptr))
     return FPTA_ENOMEM;
   db->regime_flags = regime_flags;
@@ -150,22 +243,33 @@ int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
   int rc;
   db->alterable_schema = alterable_schema;
   if (db->alterable_schema) {
-    rc = fpta_rwl_init(&db->schema_rwlock);
+    rc = fpta_mutex_init(&db->schema_mutex);
     if (unlikely(rc != 0)) {
-      free(db);
+      fpta_db_free(db);
       return (fpta_error)rc;
     }
   }
 
   rc = fpta_mutex_init(&db->dbi_mutex);
   if (unlikely(rc != 0)) {
-    int err = fpta_rwl_destroy(&db->schema_rwlock);
-    assert(err == 0);
-    (void)err;
-    free(db);
+    if (alterable_schema) {
+      int err = fpta_mutex_destroy(&db->schema_mutex);
+      assert(err == 0);
+      (void)err;
+    }
+    fpta_db_free(db);
     return (fpta_error)rc;
   }
 
+  rc = db->txn_pool.init(sizeof(fpta_txn), &params);
+  if (unlikely(rc != 0))
+    goto bailout_pools;
+  rc = db->cursor_pool.init(sizeof(fpta_cursor), &params);
+  if (unlikely(rc != 0)) {
+    db->txn_pool.destroy();
+    goto bailout_pools;
+  }
+
   if (unlikely(regime_flags & fpta_madness4testing)) {
     mdbx_setup_debug(MDBX_LOG_WARN,
                      MDBX_DBG_ASSERT | MDBX_DBG_AUDIT | MDBX_DBG_DUMP |
@@ -182,7 +286,13 @@ int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
   if (unlikely(rc != MDBX_SUCCESS))
     goto bailout;
 
-  rc = mdbx_env_set_maxreaders(db->mdbx_env, 42 /* FIXME */);
+  rc = mdbx_env_set_maxreaders(db->mdbx_env, params.max_readers
+                                                 ? params.max_readers
+                                                 : FPTA_DEFAULT_MAX_READERS);
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto bailout;
+
+  rc = mdbx_env_set_hsr(db->mdbx_env, fpta_hsr_callback);
   if (unlikely(rc != MDBX_SUCCESS))
     goto bailout;
 
@@ -229,6 +339,10 @@ int fpta_db_create_or_open(const fpta_appcontent_info *appcontent,
     }
     fpta_transaction_end(txn, false);
   }
+  if (likely(rc == MDBX_SUCCESS) &&
+      (durability == fpta_lazy || durability == fpta_weak) &&
+      (params.flush_threshold || params.flush_period_ms))
+    rc = fpta_flusher_start(db, params.flush_threshold, params.flush_period_ms);
   if (unlikely(rc == MDBX_SUCCESS)) {
     *pdb = db;
     return FPTA_SUCCESS;
@@ -240,16 +354,19 @@ bailout:
     assert(err == MDBX_SUCCESS);
     (void)err;
   }
+  db->cursor_pool.destroy();
+  db->txn_pool.destroy();
 
+bailout_pools:
   int err = fpta_mutex_destroy(&db->dbi_mutex);
   assert(err == 0);
   if (alterable_schema) {
-    err = fpta_rwl_destroy(&db->schema_rwlock);
+    err = fpta_mutex_destroy(&db->schema_mutex);
     assert(err == 0);
   }
   (void)err;
 
-  free(db);
+  fpta_db_free(db);
   return (fpta_error)rc;
 }
 
@@ -257,13 +374,24 @@ int fpta_db_close(fpta_db *db) {
   if (unlikely(!fpta_db_validate(db)))
     return FPTA_EINVAL;
 
-  int rc = fpta_db_lock(db, db->alterable_schema ? fpta_schema : fpta_write);
+  /* Прерываем прогрев до захвата блокировки, так как фоновый поток
+   * может удерживать транзакцию чтения. */
+  fpta_prewarm_destroy(db);
+
+  unsigned shard;
+  int rc = fpta_db_lock(db, db->alterable_schema ? fpta_schema : fpta_write,
+                        &shard);
   if (unlikely(rc != 0))
     return (fpta_error)rc;
 
+  /* Останавливаем фоновую фиксацию до закрытия БД, при этом последние
+   * изменения будут сохранены внутри mdbx_env_close_ex(). */
+  fpta_flusher_stop(db);
+
   rc = fpta_mutex_lock(&db->dbi_mutex);
   if (unlikely(rc != 0)) {
-    int err = fpta_db_unlock(db, fpta_schema);
+    int err = fpta_db_unlock(
+        db, db->alterable_schema ? fpta_schema : fpta_write, shard);
     assert(err == 0);
     (void)err;
     return (fpta_error)rc;
@@ -278,15 +406,19 @@ int fpta_db_close(fpta_db *db) {
   err = fpta_mutex_destroy(&db->dbi_mutex);
   assert(err == 0);
 
-  err = fpta_db_unlock(db, db->alterable_schema ? fpta_schema : fpta_write);
+  err = fpta_db_unlock(db, db->alterable_schema ? fpta_schema : fpta_write,
+                       shard);
   assert(err == 0);
+  fpta_group_commit_destroy(db);
+  db->cursor_pool.destroy();
+  db->txn_pool.destroy();
   if (db->alterable_schema) {
-    err = fpta_rwl_destroy(&db->schema_rwlock);
+    err = fpta_mutex_destroy(&db->schema_mutex);
     assert(err == 0);
   }
   (void)err;
 
-  free(db);
+  fpta_db_free(db);
   return (fpta_error)rc;
 }
 
@@ -373,7 +505,8 @@ int fpta_transaction_begin(fpta_db *db, fpta_level level, fpta_txn **ptxn) {
   if (unlikely(!fpta_db_validate(db)))
     return FPTA_EINVAL;
 
-  int err = fpta_db_lock(db, level);
+  unsigned shard;
+  int err = fpta_db_lock(db, level, &shard);
   if (unlikely(err != 0))
     return err;
 
@@ -381,6 +514,7 @@ int fpta_transaction_begin(fpta_db *db, fpta_level level, fpta_txn **ptxn) {
   fpta_txn *txn = fpta_txn_alloc(db, level);
   if (unlikely(txn == nullptr))
     goto bailout;
+  txn->schema_shard = uint8_t(shard);
 
   rc = mdbx_txn_begin(db->mdbx_env, nullptr,
                       (level == fpta_read) ? MDBX_TXN_RDONLY
@@ -415,7 +549,7 @@ int fpta_transaction_begin(fpta_db *db, fpta_level level, fpta_txn **ptxn) {
   rc = fpta_internal_abort(txn, rc, false);
 
 bailout:
-  err = fpta_db_unlock(db, level);
+  err = fpta_db_unlock(db, level, shard);
   assert(err == 0);
   (void)err;
   fpta_txn_free(db, txn);
@@ -423,6 +557,10 @@ bailout:
   return rc;
 }
 
+static __inline bool fpta_savepoint_active(const fpta_txn *txn);
+static void fpta_savepoint_unwind(fpta_txn *txn);
+static void fpta_savepoint_reap(fpta_txn *txn);
+
 int fpta_transaction_end(fpta_txn *txn, bool abort) {
   int rc = fpta_txn_validate(txn, fpta_read);
   if (unlikely(rc != FPTA_SUCCESS)) {
@@ -432,10 +570,31 @@ int fpta_transaction_end(fpta_txn *txn, bool abort) {
   }
 
   if (txn->level == fpta_read) {
-    // TODO: reuse txn with mdbx_txn_reset(), but pool needed...
+    if (unlikely(txn->parked)) {
+      /* Блокировка схемы не удерживается, а сброшенная транзакция чтения
+       * освобождается без возобновления. Однако при MDBX_TXN_CHECKOWNER
+       * и без MDBX_NOTLS libmdbx отвергает её как не имеющую владельца,
+       * тогда транзакция возобновляется (в уже занятом слоте читателя)
+       * и тут-же прерывается, без обращений к схеме и таблицам. */
+      rc = mdbx_txn_abort(txn->mdbx_txn);
+      if (unlikely(rc == MDBX_BAD_TXN)) {
+        rc = mdbx_txn_renew(txn->mdbx_txn);
+        if (likely(rc == MDBX_SUCCESS))
+          rc = mdbx_txn_abort(txn->mdbx_txn);
+      }
+      txn->mdbx_txn = nullptr;
+      fpta_txn_free(txn->db, txn);
+      return (fpta_error)rc;
+    }
     rc = mdbx_txn_commit(txn->mdbx_txn);
     abort = false;
-  } else if (likely(!abort)) {
+  } else if (fpta_savepoint_active(txn)) {
+    /* Незавершенные точки сохранения фиксируются или прерываются
+     * вместе с транзакцией. */
+    fpta_savepoint_unwind(txn);
+  }
+
+  if (txn->level > fpta_read && likely(!abort)) {
     /* Текущая версия libmdbx либо фиксирует транзакцию,
      * либо самостоятельно её прерывает, т.е. в любом случае mdbx_txn_commit()
      * завершает транзакцию */
@@ -449,7 +608,14 @@ int fpta_transaction_end(fpta_txn *txn, bool abort) {
 
 cancelled:
   txn->mdbx_txn = nullptr;
-  int err = fpta_db_unlock(txn->db, txn->level);
+  fpta_savepoint_reap(txn);
+  if (unlikely(txn->shared))
+    fpta_dbicache_unshare(txn);
+  if (unlikely(txn->managed)) {
+    free(txn->managed);
+    txn->managed = nullptr;
+  }
+  int err = fpta_db_unlock(txn->db, txn->level, txn->schema_shard);
   assert(err == 0);
   (void)err;
   fpta_txn_free(txn->db, txn);
@@ -495,44 +661,19 @@ int
   return (FPTA_ENABLE_ABORT_ON_PANIC) ? 0 : -1;
 }
 
-int fpta_internal_abort(fpta_txn *txn, int errnum, bool txn_maybe_dead) {
-  /* Некоторые ошибки (например переполнение БД) могут происходить когда
-   * мы выполнили лишь часть операций. В таких случаях можно лишь
-   * прервать/откатить всю транзакцию, что и делает эта функция.
-   *
-   * Однако, могут быть ошибки отката транзакции, что потенциально является
-   * более серьезной проблемой. */
-
-  if (txn->level > fpta_read) {
-    /* Чистим кеш dbi-хендлов покалеченных таблиц */
-    bool dbi_locked = false;
-    fpta_db *db = txn->db;
-    for (size_t i = 0; i < fpta_dbi_cache_size; ++i) {
-      const MDBX_dbi dbi = db->dbi_handles[i];
-      const fpta_shove_t shove = db->dbi_shoves[i];
-      if (shove && dbi) {
-        unsigned tbl_flags = 0, tbl_state = 0;
-        int err = mdbx_dbi_flags_ex(txn->mdbx_txn, dbi, &tbl_flags, &tbl_state);
-        if (err != MDBX_SUCCESS || (tbl_state & MDBX_DBI_CREAT)) {
-          if (!dbi_locked && txn->level < fpta_schema) {
-            err = fpta_mutex_lock(&db->dbi_mutex);
-            if (unlikely(err != 0))
-              return err;
-            dbi_locked = true;
-          }
-
-          if (shove == db->dbi_shoves[i] && dbi == db->dbi_handles[i]) {
-            db->dbi_shoves[i] = 0;
-            db->dbi_handles[i] = 0;
-          }
-        }
-      }
-    }
-
-    if (db->schema_dbi > 0) {
+/* Чистит кеш dbi-хендлов таблиц, которые были созданы или открыты
+ * в откатываемой транзакции (либо точке сохранения), и поэтому станут
+ * недействительными после отката. */
+static int fpta_dbicache_invalidate(fpta_txn *txn) {
+  assert(txn->level > fpta_read);
+  bool dbi_locked = false;
+  fpta_db *db = txn->db;
+  for (size_t i = 0; i < fpta_dbi_cache_size; ++i) {
+    const MDBX_dbi dbi = db->dbi_handles[i];
+    const fpta_shove_t shove = db->dbi_shoves[i];
+    if (shove && dbi) {
       unsigned tbl_flags = 0, tbl_state = 0;
-      int err = mdbx_dbi_flags_ex(txn->mdbx_txn, db->schema_dbi, &tbl_flags,
-                                  &tbl_state);
+      int err = mdbx_dbi_flags_ex(txn->mdbx_txn, dbi, &tbl_flags, &tbl_state);
       if (err != MDBX_SUCCESS || (tbl_state & MDBX_DBI_CREAT)) {
         if (!dbi_locked && txn->level < fpta_schema) {
           err = fpta_mutex_lock(&db->dbi_mutex);
@@ -540,17 +681,281 @@ int fpta_internal_abort(fpta_txn *txn, int errnum, bool txn_maybe_dead) {
             return err;
           dbi_locked = true;
         }
-        db->schema_dbi = 0;
+
+        if (shove == db->dbi_shoves[i] && dbi == db->dbi_handles[i]) {
+          db->dbi_shoves[i] = 0;
+          db->dbi_handles[i] = 0;
+        }
       }
     }
+  }
 
-    if (dbi_locked) {
-      int err = fpta_mutex_unlock(&db->dbi_mutex);
-      assert(err == 0);
-      (void)err;
+  if (db->schema_dbi > 0) {
+    unsigned tbl_flags = 0, tbl_state = 0;
+    int err = mdbx_dbi_flags_ex(txn->mdbx_txn, db->schema_dbi, &tbl_flags,
+                                &tbl_state);
+    if (err != MDBX_SUCCESS || (tbl_state & MDBX_DBI_CREAT)) {
+      if (!dbi_locked && txn->level < fpta_schema) {
+        err = fpta_mutex_lock(&db->dbi_mutex);
+        if (unlikely(err != 0))
+          return err;
+        dbi_locked = true;
+      }
+      db->schema_dbi = 0;
     }
   }
 
+  if (dbi_locked) {
+    int err = fpta_mutex_unlock(&db->dbi_mutex);
+    assert(err == 0);
+    (void)err;
+  }
+  return FPTA_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
+/* Точки сохранения реализованы посредством вложенных транзакций libmdbx.
+ * Для каждой точки сохранения запускается дочерняя транзакция, которая
+ * подменяет txn->mdbx_txn, а в её пользовательском контексте сохраняется
+ * состояние для восстановления при откате.
+ *
+ * Курсоры, открытые до начала точки сохранения, libmdbx переносит во
+ * вложенную транзакцию и возвращает обратно при её завершении. Курсоры,
+ * открытые внутри точки сохранения, после её завершения отвязываются
+ * libmdbx, поэтому при фиксации они перепривязываются к родительской
+ * транзакции с сохранением позиции. При откате все курсоры транзакции
+ * отменяются, так как их позиции и прочитанные строки могут относиться к
+ * откаченным изменениям. */
+struct fpta_savepoint {
+  MDBX_txn *parent;
+  uint64_t schema_tsn;
+};
+
+void fpta_cursor_attach(fpta_cursor *cursor) {
+  fpta_txn *txn = cursor->txn;
+  assert(cursor->txn_pprev == nullptr);
+  cursor->savepoint = txn->savepoints;
+  cursor->txn_next = txn->cursors;
+  if (txn->cursors)
+    txn->cursors->txn_pprev = &cursor->txn_next;
+  cursor->txn_pprev = &txn->cursors;
+  txn->cursors = cursor;
+}
+
+void fpta_cursor_detach(fpta_cursor *cursor) {
+  /* Курсоры рабочих потоков разделяемой транзакции не регистрируются,
+   * поэтому список затрагивается только для зарегистрированных курсоров. */
+  if (cursor->txn_pprev) {
+    *cursor->txn_pprev = cursor->txn_next;
+    if (cursor->txn_next)
+      cursor->txn_next->txn_pprev = cursor->txn_pprev;
+    cursor->txn_next = nullptr;
+    cursor->txn_pprev = nullptr;
+  }
+}
+
+/* Закрывает курсоры, закрытие которых было отложено до завершения
+ * вложенных транзакций, в которые libmdbx перенес эти курсоры. */
+static void fpta_savepoint_reap(fpta_txn *txn) {
+  for (fpta_cursor *next, *cursor = txn->cursors; cursor; cursor = next) {
+    next = cursor->txn_next;
+    if (cursor->closed && cursor->savepoint >= txn->savepoints) {
+      fpta_cursor_detach(cursor);
+      mdbx_cursor_close(cursor->mdbx_cursor);
+      fpta_cursor_free(cursor->db, cursor);
+    }
+  }
+}
+
+static void fpta_savepoint_cancel(fpta_txn *txn) {
+  for (fpta_cursor *cursor = txn->cursors; cursor; cursor = cursor->txn_next)
+    cursor->cancelled = true;
+}
+
+static __inline fpta_savepoint *fpta_savepoint_top(const fpta_txn *txn) {
+  return static_cast<fpta_savepoint *>(mdbx_txn_get_userctx(txn->mdbx_txn));
+}
+
+static __inline bool fpta_savepoint_active(const fpta_txn *txn) {
+  return txn->mdbx_txn && fpta_savepoint_top(txn) != nullptr;
+}
+
+static int fpta_savepoint_push(fpta_txn *txn) {
+  fpta_savepoint *sp = (fpta_savepoint *)malloc(sizeof(fpta_savepoint));
+  if (unlikely(sp == nullptr))
+    return FPTA_ENOMEM;
+
+  MDBX_txn *nested = nullptr;
+  int rc = mdbx_txn_begin(txn->db->mdbx_env, txn->mdbx_txn, MDBX_TXN_READWRITE,
+                          &nested);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = mdbx_txn_set_userctx(nested, sp);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    if (nested)
+      mdbx_txn_abort(nested);
+    free(sp);
+    return rc;
+  }
+
+  sp->parent = txn->mdbx_txn;
+  sp->schema_tsn = txn->schema_tsn_;
+  txn->mdbx_txn = nested;
+  txn->savepoints += 1;
+  return FPTA_SUCCESS;
+}
+
+static int fpta_savepoint_pop(fpta_txn *txn, bool rollback) {
+  fpta_savepoint *const sp = fpta_savepoint_top(txn);
+  assert(sp != nullptr && txn->savepoints > 0);
+  const unsigned depth = txn->savepoints;
+
+  /* Позиции курсоров, открытых внутри точки сохранения, указывают внутрь
+   * вложенной транзакции, поэтому ключи копируются до её фиксации. */
+  size_t count = 0;
+  fpta_cursor_position *positions = nullptr;
+  if (!rollback) {
+    for (fpta_cursor *cursor = txn->cursors; cursor;
+         cursor = cursor->txn_next)
+      if (cursor->savepoint == depth)
+        count += 1;
+    if (count) {
+      positions =
+          (fpta_cursor_position *)calloc(count, sizeof(fpta_cursor_position));
+      size_t i = 0;
+      for (fpta_cursor *cursor = txn->cursors; cursor;
+           cursor = cursor->txn_next) {
+        if (cursor->savepoint != depth)
+          continue;
+        if (unlikely(positions == nullptr) ||
+            (!cursor->cancelled &&
+             fpta_cursor_position_save(cursor, &positions[i]) !=
+                 FPTA_SUCCESS))
+          cursor->cancelled = true;
+        i += 1;
+      }
+    }
+  }
+
+  int rc = rollback ? mdbx_txn_abort(txn->mdbx_txn)
+                    : mdbx_txn_commit(txn->mdbx_txn);
+  /* В любом случае вложенная транзакция завершена (при ошибке фиксации
+   * libmdbx прерывает её самостоятельно). */
+  txn->mdbx_txn = sp->parent;
+  txn->savepoints = depth - 1;
+  if (unlikely(rc == MDBX_RESULT_TRUE))
+    rc = FPTA_TXN_CANCELLED;
+  if (rollback || rc != MDBX_SUCCESS) {
+    /* Восстанавливаем версию схемы и чистим кеш dbi-хендлов, которые
+     * были созданы или открыты после начала точки сохранения. */
+    txn->schema_tsn_ = sp->schema_tsn;
+    int err = fpta_dbicache_invalidate(txn);
+    if (rc == MDBX_SUCCESS)
+      rc = err;
+    fpta_savepoint_cancel(txn);
+  } else if (count) {
+    size_t i = 0;
+    for (fpta_cursor *cursor = txn->cursors; cursor;
+         cursor = cursor->txn_next) {
+      if (cursor->savepoint != depth)
+        continue;
+      cursor->savepoint = depth - 1;
+      if (!cursor->cancelled) {
+        int err = mdbx_cursor_bind(txn->mdbx_txn, cursor->mdbx_cursor,
+                                   cursor->idx_handle);
+        if (likely(err == MDBX_SUCCESS))
+          err = fpta_cursor_position_restore(cursor, &positions[i]);
+        if (unlikely(err != FPTA_SUCCESS))
+          cursor->cancelled = true;
+      }
+      i += 1;
+    }
+  }
+
+  for (size_t i = 0; positions && i < count; ++i)
+    free(positions[i].buffer);
+  free(positions);
+  free(sp);
+  fpta_savepoint_reap(txn);
+  return rc;
+}
+
+/* Освобождает все точки сохранения без завершения вложенных транзакций,
+ * которые будут зафиксированы или прерваны вместе с родительской. */
+static void fpta_savepoint_unwind(fpta_txn *txn) {
+  while (fpta_savepoint_active(txn)) {
+    fpta_savepoint *const sp = fpta_savepoint_top(txn);
+    txn->mdbx_txn = sp->parent;
+    txn->schema_tsn_ = sp->schema_tsn;
+    free(sp);
+  }
+  txn->savepoints = 0;
+}
+
+int fpta_savepoint_begin(fpta_txn *txn) {
+  int rc = fpta_txn_validate(txn, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  unsigned env_flags;
+  rc = mdbx_env_get_flags(txn->db->mdbx_env, &env_flags);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  /* libmdbx не поддерживает вложенные транзакции в режиме MDBX_WRITEMAP */
+  if (unlikely(env_flags & MDBX_WRITEMAP))
+    return FPTA_ENOIMP;
+
+  return fpta_savepoint_push(txn);
+}
+
+int fpta_savepoint_rollback(fpta_txn *txn) {
+  int rc = fpta_txn_validate(txn, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (unlikely(!fpta_savepoint_active(txn)))
+    return FPTA_EPERM;
+
+  return fpta_savepoint_pop(txn, true);
+}
+
+int fpta_savepoint_release(fpta_txn *txn) {
+  int rc = fpta_txn_validate(txn, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (unlikely(!fpta_savepoint_active(txn)))
+    return FPTA_EPERM;
+
+  return fpta_savepoint_pop(txn, false);
+}
+
+int fpta_internal_abort(fpta_txn *txn, int errnum, bool txn_maybe_dead) {
+  /* Некоторые ошибки (например переполнение БД) могут происходить когда
+   * мы выполнили лишь часть операций. В таких случаях можно лишь
+   * прервать/откатить всю транзакцию, что и делает эта функция.
+   *
+   * Однако, могут быть ошибки отката транзакции, что потенциально является
+   * более серьезной проблемой. */
+
+  if (txn->level > fpta_read) {
+    if (unlikely(fpta_savepoint_active(txn))) {
+      /* Внутри точки сохранения откатываем только её изменения,
+       * а сама точка сохранения возобновляется. */
+      int rc = fpta_savepoint_pop(txn, true);
+      if (likely(rc == FPTA_SUCCESS)) {
+        rc = fpta_savepoint_push(txn);
+        if (likely(rc == FPTA_SUCCESS))
+          return errnum;
+      }
+      /* Не удалось, прерываем транзакцию целиком. */
+      fpta_savepoint_unwind(txn);
+    }
+
+    /* Чистим кеш dbi-хендлов покалеченных таблиц */
+    int err = fpta_dbicache_invalidate(txn);
+    if (unlikely(err != FPTA_SUCCESS))
+      return err;
+  }
+
   int rc = mdbx_txn_abort(txn->mdbx_txn);
   if (unlikely(rc != MDBX_SUCCESS)) {
     switch (rc) {
@@ -612,7 +1017,7 @@ int fpta_transaction_restart(fpta_txn *txn) {
   if (unlikely(err != MDBX_SUCCESS))
     return err;
 
-  if (unlikely(txn->level != fpta_read))
+  if (unlikely(txn->level != fpta_read || txn->shared))
     return FPTA_EPERM;
 
 #ifndef NDEBUG
@@ -645,6 +1050,86 @@ int fpta_transaction_restart(fpta_txn *txn) {
   }
 }
 
+int fpta_transaction_park(fpta_txn *txn) {
+  int err = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+
+  if (unlikely(txn->level != fpta_read || txn->parked || txn->shared ||
+               txn->managed))
+    return FPTA_EPERM;
+  /* Открытые курсоры ссылаются на страницы освобождаемого снимка. */
+  if (unlikely(txn->cursors != nullptr))
+    return FPTA_EPERM;
+
+  err = mdbx_txn_reset(txn->mdbx_txn);
+  if (unlikely(err != MDBX_SUCCESS))
+    return fpta_internal_abort(txn, err);
+
+  txn->parked = true;
+  err = fpta_db_unlock(txn->db, fpta_read, txn->schema_shard);
+  assert(err == 0);
+  return err;
+}
+
+int fpta_transaction_share(fpta_txn *txn) {
+  int err = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+
+  if (unlikely(txn->level != fpta_read || txn->parked || txn->managed))
+    return FPTA_EPERM;
+  if (txn->shared)
+    return FPTA_SUCCESS;
+
+  unsigned env_flags;
+  err = mdbx_env_get_flags(txn->db->mdbx_env, &env_flags);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+  /* Без MDBX_NOTLS транзакция чтения привязана к запустившему её потоку. */
+  if (unlikely((env_flags & MDBX_NOTLS) == 0))
+    return FPTA_EFLAG;
+
+  return fpta_dbicache_share(txn);
+}
+
+int fpta_transaction_resume(fpta_txn *txn) {
+  int err = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+
+  if (unlikely(txn->level != fpta_read || !txn->parked))
+    return FPTA_EPERM;
+
+  unsigned shard;
+  err = fpta_db_lock(txn->db, fpta_read, &shard);
+  if (unlikely(err != 0))
+    return err;
+  txn->schema_shard = uint8_t(shard);
+  txn->parked = false;
+
+  for (;;) {
+    err = mdbx_txn_renew(txn->mdbx_txn);
+    if (unlikely(err != MDBX_SUCCESS))
+      return fpta_internal_abort(txn, err, true);
+
+    txn->db_version = mdbx_txn_id(txn->mdbx_txn);
+    err = fpta_open_schema(txn);
+    if (unlikely(err != MDBX_SUCCESS))
+      return fpta_internal_abort(txn, err);
+
+    err = fpta_dbicache_cleanup(txn, nullptr);
+    if (likely(err == MDBX_SUCCESS))
+      return FPTA_SUCCESS;
+    if (err != FPTA_SCHEMA_CHANGED)
+      return fpta_internal_abort(txn, err);
+
+    err = mdbx_txn_reset(txn->mdbx_txn);
+    if (unlikely(err != MDBX_SUCCESS))
+      return fpta_internal_abort(txn, err, true);
+  }
+}
+
 int fpta_transaction_lag_ex(fpta_txn *txn, size_t *lag, size_t *retired,
                             size_t *left) {
 
@@ -704,6 +1189,180 @@ int fpta_enough_for_restart(fpta_txn *txn, size_t lag_threshold,
 
 //----------------------------------------------------------------------------
 
+int fpta_managed_checkpoint(fpta_txn *txn, bool force) {
+  fpta_txn_managed *const managed = txn->managed;
+  managed->countdown = fpta_managed_check_interval;
+
+  MDBX_txn_info info;
+  int rc = mdbx_txn_info(txn->mdbx_txn, &info, false);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (info.txn_reader_lag == 0)
+    /* Снимок актуален, перезапуск ничего не даст. */
+    return FPTA_SUCCESS;
+  if (!force && info.txn_reader_lag < managed->lag_threshold &&
+      info.txn_space_retired < managed->retired_threshold &&
+      info.txn_space_leftover +
+              (info.txn_space_limit_hard - info.txn_space_limit_soft) >
+          managed->space_threshold)
+    return FPTA_SUCCESS;
+
+  /* Позиции курсоров указывают внутрь текущего снимка,
+   * поэтому ключи копируются до перезапуска транзакции. */
+  size_t count = 0;
+  for (fpta_cursor *cursor = txn->cursors; cursor; cursor = cursor->txn_next)
+    count += 1;
+
+  fpta_cursor_position *positions = nullptr;
+  if (count) {
+    positions =
+        (fpta_cursor_position *)calloc(count, sizeof(fpta_cursor_position));
+    if (unlikely(positions == nullptr))
+      return FPTA_ENOMEM;
+  }
+
+  size_t i = 0;
+  for (fpta_cursor *cursor = txn->cursors; cursor;
+       cursor = cursor->txn_next, ++i) {
+    rc = fpta_cursor_position_save(cursor, &positions[i]);
+    if (unlikely(rc != FPTA_SUCCESS))
+      goto bailout;
+  }
+
+  {
+    const uint64_t schema_tsn = txn->schema_tsn();
+    rc = fpta_transaction_restart(txn);
+    if (unlikely(rc != FPTA_SUCCESS))
+      goto bailout;
+
+    i = 0;
+    for (fpta_cursor *cursor = txn->cursors; cursor;
+         cursor = cursor->txn_next, ++i) {
+      if (unlikely(txn->schema_tsn() != schema_tsn)) {
+        /* Схема изменилась, курсоры подлежат переоткрытию. */
+        cursor->set_poor();
+        rc = FPTA_SCHEMA_CHANGED;
+        continue;
+      }
+      int err = mdbx_cursor_renew(txn->mdbx_txn, cursor->mdbx_cursor);
+      if (likely(err == MDBX_SUCCESS))
+        err = fpta_cursor_position_restore(cursor, &positions[i]);
+      if (unlikely(err != FPTA_SUCCESS)) {
+        cursor->set_poor();
+        rc = err;
+      }
+    }
+  }
+
+bailout:
+  for (i = 0; i < count; ++i)
+    free(positions[i].buffer);
+  free(positions);
+  return rc;
+}
+
+int fpta_transaction_autorestart(fpta_txn *txn, size_t lag_threshold,
+                                 size_t retired_threshold,
+                                 size_t space_threshold) {
+  int err = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+
+  if (unlikely(txn->level != fpta_read || txn->parked || txn->shared))
+    return FPTA_EPERM;
+
+  if (!lag_threshold && !retired_threshold && !space_threshold) {
+    free(txn->managed);
+    txn->managed = nullptr;
+    return FPTA_SUCCESS;
+  }
+
+  if (!txn->managed) {
+    txn->managed = (fpta_txn_managed *)calloc(1, sizeof(fpta_txn_managed));
+    if (unlikely(txn->managed == nullptr))
+      return FPTA_ENOMEM;
+  }
+
+  /* Нулевые значения порогов отключают соответствующие проверки. */
+  txn->managed->lag_threshold = lag_threshold ? lag_threshold : SIZE_MAX;
+  txn->managed->retired_threshold =
+      retired_threshold ? retired_threshold : SIZE_MAX;
+  txn->managed->space_threshold = space_threshold;
+  txn->managed->countdown = fpta_managed_check_interval;
+  return FPTA_SUCCESS;
+}
+
+int fpta_transaction_checkpoint(fpta_txn *txn) {
+  int err = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+
+  if (unlikely(!txn->managed))
+    return FPTA_EPERM;
+
+  return fpta_managed_checkpoint(txn, true);
+}
+
+//----------------------------------------------------------------------------
+
+struct fpta_readers_enum_ctx {
+  fpta_reader_enum_func *enum_func;
+  void *ctx;
+  unsigned active;
+};
+
+static int fpta_readers_enum_proxy(void *ctx, int num, int slot,
+                                   mdbx_pid_t pid, mdbx_tid_t thread,
+                                   uint64_t txnid, uint64_t lag,
+                                   size_t bytes_used,
+                                   size_t bytes_retained) MDBX_CXX17_NOEXCEPT {
+  (void)num;
+  (void)bytes_used;
+  if (txnid == 0)
+    /* Слот зарегистрирован за потоком, но транзакция чтения не активна. */
+    return MDBX_SUCCESS;
+
+  fpta_readers_enum_ctx *proxy = static_cast<fpta_readers_enum_ctx *>(ctx);
+  proxy->active += 1;
+  fpta_reader_info info;
+  info.slot = slot;
+  info.pid = intptr_t(pid);
+  info.tid = uintptr_t(thread);
+  info.txnid = txnid;
+  info.lag = lag;
+  info.retained = bytes_retained;
+  /* Ненулевой результат прерывает перечисление внутри mdbx_reader_list(). */
+  return proxy->enum_func(proxy->ctx, &info);
+}
+
+int fpta_db_readers(fpta_db *db, fpta_reader_enum_func *enum_func,
+                    void *ctx) {
+  if (unlikely(!fpta_db_validate(db) || !enum_func))
+    return FPTA_EINVAL;
+
+  fpta_readers_enum_ctx proxy;
+  proxy.enum_func = enum_func;
+  proxy.ctx = ctx;
+  proxy.active = 0;
+  const int rc = mdbx_reader_list(db->mdbx_env, fpta_readers_enum_proxy, &proxy);
+  if (rc == MDBX_RESULT_TRUE || (rc == MDBX_SUCCESS && proxy.active == 0))
+    return FPTA_NODATA;
+  return rc;
+}
+
+int fpta_db_set_laggard_handler(fpta_db *db, fpta_laggard_func *laggard_func,
+                                void *ctx) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  db->laggard_func = laggard_func;
+  db->laggard_ctx = ctx;
+  return FPTA_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
 int fpta_db_info(const fpta_db *db, const fpta_txn *txn, fpta_db_stat_t *stat) {
   int err;
   if (unlikely((!db && !txn) || !stat))
@@ -765,6 +1424,9 @@ int fpta_db_info(const fpta_db *db, const fpta_txn *txn, fpta_db_stat_t *stat) {
     stat->regime_flags |= fpta_frendly4writeback;
   if (mdbx_info.mi_mode & MDBX_COALESCE)
     stat->regime_flags |= fpta_frendly4compaction;
+  /* MDBX_NOTLS не является режимом БД и не отражается в mi_mode. */
+  stat->regime_flags |=
+      (db ? db : txn->db)->regime_flags & fpta_shared_snapshot;
 
   stat->alterable_schema = (db ? db : txn->db)->alterable_schema;
   return FPTA_SUCCESS;
@@ -17,32 +17,56 @@
 
 #include "details.h"
 
+#include <vector>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#endif
+
 static int fpta_cursor_seek(fpta_cursor *cursor,
                             const MDBX_cursor_op mdbx_seek_op,
                             const MDBX_cursor_op mdbx_step_op,
                             const MDBX_val *mdbx_seek_key,
-                            const MDBX_val *mdbx_seek_data);
+                            const MDBX_val *mdbx_seek_data,
+                            MDBX_val *mdbx_found_data = nullptr);
 
 int fpta_cursor_close(fpta_cursor *cursor) {
   int rc = fpta_cursor_validate(cursor, fpta_read);
 
   if (likely(rc == FPTA_SUCCESS) || rc == FPTA_TXN_CANCELLED) {
+    free(cursor->ranges);
+    cursor->ranges = nullptr;
+    fpta_filter_program_destroy(cursor->filter_program);
+    rc = FPTA_SUCCESS;
+    if (unlikely(cursor->savepoint < cursor->txn->savepoints)) {
+      /* libmdbx не позволяет закрыть курсор объемлющей транзакции внутри
+       * вложенной, поэтому закрытие откладывается до завершения точки
+       * сохранения, см fpta_savepoint_reap(). */
+      cursor->closed = true;
+      return rc;
+    }
+    fpta_cursor_detach(cursor);
     mdbx_cursor_close(cursor->mdbx_cursor);
     fpta_cursor_free(cursor->db, cursor);
-    rc = FPTA_SUCCESS;
   }
 
   return rc;
 }
 
-int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
-                     fpta_value range_to, fpta_filter *filter,
-                     fpta_cursor_options options, fpta_cursor **pcursor) {
-  if (unlikely(pcursor == nullptr))
-    return FPTA_EINVAL;
+/* Открывает курсор в памяти place (например, на стеке вызывающей функции),
+ * либо при нулевом place размещает его в пуле курсоров БД. Курсор в памяти
+ * place закрывается посредством fpta_cursor_release(). */
+int fpta_cursor_setup(fpta_txn *txn, fpta_name *column_id,
+                      fpta_value range_from, fpta_value range_to,
+                      fpta_filter *filter, fpta_cursor_options options,
+                      fpta_cursor *place, fpta_cursor **pcursor,
+                      bool pushdown) {
+  assert(pcursor != nullptr);
   *pcursor = nullptr;
 
-  switch (options & ~(fpta_dont_fetch | fpta_zeroed_range_is_point)) {
+  switch (options & ~(fpta_dont_fetch | fpta_zeroed_range_is_point |
+                      fpta_keys_only | fpta_readahead |
+                      fpta_adaptive_filter)) {
   default:
     return FPTA_EFLAG;
 
@@ -92,6 +116,9 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
   }
 
   if (filter != fpta_filter_any) {
+    if (unlikely(options & fpta_keys_only))
+      /* фильтр требует чтения строк */
+      return FPTA_EFLAG;
     rc = fpta_name_refresh_filter(column_id->column.table, filter);
     if (unlikely(rc != FPTA_SUCCESS))
       return rc;
@@ -105,20 +132,40 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
         return rc;
       rc = FPTA_SUCCESS;
     }
+    /* Сужаем диапазон по условиям фильтра на ключевую колонку, кроме
+     * точечных выборок и составных индексов. */
+    if (pushdown && filter != fpta_filter_any &&
+        filter != fpta_filter_none && range_from.type != fpta_epsilon &&
+        range_to.type != fpta_epsilon &&
+        !(options & fpta_zeroed_range_is_point) &&
+        !fpta_is_composite(column_id->shove))
+      fpta_filter_pushdown(txn, idx_handle, column_id->shove, filter,
+                           range_from, range_to);
   }
 
   if (unlikely(filter == fpta_filter_none) && !(options & fpta_dont_fetch))
     return FPTA_NODATA;
 
   fpta_db *db = txn->db;
-  fpta_cursor *cursor = fpta_cursor_alloc(db);
-  if (unlikely(cursor == nullptr))
-    return FPTA_ENOMEM;
+  fpta_cursor *cursor;
+  if (place) {
+    memset(static_cast<void *>(place), 0, sizeof(fpta_cursor));
+    cursor = place;
+    cursor->db = db;
+  } else {
+    cursor = fpta_cursor_alloc(db);
+    if (unlikely(cursor == nullptr))
+      return FPTA_ENOMEM;
+  }
 
   cursor->options = options & /* Сбрасываем флажок fpta_zeroed_range_is_point,
                                  чтобы в дальнейшем использовать его только как
                                  признак необходимости epsilon-обработки */
                     ~fpta_zeroed_range_is_point;
+  if (txn->level > fpta_read)
+    /* В пишущих транзакциях измененные страницы размещаются вне отображения
+     * БД в память, поэтому подсказки упреждающего чтения не выдаются. */
+    cursor->options &= ~fpta_readahead;
   cursor->txn = txn;
   cursor->table_id = table_id;
   cursor->column_number = column_id->column.num;
@@ -209,24 +256,345 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
   }
 
   cursor->filter = filter;
+  rc = fpta_filter_compile(filter, cursor->filter_program,
+                           (options & fpta_adaptive_filter) != 0);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
   if ((options & fpta_dont_fetch) == 0) {
     rc = fpta_cursor_move(cursor, fpta_first);
     if (unlikely(rc != MDBX_SUCCESS))
       goto bailout;
   }
 
+  if (!txn->shared /* курсоры рабочих потоков не регистрируются */)
+    fpta_cursor_attach(cursor);
   *pcursor = cursor;
   return FPTA_SUCCESS;
 
 bailout:
-  if (cursor->mdbx_cursor)
+  if (cursor->mdbx_cursor) {
     mdbx_cursor_close(cursor->mdbx_cursor);
-  fpta_cursor_free(db, cursor);
+    cursor->mdbx_cursor = nullptr;
+  }
+  fpta_filter_program_destroy(cursor->filter_program);
+  if (!place)
+    fpta_cursor_free(db, cursor);
   return rc;
 }
 
+int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+                     fpta_value range_to, fpta_filter *filter,
+                     fpta_cursor_options options, fpta_cursor **pcursor) {
+  if (unlikely(pcursor == nullptr))
+    return FPTA_EINVAL;
+  return fpta_cursor_setup(txn, column_id, range_from, range_to, filter,
+                           options, nullptr, pcursor);
+}
+
+/* Переносит границы диапазона index в range_from_key и range_to_key,
+ * делая его активным для fpta_cursor_seek(). */
+void fpta_cursor_range_activate(fpta_cursor *cursor, unsigned index) {
+  assert(index < cursor->ranges_count);
+  const fpta_cursor_range &range = cursor->ranges[index];
+  cursor->range_index = index;
+  cursor->range_from_key.mdbx = range.from;
+  cursor->range_to_key.mdbx = range.to;
+  cursor->seek_range_state = cursor->seek_range_flags =
+      uint8_t((range.from.iov_base ? fpta_cursor::need_cmp_range_from : 0) |
+              (range.to.iov_base ? fpta_cursor::need_cmp_range_to : 0));
+  if (range.inclusive)
+    cursor->options |= fpta_zeroed_range_is_point;
+  else
+    cursor->options &= ~fpta_zeroed_range_is_point;
+}
+
+/* Возвращает границу диапазона с адресом внутри самого элемента, так как
+ * при нормализации элементы перемещаются. */
+static inline MDBX_val fpta_range_bound(const fpta_cursor_range &range,
+                                        bool upper) {
+  MDBX_val bound = upper ? range.to : range.from;
+  if (bound.iov_base)
+    bound.iov_base =
+        const_cast<uint64_t *>(upper ? range.to_place : range.from_place);
+  return bound;
+}
+
+int fpta_cursor_open_ranges(fpta_txn *txn, fpta_name *column_id,
+                            const fpta_range *ranges, size_t ranges_count,
+                            fpta_filter *filter, fpta_cursor_options options,
+                            fpta_cursor **pcursor) {
+  if (unlikely(pcursor == nullptr))
+    return FPTA_EINVAL;
+  *pcursor = nullptr;
+  if (unlikely(ranges == nullptr || ranges_count == 0 ||
+               ranges_count > UINT_MAX))
+    return FPTA_EINVAL;
+
+  /* Курсор открывается на весь индекс без позиционирования, что выполняет
+   * все проверки кроме самих диапазонов. */
+  fpta_cursor *cursor;
+  int rc = fpta_cursor_setup(txn, column_id, fpta_value_begin(),
+                             fpta_value_end(), filter,
+                             options | fpta_dont_fetch, nullptr, &cursor,
+                             false /* диапазоны задаются ниже */);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const fpta_shove_t shove = cursor->index_shove();
+  const bool unordered = fpta_index_is_unordered(fpta_shove2index(shove));
+  MDBX_txn *const mdbx_txn = txn->mdbx_txn;
+  const MDBX_dbi dbi = cursor->idx_handle;
+  unsigned count = 0;
+  fpta_cursor_range *const items = static_cast<fpta_cursor_range *>(
+      malloc(sizeof(fpta_cursor_range) * ranges_count));
+  if (unlikely(items == nullptr)) {
+    rc = FPTA_ENOMEM;
+    goto bailout;
+  }
+
+  for (size_t i = 0; i < ranges_count; ++i) {
+    fpta_value from = ranges[i].from, to = ranges[i].to;
+    if (unlikely(!fpta_index_is_compat(shove, from) ||
+                 !fpta_index_is_compat(shove, to))) {
+      rc = FPTA_ETYPE;
+      goto bailout;
+    }
+    if (unlikely(from.type == fpta_end || to.type == fpta_begin ||
+                 (from.type == fpta_epsilon && to.type > fpta_shoved) ||
+                 (to.type == fpta_epsilon && from.type > fpta_shoved))) {
+      /* fpta_epsilon допускается только в паре с явным значением */
+      rc = FPTA_EINVAL;
+      goto bailout;
+    }
+
+    bool point = false;
+    if (from.type == fpta_epsilon) {
+      from = to;
+      point = true;
+    } else if (to.type == fpta_epsilon) {
+      to = from;
+      point = true;
+    }
+    if (unlikely(unordered && (from.type > fpta_shoved) !=
+                                  (to.type > fpta_shoved))) {
+      /* не разрешает неоднозначные выборки value..end и begin..value */
+      rc = FPTA_NO_INDEX;
+      goto bailout;
+    }
+
+    fpta_cursor_range &item = items[count];
+    item.from.iov_base = item.to.iov_base = nullptr;
+    item.from.iov_len = item.to.iov_len = 0;
+    item.inclusive = false;
+    fpta_key key;
+    if (from.type <= fpta_shoved) {
+      rc = fpta_index_value2key(shove, from, key, false);
+      if (unlikely(rc != FPTA_SUCCESS))
+        goto bailout;
+      assert(key.mdbx.iov_len <= sizeof(item.from_place));
+      item.from.iov_len = key.mdbx.iov_len;
+      item.from.iov_base = item.from_place;
+      if (key.mdbx.iov_len)
+        memcpy(item.from_place, key.mdbx.iov_base, key.mdbx.iov_len);
+    }
+    if (to.type <= fpta_shoved) {
+      rc = fpta_index_value2key(shove, to, key, false);
+      if (unlikely(rc != FPTA_SUCCESS))
+        goto bailout;
+      assert(key.mdbx.iov_len <= sizeof(item.to_place));
+      item.to.iov_len = key.mdbx.iov_len;
+      item.to.iov_base = item.to_place;
+      if (key.mdbx.iov_len)
+        memcpy(item.to_place, key.mdbx.iov_base, key.mdbx.iov_len);
+    }
+
+    if (item.from.iov_base && item.to.iov_base) {
+      const auto cmp = mdbx_cmp(mdbx_txn, dbi, &item.from, &item.to);
+      if (cmp == 0) {
+        item.inclusive = point || (options & fpta_zeroed_range_is_point);
+        if (!item.inclusive)
+          /* пустой диапазон */
+          continue;
+      } else if (unlikely(unordered)) {
+        rc = FPTA_NO_INDEX;
+        goto bailout;
+      } else if (cmp > 0)
+        /* пустой диапазон */
+        continue;
+    }
+    count += 1;
+  }
+
+  if (count == 0) {
+    /* Все диапазоны пустые, курсор переводится в состояние аналогичное
+     * открытию с фильтром fpta_filter_none. */
+    free(items);
+    if ((options & fpta_dont_fetch) == 0) {
+      fpta_cursor_close(cursor);
+      return FPTA_NODATA;
+    }
+    mdbx_cursor_close(cursor->mdbx_cursor);
+    cursor->mdbx_cursor = nullptr;
+    cursor->filter = fpta_filter_none;
+    cursor->set_eof(fpta_cursor::nodata);
+    *pcursor = cursor;
+    return FPTA_SUCCESS;
+  }
+
+  /* Упорядочиваем диапазоны по нижней границе, отсутствующая граница меньше
+   * любого значения ключа. */
+  std::sort(items, items + count,
+            [mdbx_txn, dbi](const fpta_cursor_range &a,
+                            const fpta_cursor_range &b) {
+              if (!b.from.iov_base)
+                return false;
+              if (!a.from.iov_base)
+                return true;
+              const MDBX_val a_from = fpta_range_bound(a, false),
+                             b_from = fpta_range_bound(b, false);
+              return mdbx_cmp(mdbx_txn, dbi, &a_from, &b_from) < 0;
+            });
+
+  {
+    /* Объединяем пересекающиеся и смежные диапазоны. */
+    unsigned last = 0;
+    for (unsigned i = 1; i < count; ++i) {
+      fpta_cursor_range &current = items[last];
+      const fpta_cursor_range &next = items[i];
+      const MDBX_val current_to = fpta_range_bound(current, true);
+      const MDBX_val next_from = fpta_range_bound(next, false);
+      if (current.to.iov_base && next.from.iov_base &&
+          mdbx_cmp(mdbx_txn, dbi, &next_from, &current_to) > 0) {
+        if (++last != i)
+          items[last] = next;
+        continue;
+      }
+
+      if (!current.to.iov_base)
+        continue;
+      if (!next.to.iov_base) {
+        current.to.iov_base = nullptr;
+        current.to.iov_len = 0;
+        current.inclusive = false;
+        continue;
+      }
+      const MDBX_val next_to = fpta_range_bound(next, true);
+      const auto cmp = mdbx_cmp(mdbx_txn, dbi, &next_to, &current_to);
+      if (cmp > 0) {
+        current.to.iov_len = next.to.iov_len;
+        memcpy(current.to_place, next.to_place, next.to.iov_len);
+        current.inclusive = next.inclusive;
+      } else if (cmp == 0)
+        current.inclusive |= next.inclusive;
+    }
+    count = last + 1;
+  }
+
+  for (unsigned i = 0; i < count; ++i) {
+    items[i].from = fpta_range_bound(items[i], false);
+    items[i].to = fpta_range_bound(items[i], true);
+  }
+
+  cursor->ranges = items;
+  cursor->ranges_count = count;
+  fpta_cursor_range_activate(cursor, 0);
+  if ((options & fpta_dont_fetch) == 0) {
+    rc = fpta_cursor_move(cursor, fpta_first);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      fpta_cursor_close(cursor);
+      return rc;
+    }
+  }
+
+  *pcursor = cursor;
+  return FPTA_SUCCESS;
+
+bailout:
+  free(items);
+  fpta_cursor_close(cursor);
+  return rc;
+}
+
+/* Закрывает курсор открытый посредством fpta_cursor_setup() в памяти
+ * вызывающей стороны, саму память не освобождает. */
+void fpta_cursor_release(fpta_cursor *cursor) {
+  fpta_cursor_detach(cursor);
+  mdbx_cursor_close(cursor->mdbx_cursor);
+  cursor->mdbx_cursor = nullptr;
+  free(cursor->ranges);
+  cursor->ranges = nullptr;
+  fpta_filter_program_destroy(cursor->filter_program);
+  cursor->db = nullptr;
+}
+
 //----------------------------------------------------------------------------
 
+/* Упреждающее чтение при последовательном просмотре.
+ *
+ * libmdbx не предоставляет номера листьевых страниц, поэтому окно подсказки
+ * отсчитывается в отображении БД от адреса данных в позиции курсора, в
+ * направлении просмотра. Последовательно заполненные (или компактифицированные)
+ * деревья размещают соседние листья рядом в файле, поэтому такое окно
+ * покрывает предстоящие страницы. Подсказка повторяется только при выходе
+ * позиции из окна последней подсказки или приближении к его краю. */
+
+enum {
+  fpta_readahead_threshold = 8 /* длина серии переходов для подсказки */,
+  fpta_readahead_window = 1 << 20 /* объем подсказки в байтах */
+};
+
+#if defined(MADV_WILLNEED)
+static __cold uintptr_t fpta_readahead_pagesize() {
+  static const uintptr_t pagesize = uintptr_t(sysconf(_SC_PAGESIZE));
+  return pagesize;
+}
+#endif /* MADV_WILLNEED */
+
+static void fpta_cursor_readahead(fpta_cursor *cursor, const MDBX_val *data,
+                                  const MDBX_cursor_op op, int err) {
+  cxx11_constexpr_var unsigned ops_step_mask =
+      1 << MDBX_NEXT | 1 << MDBX_NEXT_DUP | 1 << MDBX_NEXT_MULTIPLE |
+      1 << MDBX_NEXT_NODUP | 1 << MDBX_PREV | 1 << MDBX_PREV_DUP |
+      1 << MDBX_PREV_NODUP | 1 << MDBX_PREV_MULTIPLE;
+  cxx11_constexpr_var unsigned ops_backward_mask =
+      1 << MDBX_PREV | 1 << MDBX_PREV_DUP | 1 << MDBX_PREV_NODUP |
+      1 << MDBX_PREV_MULTIPLE | 1 << MDBX_LAST | 1 << MDBX_LAST_DUP;
+
+  if (1 & (ops_step_mask >> op))
+    cursor->sequential_steps += 1;
+  else
+    /* Поиск или переход в начало/конец прерывает серию. */
+    cursor->sequential_steps = 0;
+
+  if (unlikely(err != MDBX_SUCCESS) || !data || !data->iov_base ||
+      cursor->sequential_steps < fpta_readahead_threshold)
+    return;
+
+  const uintptr_t ptr = reinterpret_cast<uintptr_t>(data->iov_base);
+  const bool backward = 1 & (ops_backward_mask >> op);
+  if (backward ? ptr >= cursor->readahead_lo + fpta_readahead_window / 2 &&
+                     ptr < cursor->readahead_hi
+               : ptr >= cursor->readahead_lo &&
+                     ptr + fpta_readahead_window / 2 < cursor->readahead_hi)
+    /* Позиция внутри окна предыдущей подсказки. */
+    return;
+
+#if defined(MADV_WILLNEED)
+  const uintptr_t pagesize = fpta_readahead_pagesize();
+  const uintptr_t page = ptr & ~(pagesize - 1);
+  const uintptr_t lo = (backward && page + pagesize > fpta_readahead_window)
+                           ? page + pagesize - fpta_readahead_window
+                           : page;
+  /* Ошибки игнорируются, так как подсказка не влияет на корректность, а
+   * часть окна может выходить за границы отображения БД. */
+  (void)madvise(reinterpret_cast<void *>(lo), fpta_readahead_window,
+                MADV_WILLNEED);
+  cursor->readahead_lo = lo;
+  cursor->readahead_hi = lo + fpta_readahead_window;
+  cursor->metrics.readaheads += 1;
+#endif /* MADV_WILLNEED */
+}
+
 int fpta_cursor::bring(MDBX_val *key, MDBX_val *data, const MDBX_cursor_op op) {
   cxx11_constexpr_var unsigned ops_scan_mask =
       1 << MDBX_NEXT | 1 << MDBX_NEXT_DUP | 1 << MDBX_NEXT_MULTIPLE |
@@ -240,6 +608,8 @@ int fpta_cursor::bring(MDBX_val *key, MDBX_val *data, const MDBX_cursor_op op) {
   metrics.scans += 1 & (ops_scan_mask >> op);
   metrics.searches += 1 & (ops_search_mask >> op);
   int err = mdbx_cursor_get(mdbx_cursor, key, data, op);
+  if ((options & fpta_readahead) && op != MDBX_GET_CURRENT)
+    fpta_cursor_readahead(this, data, op, err);
   return likely(err != int(MDBX_ENODATA)) ? err : int(MDBX_NOTFOUND);
 }
 
@@ -261,7 +631,8 @@ static int fpta_cursor_seek(fpta_cursor *cursor,
                             const MDBX_cursor_op mdbx_seek_op,
                             const MDBX_cursor_op mdbx_step_op,
                             const MDBX_val *mdbx_seek_key,
-                            const MDBX_val *mdbx_seek_data) {
+                            const MDBX_val *mdbx_seek_data,
+                            MDBX_val *mdbx_found_data) {
   assert(cursor->filter != fpta_filter_none && cursor->mdbx_cursor);
   assert(mdbx_seek_key != &cursor->current);
   int rc;
@@ -452,6 +823,8 @@ static int fpta_cursor_seek(fpta_cursor *cursor,
 
     if (cursor->filter == fpta_filter_any) {
       cursor->metrics.results += 1;
+      if (mdbx_found_data)
+        *mdbx_found_data = mdbx_data.sys;
       return FPTA_SUCCESS;
     }
 
@@ -466,8 +839,10 @@ static int fpta_cursor_seek(fpta_cursor *cursor,
         return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
     }
 
-    if (fpta_filter_match(cursor->filter, mdbx_data)) {
+    if (fpta_filter_program_match(cursor->filter_program, mdbx_data)) {
       cursor->metrics.results += 1;
+      if (mdbx_found_data)
+        *mdbx_found_data = mdbx_data.sys;
       return FPTA_SUCCESS;
     }
 
@@ -505,6 +880,104 @@ eof:
   }
 }
 
+/* Устанавливает курсор с несколькими диапазонами на первую (при forward),
+ * либо последнюю в порядке ключей подходящую строку, начиная с диапазона
+ * index и переходя к следующим в том же направлении при их исчерпании.
+ *
+ * Вход в каждый диапазон выполняется одним позиционированием по его границе,
+ * причем поиск и корректировка позиции делаются здесь, а не внутри
+ * fpta_cursor_seek(), так как направление движения по ключам не зависит
+ * от порядка сортировки курсора. */
+static int fpta_cursor_ranges_seek(fpta_cursor *cursor, unsigned index,
+                                   const bool forward,
+                                   MDBX_val *mdbx_found_data = nullptr) {
+  assert(cursor->ranges && cursor->mdbx_cursor);
+  for (; index < cursor->ranges_count;
+       index = forward ? index + 1 : index - 1) {
+    fpta_cursor_range_activate(cursor, index);
+    MDBX_cursor_op seek_op = forward ? MDBX_FIRST : MDBX_LAST;
+    const MDBX_val *const bound = forward ? &cursor->range_from_key.mdbx
+                                          : &cursor->range_to_key.mdbx;
+    if (bound->iov_base) {
+      MDBX_val key = *bound, data;
+      int rc = cursor->bring(&key, &data, MDBX_SET_RANGE);
+      if (rc == MDBX_SUCCESS) {
+        cursor->current = key;
+        seek_op = MDBX_GET_CURRENT;
+        if (!forward) {
+          /* Позиция соответствует lower_bound для верхней границы, поэтому
+           * нужно перейти к последней строке с ключом внутри диапазона. */
+          const auto cmp =
+              mdbx_cmp(cursor->txn->mdbx_txn, cursor->idx_handle, &key, bound);
+          if (cmp > 0 || (cmp == 0 && !cursor->ranges[index].inclusive))
+            seek_op = MDBX_PREV_NODUP;
+          else if (!fpta_index_is_unique(cursor->index_shove()))
+            seek_op = MDBX_LAST_DUP;
+        }
+      } else if (unlikely(rc != MDBX_NOTFOUND)) {
+        cursor->set_poor();
+        return rc;
+      } else if (forward) {
+        /* за нижней границей нет ключей, остальные диапазоны пусты */
+        break;
+      }
+    }
+
+    const int rc = fpta_cursor_seek(cursor, seek_op,
+                                    forward ? MDBX_NEXT : MDBX_PREV, nullptr,
+                                    nullptr, mdbx_found_data);
+    if (rc != FPTA_NODATA)
+      return rc;
+  }
+
+  cursor->set_eof(forward ? fpta_cursor::after_last
+                          : fpta_cursor::before_first);
+  cursor->seek_range_state = 0;
+  return FPTA_NODATA;
+}
+
+/* Продолжает выборку со следующего в направлении движения диапазона,
+ * после исчерпания активного. */
+static inline int fpta_cursor_ranges_next(fpta_cursor *cursor,
+                                          const bool forward,
+                                          MDBX_val *mdbx_found_data = nullptr) {
+  return fpta_cursor_ranges_seek(cursor,
+                                 forward ? cursor->range_index + 1
+                                         : cursor->range_index - 1,
+                                 forward, mdbx_found_data);
+}
+
+/* Активирует диапазон, в котором следует искать ключ при движении курсора
+ * в порядке его сортировки: первый не лежащий целиком ниже ключа, либо
+ * для fpta_descending последний не лежащий целиком выше. */
+static void fpta_cursor_range_select(fpta_cursor *cursor, const MDBX_val *key) {
+  MDBX_txn *const mdbx_txn = cursor->txn->mdbx_txn;
+  unsigned lo = 0, hi = cursor->ranges_count - 1;
+  if (!fpta_cursor_is_descending(cursor->options)) {
+    while (lo < hi) {
+      const unsigned mid = (lo + hi) / 2;
+      const fpta_cursor_range &range = cursor->ranges[mid];
+      if (range.to.iov_base &&
+          mdbx_cmp(mdbx_txn, cursor->idx_handle, key, &range.to) >=
+              (range.inclusive ? 1 : 0))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  } else {
+    while (lo < hi) {
+      const unsigned mid = (lo + hi + 1) / 2;
+      const fpta_cursor_range &range = cursor->ranges[mid];
+      if (range.from.iov_base &&
+          mdbx_cmp(mdbx_txn, cursor->idx_handle, key, &range.from) < 0)
+        hi = mid - 1;
+      else
+        lo = mid;
+    }
+  }
+  fpta_cursor_range_activate(cursor, lo);
+}
+
 int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op) {
   int rc = fpta_cursor_validate(cursor, fpta_read);
   if (unlikely(rc != FPTA_SUCCESS))
@@ -514,6 +987,15 @@ int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op) {
     cursor->set_poor();
     return FPTA_EFLAG;
   }
+  cursor->stepped_back = false;
+
+  if (unlikely(cursor->txn->managed) &&
+      --cursor->txn->managed->countdown == 0) {
+    /* Перезапуск управляемой сессии перед перемещением курсора. */
+    rc = fpta_managed_checkpoint(cursor->txn, false);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
 
   if (unlikely(!cursor->mdbx_cursor)) {
     assert(cursor->filter == fpta_filter_none);
@@ -524,6 +1006,19 @@ int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op) {
   if (fpta_cursor_is_descending(cursor->options))
     op = fpta_seek_operations(op ^ 1);
 
+  if (cursor->ranges) {
+    /* Курсор с несколькими диапазонами: начальное позиционирование
+     * выполняется по границе крайнего диапазона, а при перемещении границы
+     * активного диапазона проверяются в обоих направлениях. */
+    if (op == fpta_first ||
+        ((op == fpta_next || op == fpta_key_next) && cursor->is_before_first()))
+      return fpta_cursor_ranges_seek(cursor, 0, true);
+    if (op == fpta_last ||
+        ((op == fpta_prev || op == fpta_key_prev) && cursor->is_after_last()))
+      return fpta_cursor_ranges_seek(cursor, cursor->ranges_count - 1, false);
+    cursor->seek_range_state = cursor->seek_range_flags;
+  }
+
   MDBX_val *mdbx_seek_key = nullptr;
   MDBX_cursor_op mdbx_seek_op, mdbx_step_op;
   switch (op) {
@@ -630,8 +1125,158 @@ int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op) {
     break;
   }
 
-  return fpta_cursor_seek(cursor, mdbx_seek_op, mdbx_step_op, mdbx_seek_key,
-                          nullptr);
+  rc = fpta_cursor_seek(cursor, mdbx_seek_op, mdbx_step_op, mdbx_seek_key,
+                        nullptr);
+  if (unlikely(rc == FPTA_NODATA) && cursor->ranges &&
+      mdbx_step_op != MDBX_NEXT_DUP && mdbx_step_op != MDBX_PREV_DUP)
+    rc = fpta_cursor_ranges_next(cursor, is_forward_direction(mdbx_step_op));
+  return rc;
+}
+
+//----------------------------------------------------------------------------
+
+int fpta_cursor_position_save(fpta_cursor *cursor, fpta_cursor_position *pos) {
+  pos->buffer = nullptr;
+  if (!cursor->is_filled()) {
+    pos->eof = reinterpret_cast<uintptr_t>(cursor->current.iov_base);
+    return FPTA_SUCCESS;
+  }
+
+  pos->eof = 0;
+  MDBX_val key, data;
+  int rc = mdbx_cursor_get(cursor->mdbx_cursor, &key, &data, MDBX_GET_CURRENT);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  /* Для индексов с дубликатами позиция уточняется значением, т.е. PK для
+   * вторичного индекса, либо самой строкой для первичного. */
+  const bool dups = !fpta_index_is_unique(cursor->index_shove());
+  pos->buffer = malloc(key.iov_len + (dups ? data.iov_len : 0) + 1);
+  if (unlikely(pos->buffer == nullptr))
+    return FPTA_ENOMEM;
+
+  pos->key.iov_len = key.iov_len;
+  pos->key.iov_base = memcpy(pos->buffer, key.iov_base, key.iov_len);
+  pos->data.iov_len = dups ? data.iov_len : 0;
+  pos->data.iov_base =
+      dups ? memcpy(static_cast<char *>(pos->buffer) + key.iov_len,
+                    data.iov_base, data.iov_len)
+           : nullptr;
+  return FPTA_SUCCESS;
+}
+
+int fpta_cursor_position_restore(fpta_cursor *cursor,
+                                 const fpta_cursor_position *pos) {
+  cursor->stepped_back = false;
+  if (pos->eof) {
+    cursor->current.iov_base = reinterpret_cast<void *>(pos->eof);
+    return FPTA_SUCCESS;
+  }
+
+  MDBX_cursor *const mc = cursor->mdbx_cursor;
+  const MDBX_val *const seek_data = pos->data.iov_base ? &pos->data : nullptr;
+  MDBX_val key = pos->key, data = pos->data;
+  int rc =
+      mdbx_cursor_get(mc, &key, &data, seek_data ? MDBX_GET_BOTH : MDBX_SET_KEY);
+  if (likely(rc == MDBX_SUCCESS))
+    goto positioned;
+  if (unlikely(rc != MDBX_NOTFOUND))
+    return rc;
+
+  /* Строка была удалена. Ищем первую следующую за ней позицию в порядке
+   * ключей mdbx, после чего курсор устанавливается "между" строками так,
+   * чтобы очередное перемещение продолжило просмотр с прежнего места. */
+  if (seek_data) {
+    key = pos->key;
+    data = pos->data;
+    rc = mdbx_cursor_get(mc, &key, &data, MDBX_GET_BOTH_RANGE);
+  }
+  if (!seek_data || rc == MDBX_NOTFOUND) {
+    key = pos->key;
+    rc = mdbx_cursor_get(mc, &key, &data, MDBX_SET_RANGE);
+    if (rc == MDBX_SUCCESS && seek_data &&
+        mdbx_cmp(cursor->txn->mdbx_txn, cursor->idx_handle, &key, &pos->key) ==
+            0)
+      /* все дубликаты ключа меньше искомого значения */
+      rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT_NODUP);
+  }
+  if (unlikely(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND))
+    return rc;
+
+  cursor->stepped_back = true;
+  if (fpta_cursor_is_descending(cursor->options)) {
+    if (rc == MDBX_NOTFOUND) {
+      cursor->set_eof(fpta_cursor::after_last);
+      return FPTA_SUCCESS;
+    }
+    goto positioned;
+  }
+
+  rc = mdbx_cursor_get(mc, &key, &data,
+                       (rc == MDBX_SUCCESS) ? MDBX_PREV : MDBX_LAST);
+  if (rc == MDBX_NOTFOUND) {
+    cursor->set_eof(fpta_cursor::before_first);
+    return FPTA_SUCCESS;
+  }
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+positioned:
+  cursor->current = key;
+  /* Позиция может оказаться вне диапазона курсора, поэтому при следующем
+   * перемещении границы диапазона проверяются заново. */
+  cursor->seek_range_state = cursor->seek_range_flags;
+  return FPTA_SUCCESS;
+}
+
+int fpta_cursor_seek_nth(fpta_cursor *cursor, size_t nth) {
+  int rc = fpta_cursor_validate(cursor, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const bool unfiltered =
+      cursor->filter == fpta_filter_any && cursor->mdbx_cursor;
+  bool backward = false;
+  if (unfiltered && cursor->seek_range_flags == 0) {
+    /* Без фильтра и границ диапазона количество строк известно из статистики
+     * индекса, поэтому к строкам во второй половине выборки выгоднее
+     * двигаться с конца. */
+    MDBX_stat stat;
+    rc = mdbx_dbi_stat(cursor->txn->mdbx_txn, cursor->idx_handle, &stat,
+                       sizeof(stat));
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    const size_t total = (size_t)stat.ms_entries;
+    if (nth >= total) {
+      rc = fpta_cursor_move(cursor, fpta_last);
+      return (rc == FPTA_SUCCESS) ? fpta_cursor_move(cursor, fpta_next) : rc;
+    }
+    if (nth > total / 2) {
+      backward = true;
+      nth = total - 1 - nth;
+    }
+  }
+
+  rc = fpta_cursor_move(cursor, backward ? fpta_last : fpta_first);
+  if (unfiltered && !fpta_index_is_unique(cursor->index_shove())) {
+    /* Дубликаты пропускаются целиком, их количество для текущего значения
+     * ключа берется из вложенного дерева. При этом курсор стоит на первом
+     * (в направлении движения) дубликате ключа. */
+    while (rc == FPTA_SUCCESS && nth > 0) {
+      size_t dups;
+      rc = mdbx_cursor_count(cursor->mdbx_cursor, &dups);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      if (nth < dups)
+        break;
+      nth -= dups;
+      rc = fpta_cursor_move(cursor, backward ? fpta_key_prev : fpta_key_next);
+    }
+  }
+
+  for (; rc == FPTA_SUCCESS && nth > 0; --nth)
+    rc = fpta_cursor_move(cursor, backward ? fpta_prev : fpta_next);
+  return rc;
 }
 
 int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
@@ -639,6 +1284,7 @@ int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
   int rc = fpta_cursor_validate(cursor, fpta_read);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
+  cursor->stepped_back = false;
 
   if (unlikely((key != nullptr) == (row != nullptr))) {
     /* Должен быть выбран один из режимов поиска. */
@@ -730,10 +1376,15 @@ int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
     }
   }
 
+  if (cursor->ranges)
+    fpta_cursor_range_select(cursor, &seek_key.mdbx);
   rc = fpta_cursor_seek(cursor, mdbx_seek_op,
                         fpta_cursor_is_descending(cursor->options) ? MDBX_PREV
                                                                    : MDBX_NEXT,
                         &seek_key.mdbx, mdbx_seek_data);
+  if (unlikely(rc == FPTA_NODATA) && cursor->ranges && !exactly)
+    rc = fpta_cursor_ranges_next(cursor,
+                                 !fpta_cursor_is_descending(cursor->options));
   if (unlikely(rc != FPTA_SUCCESS)) {
     cursor->set_poor();
     return rc;
@@ -777,6 +1428,8 @@ int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
     }
 
     rc = fpta_cursor_seek(cursor, MDBX_PREV, MDBX_PREV, nullptr, nullptr);
+    if (unlikely(rc == FPTA_NODATA) && cursor->ranges)
+      rc = fpta_cursor_ranges_next(cursor, false);
     if (unlikely(rc != FPTA_SUCCESS)) {
       cursor->set_poor();
       return rc;
@@ -832,13 +1485,220 @@ int fpta_cursor_state(const fpta_cursor *cursor) {
   return cursor->unladed_state();
 }
 
+/* Подсчет строк по структуре индекса, без чтения самих строк.
+ *
+ * Используется для курсоров без фильтра, либо с фильтром только по ключевой
+ * колонке (см fpta_filter_keyed()), который тогда проверяется по значению
+ * ключа. Индекс из одной страницы дешевле просмотреть пошагово, поэтому
+ * для него подсчет выполняется обычным перемещением курсора. */
+struct fpta_count_probe {
+  const fpta_name *column /* колонка фильтра по ключу, либо nullptr */;
+  fptu_rw *tuple /* кортеж из одного значения ключа для проверки фильтра */;
+  size_t total /* количество элементов индекса */;
+};
+
+static bool fpta_count_prepare(fpta_cursor *cursor, fpta_count_probe &probe) {
+  probe.column = nullptr;
+  probe.tuple = nullptr;
+  if (!cursor->mdbx_cursor)
+    return false;
+
+  if (cursor->filter != fpta_filter_any) {
+    /* Ключ должен однозначно восстанавливаться в значение колонки. */
+    const fpta_shove_t shove = cursor->index_shove();
+    const fptu_type type = fpta_shove2type(shove);
+    if (type == fptu_null /* composite */ || type >= fptu_96 ||
+        fpta_column_is_nullable(shove))
+      return false;
+    probe.column = fpta_filter_keyed(cursor->filter, shove);
+    if (!probe.column)
+      return false;
+  }
+
+  MDBX_stat stat;
+  if (mdbx_dbi_stat(cursor->txn->mdbx_txn, cursor->idx_handle, &stat,
+                    sizeof(stat)) != MDBX_SUCCESS ||
+      stat.ms_depth < 2)
+    return false;
+  probe.total = (size_t)stat.ms_entries;
+
+  if (probe.column) {
+    probe.tuple = fptu_alloc(1, sizeof(uint64_t));
+    if (unlikely(!probe.tuple))
+      return false;
+  }
+  return true;
+}
+
+/* Суммирует количество строк для ключей, начиная с текущей позиции курсора
+ * и двигаясь в направлении step_op до выхода за границу bound. Для каждого
+ * значения ключа количество дубликатов берется из вложенного дерева
+ * посредством mdbx_cursor_count(), т.е. без перебора самих дубликатов. */
+static int fpta_count_keys(fpta_cursor *cursor, const fpta_count_probe &probe,
+                           int rc, MDBX_val *key, const MDBX_cursor_op step_op,
+                           const MDBX_val *bound, const int bound_cmp,
+                           size_t limit, size_t &count) {
+  const bool unique = fpta_index_is_unique(cursor->index_shove());
+  MDBX_val data;
+  while (rc == MDBX_SUCCESS && count < limit) {
+    if (bound) {
+      const auto cmp =
+          mdbx_cmp(cursor->txn->mdbx_txn, cursor->idx_handle, key, bound);
+      if (is_forward_direction(step_op) ? cmp >= bound_cmp : cmp < bound_cmp)
+        return FPTA_SUCCESS;
+    }
+    if (probe.tuple) {
+      fpta_value value;
+      rc = fpta_index_key2value(cursor->index_shove(), *key, value);
+      if (likely(rc == FPTA_SUCCESS))
+        rc = fptu_clear(probe.tuple);
+      if (likely(rc == FPTA_SUCCESS))
+        rc = fpta_upsert_column(probe.tuple, probe.column, value);
+      if (unlikely(rc != FPTA_SUCCESS))
+        return rc;
+      if (!fpta_filter_program_match(cursor->filter_program,
+                                     fptu_take_noshrink(probe.tuple)))
+        goto next;
+    }
+    {
+      size_t dups = 1;
+      if (!unique) {
+        rc = mdbx_cursor_count(cursor->mdbx_cursor, &dups);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+      }
+      count += dups;
+    }
+  next:
+    rc = cursor->bring(key, &data, step_op);
+  }
+  return (rc == MDBX_NOTFOUND) ? (int)FPTA_SUCCESS : rc;
+}
+
+/* Точный подсчет строк в диапазоне курсора по структуре индекса.
+ *
+ * Для полного диапазона без фильтра количество берется из статистики
+ * индекса, т.е. за O(1). Иначе перебираются только значения ключей (без
+ * чтения строк), а дубликаты учитываются целиком. Причем если фильтра нет,
+ * а по оценке mdbx_estimate_range() диапазон покрывает больше половины
+ * индекса, то перебираются ключи вне диапазона, а результат вычисляется как
+ * дополнение до общего количества. Таким образом, стоимость подсчета
+ * не превышает меньшего из размеров диапазона и его дополнения.
+ *
+ * Точный пропуск целых страниц невозможен, так как libmdbx не хранит
+ * количество элементов поддеревьев в страницах ветвей. */
+static int fpta_cursor_count_range(fpta_cursor *cursor,
+                                   const fpta_count_probe &probe, size_t limit,
+                                   size_t &count) {
+  count = 0;
+  cursor->seek_range_state = 0;
+  cursor->stepped_back = false;
+  if (unlikely(cursor->seek_range_flags == fpta_cursor::need_key4epsilon))
+    /* значение ключа для epsilon не было получено, т.е. индекс пуст */
+    return FPTA_SUCCESS;
+
+  const size_t total = probe.total;
+  const MDBX_val *const from =
+      (cursor->seek_range_flags & fpta_cursor::need_cmp_range_from)
+          ? &cursor->range_from_key.mdbx
+          : nullptr;
+  const MDBX_val *const to =
+      (cursor->seek_range_flags & fpta_cursor::need_cmp_range_to)
+          ? &cursor->range_to_key.mdbx
+          : nullptr;
+  /* При установленном признаке fpta_zeroed_range_is_point строки с ключом
+   * равным верхней границе попадают в выборку. */
+  const int to_cmp = (cursor->options & fpta_zeroed_range_is_point) ? 1 : 0;
+
+  if (!from && !to && !probe.column) {
+    count = std::min(total, limit);
+    return FPTA_SUCCESS;
+  }
+
+  MDBX_val key, data;
+  ptrdiff_t estimated = -1;
+  if (!probe.column) {
+    MDBX_val from_copy, to_copy;
+    if (from)
+      from_copy = *from;
+    if (to)
+      to_copy = *to;
+    int rc = mdbx_estimate_range(cursor->txn->mdbx_txn, cursor->idx_handle,
+                                 from ? &from_copy : nullptr, nullptr,
+                                 to ? &to_copy : nullptr, nullptr, &estimated);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+
+  int rc;
+  if (estimated < 0 || size_t(estimated) <= total / 2) {
+    /* перебираем ключи внутри диапазона */
+    if (from) {
+      key = *from;
+      rc = cursor->bring(&key, &data, MDBX_SET_RANGE);
+    } else
+      rc = cursor->bring(&key, &data, MDBX_FIRST);
+    return fpta_count_keys(cursor, probe, rc, &key, MDBX_NEXT_NODUP, to,
+                           to_cmp, limit, count);
+  }
+
+  /* перебираем ключи ниже и выше диапазона */
+  size_t outside = 0;
+  if (from) {
+    rc = cursor->bring(&key, &data, MDBX_FIRST);
+    rc = fpta_count_keys(cursor, probe, rc, &key, MDBX_NEXT_NODUP, from, 0,
+                         SIZE_MAX, outside);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+  if (to) {
+    rc = cursor->bring(&key, &data, MDBX_LAST);
+    rc = fpta_count_keys(cursor, probe, rc, &key, MDBX_PREV_NODUP, to, to_cmp,
+                         SIZE_MAX, outside);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+  assert(outside <= total);
+  count = std::min(total - std::min(outside, total), limit);
+  return FPTA_SUCCESS;
+}
+
 int fpta_cursor_count(fpta_cursor *cursor, size_t *pcount, size_t limit) {
   if (unlikely(!pcount))
     return FPTA_EINVAL;
   *pcount = (size_t)FPTA_DEADBEEF;
 
+  int rc = fpta_cursor_validate(cursor, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
   size_t count = 0, metrics_results_before = cursor->metrics.results;
-  int rc = fpta_cursor_move(cursor, fpta_first);
+
+  fpta_count_probe probe;
+  if (fpta_count_prepare(cursor, probe)) {
+    if (cursor->ranges) {
+      /* диапазоны не пересекаются, поэтому количество строк суммируется */
+      for (unsigned i = 0;
+           rc == FPTA_SUCCESS && i < cursor->ranges_count && count < limit;
+           ++i) {
+        size_t range_count;
+        fpta_cursor_range_activate(cursor, i);
+        rc = fpta_cursor_count_range(cursor, probe, limit - count,
+                                     range_count);
+        count += range_count;
+      }
+    } else
+      rc = fpta_cursor_count_range(cursor, probe, limit, count);
+    free(probe.tuple);
+    cursor->set_poor();
+    /* Подсчет учитывается как один результат, как и при переборе ниже. */
+    cursor->metrics.results = metrics_results_before + 1;
+    if (likely(rc == FPTA_SUCCESS))
+      *pcount = count;
+    return rc;
+  }
+
+  rc = fpta_cursor_move(cursor, fpta_first);
   while (rc == FPTA_SUCCESS && count < limit) {
     ++count;
     rc = fpta_cursor_move(cursor, fpta_next);
@@ -852,6 +1712,25 @@ int fpta_cursor_count(fpta_cursor *cursor, size_t *pcount, size_t limit) {
   return rc;
 }
 
+int fpta_count_range(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+                     fpta_value range_to, size_t *pcount) {
+  if (unlikely(!pcount))
+    return FPTA_EINVAL;
+  *pcount = (size_t)FPTA_DEADBEEF;
+
+  alignas(fpta_cursor) char place[sizeof(fpta_cursor)];
+  fpta_cursor *cursor = nullptr;
+  int rc = fpta_cursor_setup(txn, column_id, range_from, range_to,
+                             fpta_filter_any, fpta_unsorted_dont_fetch,
+                             reinterpret_cast<fpta_cursor *>(place), &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  rc = fpta_cursor_count(cursor, pcount, SIZE_MAX);
+  fpta_cursor_release(cursor);
+  return rc;
+}
+
 int fpta_cursor_dups(fpta_cursor *cursor, size_t *pdups) {
   if (unlikely(pdups == nullptr))
     return FPTA_EINVAL;
@@ -887,6 +1766,9 @@ int fpta_cursor_get(fpta_cursor *cursor, fptu_ro *row) {
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  if (unlikely(cursor->options & fpta_keys_only))
+    return FPTA_EFLAG;
+
   if (unlikely(!cursor->is_filled()))
     return cursor->unladed_state();
 
@@ -903,6 +1785,92 @@ int fpta_cursor_get(fpta_cursor *cursor, fptu_ro *row) {
   return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
 }
 
+int fpta_cursor_get_batch_ex(fpta_cursor *cursor, fptu_ro *rows,
+                             fpta_value *keys, size_t capacity,
+                             size_t *fetched) {
+  if (unlikely(fetched == nullptr))
+    return FPTA_EINVAL;
+  *fetched = 0;
+  if (unlikely(capacity == 0 || (rows == nullptr && keys == nullptr)))
+    return FPTA_EINVAL;
+
+  int rc = fpta_cursor_validate(cursor, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (unlikely(rows && (cursor->options & fpta_keys_only)))
+    return FPTA_EFLAG;
+
+  fpta_txn_managed *const managed = cursor->txn->managed;
+  if (unlikely(managed) && managed->countdown <= capacity) {
+    /* Перезапуск управляемой сессии возможен только перед выборкой пакета,
+     * иначе ранее выбранные строки станут недействительными. */
+    rc = fpta_managed_checkpoint(cursor->txn, false);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  if (unlikely(cursor->stepped_back)) {
+    /* Курсор стоит на уже выбранной строке, переходим к следующей. */
+    rc = fpta_cursor_move(cursor, fpta_next);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  if (unlikely(!cursor->is_filled()))
+    return cursor->unladed_state();
+
+  const fpta_shove_t shove = cursor->index_shove();
+  const bool secondary = fpta_index_is_secondary(shove);
+  /* При фильтрации по вторичному индексу строки уже прочитаны по PK
+   * внутри fpta_cursor_seek(), иначе возвращается значение PK. */
+  const bool lookup = secondary && cursor->filter == fpta_filter_any;
+  const MDBX_cursor_op step_op =
+      fpta_cursor_is_descending(cursor->options) ? MDBX_PREV : MDBX_NEXT;
+
+  MDBX_val data;
+  rc = cursor->bring(&cursor->current, &data, MDBX_GET_CURRENT);
+  size_t n = 0;
+  while (likely(rc == MDBX_SUCCESS)) {
+    if (rows) {
+      if (secondary && (lookup || n == 0)) {
+        MDBX_val pk_key = data;
+        cursor->metrics.pk_lookups += 1;
+        rc = mdbx_get(cursor->txn->mdbx_txn, cursor->tbl_handle, &pk_key,
+                      &data);
+        if (unlikely(rc != MDBX_SUCCESS)) {
+          rc = (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
+          break;
+        }
+      }
+      rows[n].sys = data;
+    }
+    if (keys) {
+      rc = fpta_index_key2value(shove, cursor->current, keys[n]);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+    }
+
+    /* Курсор остается на строке следующей за последней выбранной. */
+    n += 1;
+    rc = fpta_cursor_seek(cursor, step_op, step_op, nullptr, nullptr, &data);
+    if (unlikely(rc == FPTA_NODATA) && cursor->ranges)
+      rc = fpta_cursor_ranges_next(cursor, step_op == MDBX_NEXT, &data);
+    if (n == capacity)
+      break;
+  }
+
+  if (unlikely(managed))
+    managed->countdown =
+        (managed->countdown > n) ? unsigned(managed->countdown - n) : 1;
+  *fetched = n;
+  return (rc == FPTA_NODATA && n) ? (int)FPTA_SUCCESS : rc;
+}
+
+int fpta_cursor_get_batch(fpta_cursor *cursor, fptu_ro *rows, size_t capacity,
+                          size_t *fetched) {
+  return fpta_cursor_get_batch_ex(cursor, rows, nullptr, capacity, fetched);
+}
+
 int fpta_cursor_key(fpta_cursor *cursor, fpta_value *key) {
   if (unlikely(key == nullptr))
     return FPTA_EINVAL;
@@ -917,6 +1885,50 @@ int fpta_cursor_key(fpta_cursor *cursor, fpta_value *key) {
   return rc;
 }
 
+int fpta_cursor_get_keys(fpta_cursor *cursor, fpta_value *key,
+                         fpta_value *pk) {
+  if (unlikely(key == nullptr && pk == nullptr))
+    return FPTA_EINVAL;
+  int rc = fpta_cursor_validate(cursor, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  if (unlikely(!cursor->is_filled()))
+    return cursor->unladed_state();
+
+  const fpta_shove_t shove = cursor->index_shove();
+  if (key) {
+    rc = fpta_index_key2value(shove, cursor->current, *key);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+  if (pk) {
+    if (fpta_index_is_primary(shove)) {
+      if (key) {
+        *pk = *key;
+        return FPTA_SUCCESS;
+      }
+      return fpta_index_key2value(shove, cursor->current, *pk);
+    }
+    /* Значением во вторичном индексе является ключ первичного индекса. */
+    MDBX_val pk_key;
+    rc = cursor->bring(&cursor->current, &pk_key, MDBX_GET_CURRENT);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    /* Данные во вторичном индексе могут быть не выровнены (после ключа
+     * нечетной длины), поэтому ключи фиксированного размера копируем. */
+    const fpta_shove_t pk_shove = cursor->table_schema()->table_pk();
+    const fptu_type pk_type = fpta_shove2type(pk_shove);
+    fpta_key aligned;
+    if (pk_type != /* composite */ fptu_null && pk_type < fptu_96 &&
+        pk_key.iov_len <= sizeof(aligned.place)) {
+      pk_key.iov_base = memcpy(&aligned.place, pk_key.iov_base, pk_key.iov_len);
+    }
+    rc = fpta_index_key2value(pk_shove, pk_key, *pk);
+  }
+  return rc;
+}
+
 int fpta_cursor_delete(fpta_cursor *cursor) {
   int rc = fpta_cursor_validate(cursor, fpta_write);
   if (unlikely(rc != FPTA_SUCCESS))
@@ -1227,13 +2239,15 @@ int fpta_apply_visitor(
   if (unlikely(limit < 1 || !visitor))
     return FPTA_EINVAL;
 
-  fpta_cursor *cursor = nullptr /* TODO: заменить на объект на стеке */;
-  int rc =
-      fpta_cursor_open(txn, column_id, range_from, range_to, filter,
-                       (fpta_cursor_options)(op & ~fpta_dont_fetch), &cursor);
+  /* Курсор размещается на стеке, без обращения к пулу курсоров. */
+  alignas(fpta_cursor) char place[sizeof(fpta_cursor)];
+  fpta_cursor *cursor = nullptr;
+  int rc = fpta_cursor_setup(txn, column_id, range_from, range_to, filter,
+                             (fpta_cursor_options)(op & ~fpta_dont_fetch),
+                             reinterpret_cast<fpta_cursor *>(place), &cursor);
 
-  for (; skip > 0 && likely(rc == FPTA_SUCCESS); --skip)
-    rc = fpta_cursor_move(cursor, fpta_next);
+  if (skip > 0 && likely(rc == FPTA_SUCCESS))
+    rc = fpta_cursor_seek_nth(cursor, skip);
 
   if (page_top) {
     if (rc == FPTA_SUCCESS) {
@@ -1274,17 +2288,191 @@ int fpta_apply_visitor(
     }
   }
 
-  if (cursor) {
-    int err = fpta_cursor_close(cursor);
-    assert(err == FPTA_SUCCESS);
-    if (unlikely(err != FPTA_SUCCESS))
-      rc = err;
+  if (cursor)
+    fpta_cursor_release(cursor);
+  return rc;
+}
+
+int fpta_apply_batch_visitor(
+    fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
+    fpta_value range_to, fpta_filter *filter, fpta_cursor_options op,
+    int (*visitor)(const fptu_ro *rows, size_t count, void *context),
+    void *visitor_context) {
+  if (unlikely(!visitor))
+    return FPTA_EINVAL;
+
+  alignas(fpta_cursor) char place[sizeof(fpta_cursor)];
+  fpta_cursor *cursor = nullptr;
+  int rc = fpta_cursor_setup(txn, column_id, range_from, range_to, filter,
+                             (fpta_cursor_options)(op & ~fpta_dont_fetch),
+                             reinterpret_cast<fpta_cursor *>(place), &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return (rc != FPTA_NODATA) ? rc : (int)FPTA_SUCCESS;
+
+  /* Числовые условия выгоднее проверять сразу для всего пакета строк,
+   * поэтому после позиционирования на первую подходящую строку курсор
+   * продолжает выборку без фильтра. */
+  const fpta_filter *const checked = cursor->filter;
+  const bool batched = fpta_filter_batchable(checked);
+  if (batched) {
+    cursor->filter = fpta_filter_any;
+    fpta_filter_program_destroy(cursor->filter_program);
+  }
+
+  /* Пакет строк ограничен, чтобы не влиять на управляемую сессию
+   * (см fpta_managed_check_interval) и не расходовать стек. */
+  cxx11_constexpr_var size_t batch = 64;
+  fptu_ro rows[batch];
+  for (;;) {
+    size_t n;
+    rc = fpta_cursor_get_batch(cursor, rows, batch, &n);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      if (likely(rc == FPTA_NODATA))
+        rc = FPTA_SUCCESS;
+      break;
+    }
+    if (batched && (n = fpta_filter_select_batch(checked, rows, n)) == 0)
+      continue;
+    rc = visitor(rows, n, visitor_context);
+    if (unlikely(rc != FPTA_SUCCESS))
+      break;
   }
+
+  fpta_cursor_release(cursor);
   return rc;
 }
 
 //----------------------------------------------------------------------------
 
+/* Продвигает отстающий курсор lag к ключу в позиции курсора lead: сначала
+ * одним шагом, а если этого недостаточно, то поиском. Таким образом плотные
+ * совпадения проходятся линейно, а пропуски перескакиваются. */
+static int fpta_merge_join_catchup(fpta_cursor *lag, const fpta_cursor *lead,
+                                   bool descending) {
+  int rc = fpta_cursor_move(lag, fpta_next);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const auto cmp =
+      mdbx_cmp(lag->txn->mdbx_txn, lag->idx_handle, &lag->current,
+               &lead->current);
+  if ((descending ? -cmp : cmp) >= 0)
+    return FPTA_SUCCESS;
+
+  fpta_value key;
+  rc = fpta_index_key2value(lead->index_shove(), lead->current, key);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  return fpta_cursor_locate(lag, false, &key, nullptr);
+}
+
+int fpta_merge_join(fpta_cursor *left, fpta_cursor *right,
+                    int (*visitor)(const fptu_ro *left_row,
+                                   const fptu_ro *right_row, void *context),
+                    void *visitor_context) {
+  int rc = fpta_cursor_validate(left, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  rc = fpta_cursor_validate(right, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  if (unlikely(!visitor || left == right || left->txn != right->txn))
+    return FPTA_EINVAL;
+  /* Ключ текущего совпадения и собранные строки указывают на страницы БД,
+   * которые в пишущей транзакции могут быть изменены или вытеснены. */
+  if (unlikely(left->txn->level != fpta_read))
+    return FPTA_EPERM;
+
+  if (unlikely(!fpta_cursor_is_ordered(left->options) ||
+               !fpta_cursor_is_ordered(right->options) ||
+               fpta_cursor_is_descending(left->options) !=
+                   fpta_cursor_is_descending(right->options) ||
+               ((left->options | right->options) & fpta_keys_only)))
+    return FPTA_EFLAG;
+
+  /* Ключи индексов сравниваются непосредственно, поэтому требуется
+   * одинаковое представление значений в ключах. */
+  const fpta_shove_t left_shove = left->index_shove();
+  const fpta_shove_t right_shove = right->index_shove();
+  cxx11_constexpr_var unsigned key_mode =
+      fpta_index_fobverse | fpta_index_fnullable;
+  if (unlikely(fpta_is_composite(left_shove) ||
+               fpta_shove2type(left_shove) != fpta_shove2type(right_shove) ||
+               (fpta_shove2index(left_shove) & key_mode) !=
+                   (fpta_shove2index(right_shove) & key_mode)))
+    return FPTA_ETYPE;
+
+  const bool descending = fpta_cursor_is_descending(left->options);
+  MDBX_txn *const mdbx_txn = left->txn->mdbx_txn;
+  std::vector<fptu_ro> group /* строки right с ключом текущего совпадения */;
+  for (;;) {
+    if (unlikely(!left->is_filled())) {
+      rc = left->unladed_state();
+      break;
+    }
+    if (unlikely(!right->is_filled())) {
+      rc = right->unladed_state();
+      break;
+    }
+
+    const auto cmp =
+        mdbx_cmp(mdbx_txn, left->idx_handle, &left->current, &right->current);
+    if (cmp != 0) {
+      rc = ((descending ? -cmp : cmp) < 0)
+               ? fpta_merge_join_catchup(left, right, descending)
+               : fpta_merge_join_catchup(right, left, descending);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+      continue;
+    }
+
+    /* Собираем строки right с совпадающим ключом. Ключ из позиции left
+     * остается действительным после перемещения курсора, так как указывает
+     * на данные внутри страницы читаемого MVCC-снимка. */
+    const MDBX_val key = left->current;
+    group.clear();
+    do {
+      fptu_ro row;
+      rc = fpta_cursor_get(right, &row);
+      if (unlikely(rc != FPTA_SUCCESS))
+        goto bailout;
+      try {
+        group.push_back(row);
+      } catch (const std::bad_alloc &) {
+        rc = FPTA_ENOMEM;
+        goto bailout;
+      }
+      rc = fpta_cursor_move(right, fpta_next);
+    } while (rc == FPTA_SUCCESS &&
+             mdbx_cmp(mdbx_txn, right->idx_handle, &right->current, &key) == 0);
+    if (unlikely(rc != FPTA_SUCCESS && rc != FPTA_NODATA))
+      break;
+
+    /* Сочетаем с ними строки left с тем же ключом. */
+    do {
+      fptu_ro row;
+      rc = fpta_cursor_get(left, &row);
+      if (unlikely(rc != FPTA_SUCCESS))
+        goto bailout;
+      for (const auto &item : group) {
+        rc = visitor(&row, &item, visitor_context);
+        if (unlikely(rc != FPTA_SUCCESS))
+          goto bailout;
+      }
+      rc = fpta_cursor_move(left, fpta_next);
+    } while (rc == FPTA_SUCCESS &&
+             mdbx_cmp(mdbx_txn, left->idx_handle, &left->current, &key) == 0);
+    if (unlikely(rc != FPTA_SUCCESS && rc != FPTA_NODATA))
+      break;
+  }
+
+bailout:
+  return (rc != FPTA_NODATA) ? rc : (int)FPTA_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
 int fpta_cursor_info(fpta_cursor *cursor, fpta_cursor_stat *stat) {
   int rc = fpta_cursor_validate(cursor, fpta_read);
   if (unlikely(rc != FPTA_SUCCESS))
@@ -1300,6 +2488,9 @@ int fpta_cursor_info(fpta_cursor *cursor, fpta_cursor_stat *stat) {
   stat->uniq_checks = cursor->metrics.uniq_checks;
   stat->upserts = cursor->metrics.upserts;
   stat->deletions = cursor->metrics.deletions;
+  stat->readaheads = cursor->metrics.readaheads;
+  stat->filter_reorders = cursor->filter_program.reorders;
+  stat->filter_swaps = cursor->filter_program.swaps;
 
   stat->selectivity_x1024 =
       (stat->results + stat->upserts + stat->deletions + 1) * 1024u /
@@ -1389,11 +2580,15 @@ int fpta_cursor_rerere(fpta_cursor *cursor) {
     if (rc != FPTA_SUCCESS ||
         mdbx_cmp(cursor->txn->mdbx_txn, cursor->idx_handle, &cursor->current,
                  &save_key) != 0)
-      return rc;
+      goto done;
 
     seek_op = MDBX_GET_BOTH_RANGE;
     seek_data = &save_data;
   }
 
-  return fpta_cursor_seek(cursor, seek_op, step_op, &save_key, seek_data);
+  rc = fpta_cursor_seek(cursor, seek_op, step_op, &save_key, seek_data);
+done:
+  if (unlikely(rc == FPTA_NODATA) && cursor->ranges)
+    rc = fpta_cursor_ranges_next(cursor, step_op == MDBX_NEXT);
+  return rc;
 }
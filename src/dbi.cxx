@@ -306,6 +306,68 @@ __cold int fpta_dbicache_cleanup(fpta_txn *txn, fpta_table_schema *table_def) {
 
 //----------------------------------------------------------------------------
 
+/* Состояние транзакции чтения, разделяемой между потоками.
+ *
+ * При первом обращении к таблице или индексу внутри транзакции libmdbx
+ * импортирует dbi-хендл и загружает актуальный корень b-дерева, изменяя при
+ * этом состояние самой транзакции. Для разделяемой транзакции это делается
+ * однократно под dbi_mutex, а готовность хендлов отмечается в битовой карте,
+ * проверка которой не требует блокировок. */
+struct fpta_txn_shared {
+  std::atomic<uint64_t> ready[(fpta_max_dbi + 64 + 63) / 64];
+};
+
+int fpta_dbicache_share(fpta_txn *txn) {
+  assert(txn->level == fpta_read && txn->shared == nullptr);
+  fpta_txn_shared *shared = new (std::nothrow) fpta_txn_shared();
+  if (unlikely(shared == nullptr))
+    return FPTA_ENOMEM;
+  for (auto &word : shared->ready)
+    word.store(0, std::memory_order_relaxed);
+  txn->shared = shared;
+  return FPTA_SUCCESS;
+}
+
+void fpta_dbicache_unshare(fpta_txn *txn) {
+  delete txn->shared;
+  txn->shared = nullptr;
+}
+
+__cold int fpta_dbicache_shared_prepare(fpta_txn *txn, MDBX_dbi handle) {
+  fpta_txn_shared *const shared = txn->shared;
+  if (unlikely(handle >= FPT_ARRAY_LENGTH(shared->ready) * 64))
+    return FPTA_EOOPS;
+
+  std::atomic<uint64_t> &word = shared->ready[handle / 64];
+  const uint64_t bit = UINT64_C(1) << (handle % 64);
+  fpta_lock_guard guard;
+  int rc = guard.lock(&txn->db->dbi_mutex);
+  if (unlikely(rc != 0))
+    return rc;
+  if (word.load(std::memory_order_relaxed) & bit)
+    return FPTA_SUCCESS;
+
+  /* mdbx_dbi_stat() импортирует хендл и загружает корень b-дерева. */
+  MDBX_stat stat;
+  rc = mdbx_dbi_stat(txn->mdbx_txn, handle, &stat, sizeof(stat));
+  if (likely(rc == MDBX_SUCCESS))
+    word.fetch_or(bit, std::memory_order_release);
+  return rc;
+}
+
+static __inline int fpta_dbicache_shared_check(fpta_txn *txn,
+                                               MDBX_dbi handle) {
+  if (likely(txn->shared == nullptr))
+    return FPTA_SUCCESS;
+  if (likely(handle < FPT_ARRAY_LENGTH(txn->shared->ready) * 64 &&
+             (txn->shared->ready[handle / 64].load(std::memory_order_acquire) &
+              (UINT64_C(1) << (handle % 64)))))
+    return FPTA_SUCCESS;
+  return fpta_dbicache_shared_prepare(txn, handle);
+}
+
+//----------------------------------------------------------------------------
+
 int __hot fpta_open_table(fpta_txn *txn, fpta_table_schema *table_def,
                           MDBX_dbi &handle) {
   const MDBX_db_flags_t dbi_flags =
@@ -314,10 +376,13 @@ int __hot fpta_open_table(fpta_txn *txn, fpta_table_schema *table_def,
   handle = fpta_dbicache_peek(txn, dbi_shove, table_def->handle_cache(0),
                               table_def->version_tsn());
   if (likely(handle > 0))
-    return FPTA_OK;
+    return fpta_dbicache_shared_check(txn, handle);
 
-  return fpta_dbicache_open(txn, dbi_shove, handle, dbi_flags,
-                            &table_def->handle_cache(0));
+  int rc = fpta_dbicache_open(txn, dbi_shove, handle, dbi_flags,
+                              &table_def->handle_cache(0));
+  if (likely(rc == FPTA_SUCCESS))
+    rc = fpta_dbicache_shared_check(txn, handle);
+  return rc;
 }
 
 int __hot fpta_open_column(fpta_txn *txn, fpta_name *column_id,
@@ -342,10 +407,13 @@ int __hot fpta_open_column(fpta_txn *txn, fpta_name *column_id,
       txn, dbi_shove, table_def->handle_cache(column_id->column.num),
       table_def->version_tsn());
   if (likely(idx_handle > 0))
-    return FPTA_OK;
+    return fpta_dbicache_shared_check(txn, idx_handle);
 
-  return fpta_dbicache_open(txn, dbi_shove, idx_handle, dbi_flags,
-                            &table_def->handle_cache(column_id->column.num));
+  rc = fpta_dbicache_open(txn, dbi_shove, idx_handle, dbi_flags,
+                          &table_def->handle_cache(column_id->column.num));
+  if (likely(rc == FPTA_SUCCESS))
+    rc = fpta_dbicache_shared_check(txn, idx_handle);
+  return rc;
 }
 
 int __hot fpta_open_secondaries(fpta_txn *txn, fpta_table_schema *table_def,
@@ -371,6 +439,9 @@ int __hot fpta_open_secondaries(fpta_txn *txn, fpta_table_schema *table_def,
       if (unlikely(rc != FPTA_SUCCESS))
         return rc;
     }
+    rc = fpta_dbicache_shared_check(txn, dbi_array[i]);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
   }
 
   return FPTA_SUCCESS;
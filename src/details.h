@@ -34,12 +34,85 @@
 using namespace fptu;
 using namespace fpta;
 
+/* Пул для размещения однотипных служебных объектов, т.е. экземпляров fpta_txn
+ * и fpta_cursor. Объекты нарезаются из блоков (chunks), которые возвращаются
+ * распределителю памяти только при закрытии БД.
+ *
+ * Свободные объекты собираются в глобальный lock-free список (стек Трайбера).
+ * Элементы списка адресуются 32-битными индексами, а в старшей половине
+ * головы списка хранится счетчик-тег, что защищает от ABA-проблемы.
+ * Дополнительно каждый поток держит небольшой кэш свободных объектов, поэтому
+ * в типичном сценарии (открыл-закрыл в одном потоке) обходится без атомарных
+ * операций и без обращений к общим линиям кэша. */
+struct fpta_pool {
+  fpta_pool(const fpta_pool &) = delete;
+
+  enum : unsigned {
+    chunk_items = 64 /* количество объектов в одном блоке */,
+    max_chunks = 1024 /* предел количества блоков, далее объекты размещаются
+                         индивидуально */
+    ,
+    cache_depth = 16 /* емкость кэша потока для одного пула */
+  };
+
+  struct node {
+    std::atomic<uint32_t> next;
+    uint32_t self /* индекс элемента, либо 0 для индивидуально размещенных */;
+    uint64_t padding /* выравнивание объекта на 16 байт */;
+  };
+
+  std::atomic<uint64_t> head;
+  size_t object_size, stride;
+  uint64_t serial;
+  fpta_alloc_func *alloc_func;
+  fpta_free_func *free_func;
+  void *alloc_ctx;
+  fpta_pool *registry_prev, *registry_next;
+  fpta_mutex_t grow_mutex;
+  unsigned chunks_count;
+  char *chunks[max_chunks];
+
+  int init(size_t object_size, const fpta_db_creation_params_ex_t *params);
+  void destroy();
+  void *get();
+  void put(void *object);
+
+  static node *object2node(void *object) {
+    return reinterpret_cast<node *>(static_cast<char *>(object) -
+                                    sizeof(node));
+  }
+  static void *node2object(node *item) {
+    return reinterpret_cast<char *>(item) + sizeof(node);
+  }
+  node *index2node(uint32_t index) const {
+    assert(index > 0);
+    index -= 1;
+    return reinterpret_cast<node *>(chunks[index / chunk_items] +
+                                    stride * (index % chunk_items));
+  }
+
+  node *pop();
+  void push(node *first, node *last);
+  node *grow();
+};
+
+/* Счетчик читателей схемы, занимающий отдельную линию кэша. Выравнивание
+ * гарантируется только при размещении fpta_db посредством fpta_db_alloc(). */
+struct alignas(CACHELINE_SIZE) fpta_schema_shard {
+  std::atomic<ptrdiff_t> readers;
+};
+
+static_assert(sizeof(fpta_schema_shard) == CACHELINE_SIZE &&
+                  alignof(fpta_schema_shard) == CACHELINE_SIZE,
+              "fpta_schema_shard must occupy exactly one cache line");
+
+enum { fpta_schema_shards = 32 };
+
 struct fpta_db {
   fpta_db(const fpta_db &) = delete;
   MDBX_env *mdbx_env;
   bool alterable_schema;
   MDBX_dbi schema_dbi;
-  fpta_rwl_t schema_rwlock;
   uint64_t schema_tsn;
   fpta_regime_flags regime_flags;
 
@@ -136,6 +209,32 @@ struct fpta_db {
     return FPTA_OK;
   }
 
+  fpta_pool txn_pool, cursor_pool;
+
+  /* Очередь групповой фиксации, создается при первом использовании,
+   * см fpta_submit_write(). */
+  std::atomic<struct fpta_group_commit *> group_commit;
+
+  /* Фоновый поток формирования сильных точек фиксации, см flusher.cxx */
+  struct fpta_flusher *flusher;
+
+  /* Фоновый прогрев страниц БД, см prewarm.cxx */
+  struct fpta_prewarm *prewarm;
+
+  /* Обработчик "отстающих" читателей, вызывается из fpta_hsr_callback(). */
+  fpta_laggard_func *laggard_func;
+  void *laggard_ctx;
+
+  /* Блокировка схемы для БД с alterable_schema = true.
+   * Вместо разделяемой rwlock используются распределенные по потокам счетчики
+   * читателей, поэтому при старте и завершении читающих транзакций запись
+   * в общие линии кэша не производится. Транзакция изменения схемы захватывает
+   * schema_mutex, взводит schema_altering и ждет обнуления суммы счетчиков,
+   * а запускаемые в это время читатели отступают и ждут на schema_mutex. */
+  std::atomic<bool> schema_altering;
+  fpta_mutex_t schema_mutex;
+  fpta_schema_shard schema_shards[fpta_schema_shards];
+
   fpta_mutex_t dbi_mutex /* TODO: убрать мьютекс и перевести на atomic */;
   fpta_shove_t dbi_shoves[fpta_dbi_cache_size];
   uint64_t dbi_tsns[fpta_dbi_cache_size];
@@ -188,13 +287,34 @@ public:
 
 //----------------------------------------------------------------------------
 
+void fpta_group_commit_destroy(fpta_db *db);
+int fpta_flusher_start(fpta_db *db, size_t threshold, unsigned period_ms);
+void fpta_flusher_stop(fpta_db *db);
+void fpta_prewarm_destroy(fpta_db *db);
+
 #define FILTER_PROPAGATE_TRUE (FPTA_ERRROR_LAST + 11)
 #define FILTER_PROPAGATE_FALSE (FPTA_ERRROR_LAST + 12)
 int fpta_filter_validate_and_rewrite(fpta_filter *filter);
+void fpta_filter_pushdown(fpta_txn *txn, MDBX_dbi idx_handle,
+                          fpta_shove_t shove, fpta_filter *&filter,
+                          fpta_value &range_from, fpta_value &range_to);
+const fpta_name *fpta_filter_keyed(const fpta_filter *filter,
+                                   fpta_shove_t shove);
 int fpta_name_refresh_filter(fpta_name *table_id, fpta_filter *filter);
 int fpta_name_refresh_column(fpta_name *table_id, fpta_name *column_id);
 __hot __noinline bool fpta_filter_match_internal(const fpta_filter *f,
                                                  fptu_ro tuple);
+int fpta_filter_compile(const fpta_filter *filter,
+                        fpta_filter_program &program, bool adaptive = false);
+void fpta_filter_program_destroy(fpta_filter_program &program);
+unsigned fpta_value_set_kinds(const fpta_value_set *set);
+__hot bool fpta_value_set_match(const fpta_value_set *set,
+                                const fptu_field *pf);
+__hot bool fpta_filter_program_match(fpta_filter_program &program,
+                                     fptu_ro tuple);
+bool fpta_filter_batchable(const fpta_filter *filter);
+size_t fpta_filter_select_batch(const fpta_filter *filter, fptu_ro *rows,
+                                size_t n);
 
 static __inline bool fpta_db_validate(const fpta_db *db) {
   if (unlikely(db == nullptr || db->mdbx_env == nullptr))
@@ -271,7 +391,12 @@ static __inline int fpta_cursor_validate(const fpta_cursor *cursor,
   if (unlikely(cursor == nullptr))
     return FPTA_EINVAL;
 
-  return fpta_txn_validate(cursor->txn, min_level);
+  int rc = fpta_txn_validate(cursor->txn, min_level);
+  if (unlikely(rc != FPTA_OK))
+    return rc;
+
+  /* Курсор отменен откатом точки сохранения, см fpta_savepoint_pop() */
+  return unlikely(cursor->cancelled) ? FPTA_TXN_CANCELLED : FPTA_OK;
 }
 
 //----------------------------------------------------------------------------
@@ -340,6 +465,48 @@ MDBX_dbi fpta_dbicache_remove(fpta_db *db, const fpta_shove_t shove,
                               unsigned *const cache_hint = nullptr);
 int fpta_dbicache_cleanup(fpta_txn *txn, fpta_table_schema *def);
 
+/* Состояние управляемой сессии чтения, см fpta_transaction_autorestart(). */
+struct fpta_txn_managed {
+  size_t lag_threshold, retired_threshold, space_threshold;
+  unsigned countdown /* перемещений курсоров до следующей проверки */;
+};
+
+enum {
+  fpta_managed_check_interval = 1024 /* интервал проверки необходимости
+                                        перезапуска в перемещениях курсоров */
+};
+
+/* Регистрация открытых курсоров транзакции, которые перепривязываются
+ * при завершении точек сохранения (см fpta_savepoint_pop()) и перезапуске
+ * управляемой сессии (см fpta_managed_checkpoint()). */
+void fpta_cursor_attach(fpta_cursor *cursor);
+void fpta_cursor_detach(fpta_cursor *cursor);
+
+int fpta_managed_checkpoint(fpta_txn *txn, bool force);
+
+/* Позиция курсора, сохраненная вне MVCC-снимка. */
+struct fpta_cursor_position {
+  void *buffer;
+  MDBX_val key, data;
+  uintptr_t eof /* позиция не заполнена, current.iov_base */;
+};
+
+int fpta_cursor_position_save(fpta_cursor *cursor, fpta_cursor_position *pos);
+int fpta_cursor_position_restore(fpta_cursor *cursor,
+                                 const fpta_cursor_position *pos);
+
+int fpta_cursor_setup(fpta_txn *txn, fpta_name *column_id,
+                      fpta_value range_from, fpta_value range_to,
+                      fpta_filter *filter, fpta_cursor_options options,
+                      fpta_cursor *place, fpta_cursor **pcursor,
+                      bool pushdown = true);
+void fpta_cursor_release(fpta_cursor *cursor);
+void fpta_cursor_range_activate(fpta_cursor *cursor, unsigned index);
+
+int fpta_dbicache_share(fpta_txn *txn);
+void fpta_dbicache_unshare(fpta_txn *txn);
+int fpta_dbicache_shared_prepare(fpta_txn *txn, MDBX_dbi handle);
+
 //----------------------------------------------------------------------------
 
 template <fptu_type type> struct numeric_traits;
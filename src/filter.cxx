@@ -364,6 +364,13 @@ __hot __noinline bool fpta_filter_match_internal(const fpta_filter *f,
       return f->node_fnrow.predicate(&tuple, f->node_fnrow.context,
                                      f->node_fnrow.arg);
 
+    case fpta_node_in: {
+      const fptu_field *pf =
+          fptu::lookup(tuple, f->node_in.left_id->column.num,
+                       fpta_id2type(f->node_in.left_id));
+      return pf && fpta_value_set_match(f->node_in.set, pf);
+    }
+
     default:
       int cmp_bits =
           fpta_filter_cmp(fptu::lookup(tuple, f->node_cmp.left_id->column.num,
@@ -377,6 +384,547 @@ __hot __noinline bool fpta_filter_match_internal(const fpta_filter *f,
 
 //----------------------------------------------------------------------------
 
+/* Компиляция фильтра в линейную программу.
+ *
+ * Каждому листу дерева (сравнению, предикату или константе) соответствует
+ * одна инструкция, в которой заранее определены номер и тип колонки, а также
+ * вид сравнения по типу значения. Узлы AND/OR/NOT инструкций не порождают,
+ * а превращаются в переходы между листьями с сокращенным вычислением:
+ * для AND переход к следующему операнду выполняется при истинности
+ * предыдущего, для OR - при ложности, а NOT меняет переходы местами.
+ *
+ * Листья и узлы AND/OR нумеруются в порядке обхода исходного дерева,
+ * независимо от перестановки операндов, чтобы счетчики листьев и маска
+ * перестановок сохраняли смысл при перекомпиляции. */
+
+/* Подсчитывает размеры поддерева и, если задан массив shapes, сохраняет
+ * в нем размеры первых операндов всех узлов AND/OR поддерева. Размеры
+ * вычисляются однократно при компиляции, после чего генерация программы
+ * выполняется за один линейный проход. */
+static fpta_filter_shape fpta_filter_measure(const fpta_filter *filter,
+                                             fpta_filter_shape *shapes,
+                                             unsigned junction) {
+  switch (filter->type) {
+  case fpta_node_not:
+    return fpta_filter_measure(filter->node_not, shapes, junction);
+  case fpta_node_or:
+  case fpta_node_and: {
+    const fpta_filter_shape a =
+        fpta_filter_measure(filter->node_and.a, shapes, junction + 1);
+    const fpta_filter_shape b = fpta_filter_measure(
+        filter->node_and.b, shapes, junction + 1 + a.junctions);
+    if (shapes)
+      shapes[junction] = a;
+    return fpta_filter_shape{a.leaves + b.leaves,
+                             a.junctions + b.junctions + 1};
+  }
+  default:
+    return fpta_filter_shape{1, 0};
+  }
+}
+
+static inline bool fpta_filter_swapped(uint64_t swaps, unsigned junction) {
+  return junction < fpta_filter_program::max_swaps &&
+         (swaps >> junction) & 1;
+}
+
+static void fpta_filter_emit(const fpta_filter_program &program,
+                             const fpta_filter *filter, unsigned pc,
+                             unsigned leaves, unsigned leaf, unsigned junction,
+                             uint16_t on_true, uint16_t on_false) {
+  switch (filter->type) {
+  case fpta_node_not:
+    fpta_filter_emit(program, filter->node_not, pc, leaves, leaf, junction,
+                     on_false, on_true);
+    return;
+
+  case fpta_node_and:
+  case fpta_node_or: {
+    const fpta_filter_shape &a = program.shapes[junction];
+    const fpta_filter *first = filter->node_and.a;
+    const fpta_filter *second = filter->node_and.b;
+    unsigned first_leaves = a.leaves, second_leaves = leaves - a.leaves;
+    unsigned first_leaf = leaf, second_leaf = leaf + a.leaves;
+    unsigned first_junction = junction + 1,
+             second_junction = junction + 1 + a.junctions;
+    if (fpta_filter_swapped(program.swaps, junction)) {
+      std::swap(first, second);
+      std::swap(first_leaves, second_leaves);
+      std::swap(first_leaf, second_leaf);
+      std::swap(first_junction, second_junction);
+    }
+    const unsigned next = pc + first_leaves;
+    if (filter->type == fpta_node_and)
+      fpta_filter_emit(program, first, pc, first_leaves, first_leaf,
+                       first_junction, uint16_t(next), on_false);
+    else
+      fpta_filter_emit(program, first, pc, first_leaves, first_leaf,
+                       first_junction, on_true, uint16_t(next));
+    fpta_filter_emit(program, second, next, second_leaves, second_leaf,
+                     second_junction, on_true, on_false);
+    return;
+  }
+
+  default:
+    break;
+  }
+
+  assert(leaves == 1);
+  fpta_filter_op &op = program.ops[pc];
+  op.bits = 0;
+  op.type = 0;
+  op.slot = 0;
+  op.column = 0;
+  op.on_true = on_true;
+  op.on_false = on_false;
+  op.leaf = uint16_t(leaf);
+  op.value.uint = 0;
+  op.node = filter;
+
+  switch (filter->type) {
+  case fpta_node_collapsed_true:
+  case fpta_node_cond_true:
+    op.code = fpta_filter_op::op_true;
+    return;
+
+  default:
+    assert(false);
+    __fallthrough;
+  case fpta_node_collapsed_false:
+  case fpta_node_cond_false:
+    op.code = fpta_filter_op::op_false;
+    return;
+
+  case fpta_node_fncol:
+    op.code = fpta_filter_op::op_fncol;
+    op.column = uint16_t(filter->node_fncol.column_id->column.num);
+    op.type = uint8_t(fpta_id2type(filter->node_fncol.column_id));
+    return;
+
+  case fpta_node_fnrow:
+    op.code = fpta_filter_op::op_fnrow;
+    return;
+
+  case fpta_node_in:
+    op.code = fpta_filter_op::op_in;
+    op.column = uint16_t(filter->node_in.left_id->column.num);
+    op.type = uint8_t(fpta_id2type(filter->node_in.left_id));
+    return;
+
+  case fpta_node_lt:
+  case fpta_node_gt:
+  case fpta_node_le:
+  case fpta_node_ge:
+  case fpta_node_eq:
+  case fpta_node_ne:
+    break;
+  }
+
+  const fpta_value &right = filter->node_cmp.right_value;
+  op.bits = uint8_t(filter->type);
+  op.column = uint16_t(filter->node_cmp.left_id->column.num);
+  op.type = uint8_t(fpta_id2type(filter->node_cmp.left_id));
+  switch (right.type) {
+  default:
+    assert(false);
+    op.code = fpta_filter_op::op_false;
+    break;
+  case fpta_null:
+    op.code = fpta_filter_op::op_cmp_null;
+    break;
+  case fpta_signed_int:
+    op.code = fpta_filter_op::op_cmp_sint;
+    op.value.sint = right.sint;
+    break;
+  case fpta_unsigned_int:
+    op.code = fpta_filter_op::op_cmp_uint;
+    op.value.uint = right.uint;
+    break;
+  case fpta_float_point:
+    op.code = fpta_filter_op::op_cmp_fp;
+    op.value.fp = right.fp;
+    break;
+  case fpta_datetime:
+    op.code = fpta_filter_op::op_cmp_datetime;
+    op.value.datetime = right.datetime.fixedpoint;
+    break;
+  case fpta_string:
+    op.code = fpta_filter_op::op_cmp_string;
+    break;
+  case fpta_binary:
+  case fpta_shoved:
+    op.code = fpta_filter_op::op_cmp_binary;
+    break;
+  }
+}
+
+static inline bool fpta_filter_op_lookup(const fpta_filter_op &op) {
+  return op.code >= fpta_filter_op::op_cmp_null &&
+         op.code <= fpta_filter_op::op_fncol;
+}
+
+static inline uint64_t fpta_filter_bloom(unsigned tag) {
+  return UINT64_C(1) << (fptu_get_colnum(uint_fast16_t(tag)) & 63);
+}
+
+/* Назначает инструкциям слоты в таблице полей строки, если программа
+ * обращается к полям более одного раза и количество различных полей
+ * не превышает размер таблицы. */
+static void fpta_filter_assign_slots(fpta_filter_program &program,
+                                     fpta_filter_op *ops, unsigned count) {
+  unsigned lookups = 0, slots = 0;
+  uint64_t bloom = 0;
+  for (unsigned pc = 0; pc < count; ++pc) {
+    fpta_filter_op &op = ops[pc];
+    if (!fpta_filter_op_lookup(op))
+      continue;
+    lookups += 1;
+    const uint16_t tag =
+        uint16_t(fptu::make_tag(op.column, fptu_type(op.type)));
+    unsigned slot = 0;
+    while (slot < slots && program.tags[slot] != tag)
+      ++slot;
+    if (slot == slots) {
+      if (slots == fpta_filter_program::max_slots)
+        return;
+      program.tags[slots++] = tag;
+      bloom |= fpta_filter_bloom(tag);
+    }
+    op.slot = uint8_t(slot);
+  }
+
+  if (lookups > 1) {
+    program.slots = slots;
+    program.slots_bloom = bloom;
+  }
+}
+
+/* Заполняет таблицу полей строки за один просмотр заголовков полей. Как и
+ * fptu::lookup(), для каждой колонки выбирается первое подходящее поле. */
+static __hot void fpta_filter_resolve(const fpta_filter_program &program,
+                                      fptu_ro tuple,
+                                      const fptu_field **fields) {
+  for (unsigned slot = 0; slot < program.slots; ++slot)
+    fields[slot] = nullptr;
+
+  const fptu_field *const end = fptu::end(tuple);
+  unsigned missing = program.slots;
+  for (const fptu_field *pf = fptu::begin(tuple); pf < end; ++pf) {
+    const unsigned tag = pf->tag;
+    if ((program.slots_bloom & fpta_filter_bloom(tag)) == 0)
+      continue;
+    for (unsigned slot = 0; slot < program.slots; ++slot) {
+      if (program.tags[slot] == tag) {
+        if (fields[slot] == nullptr) {
+          fields[slot] = pf;
+          if (--missing == 0)
+            return;
+        }
+        break;
+      }
+    }
+  }
+}
+
+/* Условная стоимость вычисления листа фильтра. */
+static double fpta_filter_cost(const fpta_filter *leaf) {
+  switch (leaf->type) {
+  default:
+    return 0 /* константы */;
+  case fpta_node_lt:
+  case fpta_node_gt:
+  case fpta_node_le:
+  case fpta_node_ge:
+  case fpta_node_eq:
+  case fpta_node_ne:
+    return (leaf->node_cmp.right_value.type < fpta_string) ? 1 : 2;
+  case fpta_node_in:
+    return 3;
+  case fpta_node_fncol:
+    return 4;
+  case fpta_node_fnrow:
+    return 8;
+  }
+}
+
+struct fpta_filter_estimate {
+  double pass /* вероятность истинности */;
+  double cost /* ожидаемая стоимость вычисления */;
+};
+
+/* Оценивает поддерево по счетчикам листьев и выбирает для каждого узла
+ * AND/OR порядок операндов с минимальной ожидаемой стоимостью. Размеры
+ * операндов берутся из программы, т.е. оценка выполняется за один проход. */
+static fpta_filter_estimate
+fpta_filter_reorder(const fpta_filter_program &program,
+                    const fpta_filter *filter, unsigned leaf,
+                    unsigned junction, uint64_t &swaps) {
+  switch (filter->type) {
+  case fpta_node_not: {
+    const fpta_filter_estimate child =
+        fpta_filter_reorder(program, filter->node_not, leaf, junction, swaps);
+    return fpta_filter_estimate{1 - child.pass, child.cost};
+  }
+
+  case fpta_node_and:
+  case fpta_node_or: {
+    const fpta_filter_shape &shape = program.shapes[junction];
+    const fpta_filter_estimate a = fpta_filter_reorder(
+        program, filter->node_and.a, leaf, junction + 1, swaps);
+    const fpta_filter_estimate b =
+        fpta_filter_reorder(program, filter->node_and.b, leaf + shape.leaves,
+                            junction + 1 + shape.junctions, swaps);
+    /* Второй операнд вычисляется, если первый не определил результат. */
+    const bool is_and = filter->type == fpta_node_and;
+    const double a_first = a.cost + (is_and ? a.pass : 1 - a.pass) * b.cost;
+    const double b_first = b.cost + (is_and ? b.pass : 1 - b.pass) * a.cost;
+    if (junction < fpta_filter_program::max_swaps) {
+      const uint64_t bit = UINT64_C(1) << junction;
+      /* Порядок меняется только при заметном выигрыше. */
+      if ((swaps & bit) ? a_first < b_first * 0.9 : b_first < a_first * 0.9)
+        swaps ^= bit;
+    }
+    const double pass =
+        is_and ? a.pass * b.pass : 1 - (1 - a.pass) * (1 - b.pass);
+    return fpta_filter_estimate{
+        pass, fpta_filter_swapped(swaps, junction) ? b_first : a_first};
+  }
+
+  default:
+    /* Априорная вероятность 1/2, пока нет статистики. */
+    const fpta_filter_stat &stat = program.stats[leaf];
+    return fpta_filter_estimate{(stat.passes + 1.0) / (stat.evaluations + 2.0),
+                                fpta_filter_cost(filter)};
+  }
+}
+
+/* Перегенерирует только поддеревья узлов AND/OR, перестановка операндов
+ * которых изменилась согласно маске changed. Поддерево занимает тот же
+ * непрерывный диапазон инструкций и имеет те же выходы, поэтому остальная
+ * часть программы остается без изменений. */
+static void fpta_filter_patch(const fpta_filter_program &program,
+                              const fpta_filter *filter, unsigned pc,
+                              unsigned leaves, unsigned leaf,
+                              unsigned junction, uint64_t changed,
+                              uint16_t on_true, uint16_t on_false) {
+  /* в поддереве из N листьев ровно N-1 узлов AND/OR */
+  const unsigned end = junction + leaves - 1;
+  if (end < fpta_filter_program::max_swaps)
+    changed &= (UINT64_C(1) << end) - 1;
+  if (junction >= fpta_filter_program::max_swaps || (changed >> junction) == 0)
+    return;
+
+  switch (filter->type) {
+  case fpta_node_not:
+    fpta_filter_patch(program, filter->node_not, pc, leaves, leaf, junction,
+                      changed, on_false, on_true);
+    return;
+
+  case fpta_node_and:
+  case fpta_node_or: {
+    if ((changed >> junction) & 1) {
+      fpta_filter_emit(program, filter, pc, leaves, leaf, junction, on_true,
+                       on_false);
+      return;
+    }
+    const fpta_filter_shape &a = program.shapes[junction];
+    const fpta_filter *first = filter->node_and.a;
+    const fpta_filter *second = filter->node_and.b;
+    unsigned first_leaves = a.leaves, second_leaves = leaves - a.leaves;
+    unsigned first_leaf = leaf, second_leaf = leaf + a.leaves;
+    unsigned first_junction = junction + 1,
+             second_junction = junction + 1 + a.junctions;
+    if (fpta_filter_swapped(program.swaps, junction)) {
+      std::swap(first, second);
+      std::swap(first_leaves, second_leaves);
+      std::swap(first_leaf, second_leaf);
+      std::swap(first_junction, second_junction);
+    }
+    const unsigned next = pc + first_leaves;
+    if (filter->type == fpta_node_and)
+      fpta_filter_patch(program, first, pc, first_leaves, first_leaf,
+                        first_junction, changed, uint16_t(next), on_false);
+    else
+      fpta_filter_patch(program, first, pc, first_leaves, first_leaf,
+                        first_junction, changed, on_true, uint16_t(next));
+    fpta_filter_patch(program, second, next, second_leaves, second_leaf,
+                      second_junction, changed, on_true, on_false);
+    return;
+  }
+
+  default:
+    return;
+  }
+}
+
+static void fpta_filter_program_slots(fpta_filter_program &program) {
+  program.slots = 0;
+  program.slots_bloom = 0;
+  fpta_filter_assign_slots(program, program.ops, program.count);
+}
+
+static void fpta_filter_program_emit(fpta_filter_program &program) {
+  fpta_filter_emit(program, program.root, 0, program.count, 0, 0,
+                   fpta_filter_op::goto_true, fpta_filter_op::goto_false);
+  fpta_filter_program_slots(program);
+}
+
+static __noinline void fpta_filter_program_adapt(fpta_filter_program &program) {
+  uint64_t swaps = program.swaps;
+  fpta_filter_reorder(program, program.root, 0, 0, swaps);
+  if (swaps != program.swaps) {
+    const uint64_t changed = swaps ^ program.swaps;
+    program.swaps = swaps;
+    program.reorders += 1;
+    fpta_filter_patch(program, program.root, 0, program.count, 0, 0, changed,
+                      fpta_filter_op::goto_true, fpta_filter_op::goto_false);
+    fpta_filter_program_slots(program);
+  }
+
+  /* Старая статистика постепенно забывается. */
+  for (unsigned i = 0; i < program.count; ++i) {
+    program.stats[i].evaluations >>= 1;
+    program.stats[i].passes >>= 1;
+  }
+  program.evaluations = 0;
+}
+
+int fpta_filter_compile(const fpta_filter *filter,
+                        fpta_filter_program &program, bool adaptive) {
+  fpta_filter_program_destroy(program);
+  if (filter == fpta_filter_any || filter == fpta_filter_none)
+    return FPTA_SUCCESS;
+
+  const fpta_filter_shape shape = fpta_filter_measure(filter, nullptr, 0);
+  if (unlikely(shape.leaves > fpta_filter_op::max_ops))
+    return FPTA_TOOMANY;
+
+  fpta_filter_op *ops = program.place;
+  fpta_filter_stat *stats = program.stats_place;
+  fpta_filter_shape *shapes = program.shapes_place;
+  if (shape.leaves > fpta_filter_program::place_ops) {
+    const size_t stats_bytes =
+        adaptive ? sizeof(fpta_filter_stat) * shape.leaves : 0;
+    ops = static_cast<fpta_filter_op *>(
+        malloc(sizeof(fpta_filter_op) * shape.leaves + stats_bytes +
+               sizeof(fpta_filter_shape) * shape.junctions));
+    if (unlikely(ops == nullptr))
+      return FPTA_ENOMEM;
+    program.allocated = ops;
+    stats = reinterpret_cast<fpta_filter_stat *>(ops + shape.leaves);
+    shapes = reinterpret_cast<fpta_filter_shape *>(
+        reinterpret_cast<char *>(stats) + stats_bytes);
+  }
+
+  program.ops = ops;
+  program.root = filter;
+  program.count = shape.leaves;
+  if (shape.junctions) {
+    fpta_filter_measure(filter, shapes, 0);
+    program.shapes = shapes;
+  }
+  if (adaptive && shape.junctions) {
+    memset(stats, 0, sizeof(fpta_filter_stat) * shape.leaves);
+    program.stats = stats;
+  }
+  fpta_filter_program_emit(program);
+  return FPTA_SUCCESS;
+}
+
+void fpta_filter_program_destroy(fpta_filter_program &program) {
+  free(program.allocated);
+  program.allocated = nullptr;
+  program.ops = nullptr;
+  program.root = nullptr;
+  program.count = 0;
+  program.slots = 0;
+  program.slots_bloom = 0;
+  program.shapes = nullptr;
+  program.stats = nullptr;
+  program.swaps = 0;
+  program.evaluations = 0;
+  program.reorders = 0;
+}
+
+__hot bool fpta_filter_program_match(fpta_filter_program &program,
+                                     fptu_ro tuple) {
+  const fptu_field *fields[fpta_filter_program::max_slots];
+  if (program.slots)
+    fpta_filter_resolve(program, tuple, fields);
+
+  const fpta_filter_op *const ops = program.ops;
+  unsigned pc = 0;
+  while (true) {
+    const fpta_filter_op &op = ops[pc];
+    bool match;
+    if (op.code < fpta_filter_op::op_cmp_null)
+      match = op.code == fpta_filter_op::op_true;
+    else if (op.code == fpta_filter_op::op_fnrow)
+      match = op.node->node_fnrow.predicate(&tuple, op.node->node_fnrow.context,
+                                            op.node->node_fnrow.arg);
+    else {
+      const fptu_field *pf =
+          program.slots ? fields[op.slot]
+                        : fptu::lookup(tuple, op.column, fptu_type(op.type));
+      if (op.code == fpta_filter_op::op_fncol)
+        match = op.node->node_fncol.predicate(pf, op.node->node_fncol.arg);
+      else if (op.code == fpta_filter_op::op_in)
+        match = pf && fpta_value_set_match(op.node->node_in.set, pf);
+      else {
+        fptu_lge cmp;
+        if (unlikely(pf == nullptr))
+          cmp = (op.code == fpta_filter_op::op_cmp_null) ? fptu_eq : fptu_ic;
+        else {
+          const fpta_value &right = op.node->node_cmp.right_value;
+          switch (op.code) {
+          case fpta_filter_op::op_cmp_null:
+            cmp = fpta_cmp_null(pf);
+            break;
+          case fpta_filter_op::op_cmp_sint:
+            cmp = fpta_cmp_sint(pf, op.value.sint);
+            break;
+          case fpta_filter_op::op_cmp_uint:
+            cmp = fpta_cmp_uint(pf, op.value.uint);
+            break;
+          case fpta_filter_op::op_cmp_fp:
+            cmp = fpta_cmp_fp(pf, op.value.fp);
+            break;
+          case fpta_filter_op::op_cmp_datetime:
+            cmp = fpta_cmp_datetime(pf, right.datetime);
+            break;
+          case fpta_filter_op::op_cmp_string:
+            cmp = fpta_cmp_string(pf, right.str, right.binary_length);
+            break;
+          case fpta_filter_op::op_cmp_binary:
+            cmp = fpta_cmp_binary(pf, right.binary_data, right.binary_length);
+            break;
+          default:
+            assert(false);
+            cmp = fptu_ic;
+          }
+        }
+        match = (cmp & op.bits) != 0;
+      }
+    }
+
+    if (program.stats) {
+      fpta_filter_stat &stat = program.stats[op.leaf];
+      stat.evaluations += 1;
+      stat.passes += match;
+    }
+
+    pc = match ? op.on_true : op.on_false;
+    if (pc >= fpta_filter_op::goto_false) {
+      if (program.stats &&
+          unlikely(++program.evaluations >= fpta_filter_program::adapt_period))
+        fpta_filter_program_adapt(program);
+      return pc == fpta_filter_op::goto_true;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
 static int fpta_filter_rewrite_on_error(fpta_filter *filter, int err) {
   assert(err != FPTA_SUCCESS);
 
@@ -466,6 +1014,21 @@ int fpta_filter_validate_and_rewrite(fpta_filter *filter) {
       return FPTA_EINVAL;
     return FPTA_SUCCESS;
 
+  case fpta_node_in:
+    if (unlikely(!filter->node_in.set))
+      return FPTA_EINVAL;
+    for (unsigned kinds = fpta_value_set_kinds(filter->node_in.set),
+                  kind = 0;
+         kinds; kinds >>= 1, ++kind)
+      if ((kinds & 1) &&
+          fpta_cmp_is_compat(fpta_name_coltype(filter->node_in.left_id),
+                             fpta_value_type(kind)))
+        return FPTA_SUCCESS;
+    /* Ни одно из значений несравнимо с колонкой (в том числе для пустого
+     * множества). Сам узел не изменяется, чтобы множество оставалось
+     * доступным для fpta_filter_in_destroy(). */
+    return FILTER_PROPAGATE_FALSE;
+
   case fpta_node_not:
     assert(filter->node_not == filter->node_or.a &&
            filter->node_not == filter->node_and.a &&
@@ -524,6 +1087,264 @@ int fpta_filter_validate_and_rewrite(fpta_filter *filter) {
 
 //----------------------------------------------------------------------------
 
+/* Сужение диапазона курсора по условиям фильтра.
+ *
+ * Условия сравнения ключевой колонки курсора, связанные с корнем фильтра
+ * только через AND, сужают диапазон: >= и > задают нижнюю границу (для >
+ * включительно, а само условие остается в фильтре), < задает верхнюю
+ * границу, а == выборку одного значения. Условие <= не может быть выражено
+ * полуоткрытым диапазоном и не используется.
+ *
+ * Сам фильтр не изменяется, так как принадлежит пользователю и может
+ * использоваться с другими курсорами. Вместо этого курсору передается
+ * поддерево фильтра без условий, которые гарантированно выполняются для всех
+ * строк суженного диапазона. */
+
+struct fpta_pushdown_bound {
+  const fpta_value *value;
+  fpta_key key;
+};
+
+struct fpta_pushdown {
+  MDBX_txn *mdbx_txn;
+  MDBX_dbi dbi;
+  fpta_shove_t shove;
+  bool ordered /* порядок ключей совпадает с порядком значений */;
+  bool exact /* равенство ключей означает равенство значений, а строки
+                без значения колонки (NULL) отсутствуют в индексе */;
+  bool empty;
+  fpta_pushdown_bound lower, upper, point;
+
+  int cmp(const fpta_key &a, const fpta_key &b) const {
+    return mdbx_cmp(mdbx_txn, dbi, &a.mdbx, &b.mdbx);
+  }
+  bool own(const fpta_filter *node) const;
+  bool prepare(const fpta_value &value, fpta_key &key) const;
+  void narrow(fpta_pushdown_bound &bound, const fpta_value &value, int sign);
+  void collect(const fpta_filter *filter);
+  bool redundant(const fpta_filter *node) const;
+  fpta_filter *prune(fpta_filter *filter) const;
+};
+
+bool fpta_pushdown::own(const fpta_filter *node) const {
+  switch (node->type) {
+  default:
+    return false;
+  case fpta_node_lt:
+  case fpta_node_gt:
+  case fpta_node_le:
+  case fpta_node_ge:
+  case fpta_node_eq:
+    return node->node_cmp.left_id->shove == shove;
+  }
+}
+
+bool fpta_pushdown::prepare(const fpta_value &value, fpta_key &key) const {
+  switch (value.type) {
+  default:
+    return false;
+  case fpta_string:
+  case fpta_binary:
+    /* Длинные значения обрезаются в ключе, и тогда порядок ключей
+     * не совпадает с порядком значений. */
+    if (ordered && value.binary_length > unsigned(fpta_max_keylen))
+      return false;
+    __fallthrough;
+  case fpta_signed_int:
+  case fpta_unsigned_int:
+  case fpta_datetime:
+  case fpta_float_point:
+    break;
+  }
+
+  if (!fpta_index_is_compat(shove, value) ||
+      fpta_index_value2key(shove, value, key, false) != FPTA_SUCCESS)
+    return false;
+
+  if (value.type == fpta_float_point) {
+    /* Значение должно быть представимо в ключе без округления. */
+    fpta_value back;
+    if (fpta_index_key2value(shove, key.mdbx, back) != FPTA_SUCCESS ||
+        back.type != fpta_float_point || back.fp != value.fp)
+      return false;
+  }
+  return true;
+}
+
+void fpta_pushdown::narrow(fpta_pushdown_bound &bound, const fpta_value &value,
+                           int sign) {
+  fpta_key key;
+  if (!prepare(value, key))
+    return;
+  if (!bound.value || cmp(key, bound.key) * sign > 0) {
+    bound.value = &value;
+    prepare(value, bound.key);
+  }
+}
+
+void fpta_pushdown::collect(const fpta_filter *filter) {
+  while (filter->type == fpta_node_and) {
+    collect(filter->node_and.a);
+    filter = filter->node_and.b;
+  }
+  if (!own(filter))
+    return;
+
+  const fpta_value &value = filter->node_cmp.right_value;
+  switch (filter->type) {
+  default:
+    break;
+  case fpta_node_gt:
+  case fpta_node_ge:
+    if (ordered)
+      narrow(lower, value, 1);
+    break;
+  case fpta_node_lt:
+    if (ordered)
+      narrow(upper, value, -1);
+    break;
+  case fpta_node_eq: {
+    fpta_key key;
+    if (!prepare(value, key))
+      break;
+    if (point.value && cmp(key, point.key) != 0)
+      /* Условия равенства разным значениям. */
+      empty = true;
+    else if (!point.value) {
+      point.value = &value;
+      prepare(value, point.key);
+    }
+  } break;
+  }
+}
+
+bool fpta_pushdown::redundant(const fpta_filter *node) const {
+  if (!exact || !own(node))
+    return false;
+
+  fpta_key key;
+  if (!prepare(node->node_cmp.right_value, key))
+    return false;
+  if (point.value)
+    return node->type == fpta_node_eq && cmp(key, point.key) == 0;
+  if (node->type == fpta_node_ge)
+    return lower.value && cmp(key, lower.key) == 0;
+  if (node->type == fpta_node_lt)
+    return upper.value && cmp(key, upper.key) == 0;
+  return false;
+}
+
+fpta_filter *fpta_pushdown::prune(fpta_filter *filter) const {
+  if (filter->type != fpta_node_and)
+    return redundant(filter) ? fpta_filter_any : filter;
+
+  fpta_filter *const a = prune(filter->node_and.a);
+  fpta_filter *const b = prune(filter->node_and.b);
+  if (a == fpta_filter_any)
+    return b;
+  if (b == fpta_filter_any)
+    return a;
+  /* Новый узел AND не создается, поэтому частично сокращенные поддеревья
+   * используются только целиком. */
+  return filter;
+}
+
+void fpta_filter_pushdown(fpta_txn *txn, MDBX_dbi idx_handle,
+                          fpta_shove_t shove, fpta_filter *&filter,
+                          fpta_value &range_from, fpta_value &range_to) {
+  assert(filter != fpta_filter_any && filter != fpta_filter_none);
+  const fptu_type type = fpta_shove2type(shove);
+  const fpta_index_type index = fpta_shove2index(shove);
+
+  fpta_pushdown pushdown;
+  pushdown.mdbx_txn = txn->mdbx_txn;
+  pushdown.dbi = idx_handle;
+  pushdown.shove = shove;
+  /* Для упорядоченных индексов порядок ключей совпадает с порядком значений,
+   * за исключением обратного порядка для двоичных данных и строк. */
+  pushdown.ordered = fpta_index_is_ordered(index) &&
+                     (type < fptu_96 || fpta_index_is_obverse(index));
+  pushdown.exact = pushdown.ordered && !fpta_column_is_nullable(shove) &&
+                   type != fptu_fp32 && type != fptu_fp64;
+  pushdown.empty = false;
+  pushdown.lower.value = pushdown.upper.value = pushdown.point.value = nullptr;
+
+  if (range_from.type <= fpta_shoved) {
+    if (!pushdown.ordered ||
+        fpta_index_value2key(shove, range_from, pushdown.lower.key, false) !=
+            FPTA_SUCCESS)
+      return;
+    pushdown.lower.value = &range_from;
+  }
+  if (range_to.type <= fpta_shoved) {
+    if (!pushdown.ordered ||
+        fpta_index_value2key(shove, range_to, pushdown.upper.key, false) !=
+            FPTA_SUCCESS)
+      return;
+    pushdown.upper.value = &range_to;
+  }
+
+  pushdown.collect(filter);
+  if (pushdown.point.value) {
+    if ((pushdown.lower.value &&
+         pushdown.cmp(pushdown.point.key, pushdown.lower.key) < 0) ||
+        (pushdown.upper.value &&
+         pushdown.cmp(pushdown.point.key, pushdown.upper.key) >= 0))
+      pushdown.empty = true;
+  } else if (pushdown.lower.value && pushdown.upper.value &&
+             pushdown.cmp(pushdown.lower.key, pushdown.upper.key) >= 0)
+    pushdown.empty = true;
+
+  if (pushdown.empty) {
+    filter = fpta_filter_none;
+    return;
+  }
+
+  filter = pushdown.prune(filter);
+  if (pushdown.point.value) {
+    range_from = *pushdown.point.value;
+    range_to = fpta_value_epsilon();
+  } else {
+    range_from =
+        pushdown.lower.value ? *pushdown.lower.value : fpta_value_begin();
+    range_to = pushdown.upper.value ? *pushdown.upper.value : fpta_value_end();
+  }
+}
+
+/* Возвращает идентификатор колонки с заданным shove, если все условия
+ * фильтра относятся только к ней, иначе nullptr. Такой фильтр может быть
+ * проверен по значению ключа индекса, без чтения строк. */
+const fpta_name *fpta_filter_keyed(const fpta_filter *filter,
+                                   fpta_shove_t shove) {
+  const fpta_name *id;
+  switch (filter->type) {
+  case fpta_node_collapsed_true:
+  case fpta_node_cond_true:
+  case fpta_node_collapsed_false:
+  case fpta_node_cond_false:
+  case fpta_node_fnrow:
+    return nullptr;
+  case fpta_node_not:
+    return fpta_filter_keyed(filter->node_not, shove);
+  case fpta_node_or:
+  case fpta_node_and:
+    id = fpta_filter_keyed(filter->node_and.a, shove);
+    return (id && fpta_filter_keyed(filter->node_and.b, shove)) ? id : nullptr;
+  case fpta_node_fncol:
+    id = filter->node_fncol.column_id;
+    break;
+  case fpta_node_in:
+    id = filter->node_in.left_id;
+    break;
+  default:
+    id = filter->node_cmp.left_id;
+    break;
+  }
+  return (id->shove == shove) ? id : nullptr;
+}
+
+//----------------------------------------------------------------------------
+
 __hot int fpta_name_refresh_filter(fpta_name *table_id, fpta_filter *filter) {
   /* Функция fpta_name_refresh_filter() не доступна пользователю
    * и вызывается только из fpta_cursor_open(). Причем до вызова
@@ -554,6 +1375,9 @@ __hot int fpta_name_refresh_filter(fpta_name *table_id, fpta_filter *filter) {
     case fpta_node_ne:
       return fpta_name_refresh_column(table_id, filter->node_cmp.left_id);
 
+    case fpta_node_in:
+      return fpta_name_refresh_column(table_id, filter->node_in.left_id);
+
     case fpta_node_not:
       filter = filter->node_not;
       continue /* tail recursion */;
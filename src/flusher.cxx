@@ -0,0 +1,301 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <system_error>
+#include <thread>
+
+/* Фоновое формирование сильных точек фиксации для режимов fpta_lazy
+ * и fpta_weak.
+ *
+ * Поток периодически проверяет объем и "возраст" несинхронизированных
+ * изменений и при превышении заданных порогов выполняет mdbx_env_sync().
+ * Потоки ожидающие устойчивости конкретной версии данных (см
+ * fpta_db_wait_durable()) взводят requested и будят фоновый поток, после
+ * чего ждут на synced.
+ *
+ * При остановке фоновый поток выполняет финальную фиксацию для уже
+ * ожидающих, а fpta_flusher_stop() дожидается их ухода (waiters == 0)
+ * прежде чем освободить мьютекс и условные переменные. */
+
+enum {
+  fpta_flusher_poll_ms = 10 /* интервал проверки порога по объему */
+};
+
+struct fpta_flusher {
+  fpta_db *db;
+  size_t threshold;
+  unsigned period_ms;
+
+  fpta_mutex_t mutex;
+  fpta_cond_t wakeup /* будит фоновый поток */,
+      synced /* будит ожидающих после фиксации */;
+  uint64_t requested /* максимальная версия ожидаемая в fpta_db_wait_durable */;
+  uint64_t durable /* последняя известная устойчивая версия */;
+  int error /* ошибка последней фиксации */;
+  unsigned waiters /* потоки внутри fpta_db_wait_durable() */;
+  bool stop, finished /* фоновый поток выполнил финальную фиксацию */;
+  std::thread thread;
+
+  void run();
+};
+
+static int fpta_durable_version(MDBX_env *env, uint64_t *durable,
+                                uint64_t *recent, uint64_t *unsynced,
+                                unsigned *since_sync_ms) {
+  MDBX_envinfo info;
+  int rc = mdbx_env_info_ex(env, nullptr, &info, sizeof(info));
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  /* Устойчивыми являются мета-страницы с "сильной" сигнатурой,
+   * т.е. сформированные с синхронизацией данных на диск. */
+  const uint64_t weak_sign = 1 /* MDBX_DATASIGN_WEAK */;
+  uint64_t steady = 0;
+  if (info.mi_meta0_sign > weak_sign)
+    steady = std::max(steady, info.mi_meta0_txnid);
+  if (info.mi_meta1_sign > weak_sign)
+    steady = std::max(steady, info.mi_meta1_txnid);
+  if (info.mi_meta2_sign > weak_sign)
+    steady = std::max(steady, info.mi_meta2_txnid);
+
+  if (info.mi_unsync_volume == 0)
+    /* Все изменения уже на диске (например, в режиме fpta_sync). */
+    steady = info.mi_recent_txnid;
+
+  *durable = steady;
+  if (recent)
+    *recent = info.mi_recent_txnid;
+  if (unsynced)
+    *unsynced = info.mi_unsync_volume;
+  if (since_sync_ms)
+    *since_sync_ms =
+        unsigned((uint64_t(info.mi_since_sync_seconds16dot16) * 1000) >> 16);
+  return FPTA_SUCCESS;
+}
+
+void fpta_flusher::run() {
+  int rc = fpta_mutex_lock(&mutex);
+  assert(rc == 0);
+  while (!stop) {
+    /* После ошибки фиксации не повторяем её немедленно. */
+    const bool urgent = requested > durable && error == FPTA_SUCCESS;
+    if (!urgent) {
+      unsigned wait_ms = threshold ? unsigned(fpta_flusher_poll_ms) : period_ms;
+      if (period_ms && period_ms < wait_ms)
+        wait_ms = period_ms;
+      rc = fpta_cond_timedwait(&wakeup, &mutex, wait_ms);
+      assert(rc == 0 || rc == FPTA_COND_TIMEDOUT);
+      if (stop)
+        break;
+    }
+    /* Ожидающие изменяют requested под мьютексом, поэтому вне его
+     * используется копия. */
+    const uint64_t wanted = requested;
+    rc = fpta_mutex_unlock(&mutex);
+    assert(rc == 0);
+
+    uint64_t steady, recent, unsynced;
+    unsigned since_sync_ms;
+    int err = fpta_durable_version(db->mdbx_env, &steady, &recent, &unsynced,
+                                   &since_sync_ms);
+    if (likely(err == FPTA_SUCCESS) && steady < recent &&
+        (urgent || wanted > steady ||
+         (threshold && unsynced >= threshold) ||
+         (period_ms && since_sync_ms >= period_ms))) {
+      err = mdbx_env_sync_ex(db->mdbx_env, true, false);
+      if (likely(err == MDBX_SUCCESS || err == MDBX_RESULT_TRUE))
+        err = fpta_durable_version(db->mdbx_env, &steady, nullptr, nullptr,
+                                   nullptr);
+    }
+
+    rc = fpta_mutex_lock(&mutex);
+    assert(rc == 0);
+    error = (err == MDBX_RESULT_TRUE) ? int(FPTA_SUCCESS) : err;
+    if (likely(error == FPTA_SUCCESS) && steady > durable)
+      durable = steady;
+    rc = fpta_cond_broadcast(&synced);
+    assert(rc == 0);
+  }
+
+  /* Финальная фиксация для ещё ожидающих, после неё их уже никто
+   * не разбудит. */
+  while (requested > durable && error == FPTA_SUCCESS) {
+    rc = fpta_mutex_unlock(&mutex);
+    assert(rc == 0);
+    uint64_t steady = 0;
+    int err = mdbx_env_sync_ex(db->mdbx_env, true, false);
+    if (likely(err == MDBX_SUCCESS || err == MDBX_RESULT_TRUE))
+      err = fpta_durable_version(db->mdbx_env, &steady, nullptr, nullptr,
+                                 nullptr);
+    rc = fpta_mutex_lock(&mutex);
+    assert(rc == 0);
+    error = err;
+    if (likely(error == FPTA_SUCCESS) && steady > durable)
+      durable = steady;
+    if (unlikely(requested > durable && error == FPTA_SUCCESS))
+      /* Версия ещё не зафиксирована в mdbx. */
+      error = FPTA_EINVAL;
+  }
+  finished = true;
+  rc = fpta_cond_broadcast(&synced);
+  assert(rc == 0);
+  rc = fpta_mutex_unlock(&mutex);
+  assert(rc == 0);
+  (void)rc;
+}
+
+int fpta_flusher_start(fpta_db *db, size_t threshold, unsigned period_ms) {
+  assert(db->flusher == nullptr && (threshold || period_ms));
+  fpta_flusher *flusher = new (std::nothrow) fpta_flusher();
+  if (unlikely(flusher == nullptr))
+    return FPTA_ENOMEM;
+
+  flusher->db = db;
+  flusher->threshold = threshold;
+  flusher->period_ms = period_ms;
+  flusher->requested = flusher->durable = 0;
+  flusher->error = FPTA_SUCCESS;
+  flusher->waiters = 0;
+  flusher->stop = flusher->finished = false;
+
+  int rc = fpta_mutex_init(&flusher->mutex);
+  if (unlikely(rc != 0))
+    goto bailout_mutex;
+  rc = fpta_cond_init(&flusher->wakeup);
+  if (unlikely(rc != 0))
+    goto bailout_wakeup;
+  rc = fpta_cond_init(&flusher->synced);
+  if (unlikely(rc != 0))
+    goto bailout_synced;
+
+  try {
+    flusher->thread = std::thread(&fpta_flusher::run, flusher);
+  } catch (const std::system_error &e) {
+    rc = e.code().value() ? e.code().value() : int(FPTA_EOOPS);
+    goto bailout_thread;
+  }
+  db->flusher = flusher;
+  return FPTA_SUCCESS;
+
+bailout_thread:
+  fpta_cond_destroy(&flusher->synced);
+bailout_synced:
+  fpta_cond_destroy(&flusher->wakeup);
+bailout_wakeup:
+  fpta_mutex_destroy(&flusher->mutex);
+bailout_mutex:
+  delete flusher;
+  return rc;
+}
+
+void fpta_flusher_stop(fpta_db *db) {
+  fpta_flusher *flusher = db->flusher;
+  if (!flusher)
+    return;
+
+  int rc = fpta_mutex_lock(&flusher->mutex);
+  assert(rc == 0);
+  flusher->stop = true;
+  rc = fpta_cond_signal(&flusher->wakeup);
+  assert(rc == 0);
+  rc = fpta_mutex_unlock(&flusher->mutex);
+  assert(rc == 0);
+  flusher->thread.join();
+
+  /* Ожидающие будут освобождены фоновым потоком после финальной фиксации,
+   * но им ещё нужно вернуть мьютекс. */
+  rc = fpta_mutex_lock(&flusher->mutex);
+  assert(rc == 0);
+  while (flusher->waiters) {
+    rc = fpta_cond_wait(&flusher->synced, &flusher->mutex);
+    assert(rc == 0);
+  }
+  rc = fpta_mutex_unlock(&flusher->mutex);
+  assert(rc == 0);
+
+  db->flusher = nullptr;
+  rc = fpta_cond_destroy(&flusher->synced);
+  assert(rc == 0);
+  rc = fpta_cond_destroy(&flusher->wakeup);
+  assert(rc == 0);
+  rc = fpta_mutex_destroy(&flusher->mutex);
+  assert(rc == 0);
+  (void)rc;
+  delete flusher;
+}
+
+//----------------------------------------------------------------------------
+
+int fpta_db_durable_version(fpta_db *db, uint64_t *durable_version) {
+  if (unlikely(!fpta_db_validate(db) || !durable_version))
+    return FPTA_EINVAL;
+
+  return fpta_durable_version(db->mdbx_env, durable_version, nullptr, nullptr,
+                              nullptr);
+}
+
+int fpta_db_wait_durable(fpta_db *db, uint64_t db_version) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  uint64_t steady, recent;
+  int rc =
+      fpta_durable_version(db->mdbx_env, &steady, &recent, nullptr, nullptr);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (steady >= db_version)
+    return FPTA_SUCCESS;
+  if (unlikely(db_version > recent))
+    return FPTA_EINVAL;
+
+  fpta_flusher *const flusher = db->flusher;
+  if (flusher) {
+    rc = fpta_mutex_lock(&flusher->mutex);
+    if (unlikely(rc != 0))
+      return rc;
+    if (flusher->requested < db_version)
+      flusher->requested = db_version;
+    rc = fpta_cond_signal(&flusher->wakeup);
+    assert(rc == 0);
+    flusher->waiters += 1;
+    while (flusher->durable < db_version && !flusher->finished &&
+           flusher->error == FPTA_SUCCESS) {
+      rc = fpta_cond_wait(&flusher->synced, &flusher->mutex);
+      assert(rc == 0);
+    }
+    const bool done = flusher->durable >= db_version;
+    rc = flusher->error;
+    if (--flusher->waiters == 0 && flusher->stop) {
+      /* Последний ожидающий будит fpta_flusher_stop(). */
+      int err = fpta_cond_broadcast(&flusher->synced);
+      assert(err == 0);
+      (void)err;
+    }
+    int err = fpta_mutex_unlock(&flusher->mutex);
+    assert(err == 0);
+    (void)err;
+    /* После остановки фонового потока БД закрывается, поэтому
+     * к mdbx_env_sync_ex() не переходим. */
+    return (done || rc != FPTA_SUCCESS) ? rc : int(FPTA_EINVAL);
+  }
+
+  /* Фоновый поток не запущен, выполняем фиксацию самостоятельно. */
+  rc = mdbx_env_sync_ex(db->mdbx_env, true, false);
+  return (rc == MDBX_RESULT_TRUE) ? int(FPTA_SUCCESS) : rc;
+}
@@ -252,12 +252,16 @@ __cold std::ostream &operator<<(std::ostream &out,
   case fpta_node_eq:
   case fpta_node_ne:
     return out << fptu_lge(value);
+  case fpta_node_in:
+    return out << "IN";
   }
 }
 
 __cold std::ostream &operator<<(std::ostream &out,
                                 const fpta_cursor_options value) {
-  switch (value & ~(fpta_dont_fetch | fpta_zeroed_range_is_point)) {
+  switch (value & ~(fpta_dont_fetch | fpta_zeroed_range_is_point |
+                    fpta_keys_only | fpta_readahead |
+                    fpta_adaptive_filter)) {
   default:
     return invalid(out, "cursor_options", value);
   case fpta_unsorted:
@@ -272,6 +276,12 @@ __cold std::ostream &operator<<(std::ostream &out,
   }
   if (value & fpta_zeroed_range_is_point)
     out << ".zeroed_range_is_point";
+  if (value & fpta_keys_only)
+    out << ".keys_only";
+  if (value & fpta_readahead)
+    out << ".readahead";
+  if (value & fpta_adaptive_filter)
+    out << ".adaptive_filter";
   if (value & fpta_dont_fetch)
     out << ".dont_fetch";
   return out;
@@ -412,6 +422,10 @@ __cold std::ostream &operator<<(std::ostream &out, const fpta_filter *filter) {
   case fpta_node_ne:
     return out << filter->node_cmp.left_id << " " << fptu_lge(filter->type)
                << " " << filter->node_cmp.right_value;
+
+  case fpta_node_in:
+    return out << filter->node_in.left_id << " IN set."
+               << static_cast<const void *>(filter->node_in.set);
   }
 }
 
@@ -37,8 +37,15 @@
 /*----------------------------------------------------------------------------*/
 /* Threads */
 
+/* Результат fpta_cond_timedwait() при истечении таймаута. */
+#define FPTA_COND_TIMEDOUT (-1)
+
 #ifdef CMAKE_HAVE_PTHREAD_H
+#include <errno.h>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
 
 typedef struct fpta_rwl {
   pthread_rwlock_t prwl;
@@ -88,6 +95,53 @@ static int __inline fpta_mutex_destroy(fpta_mutex_t *mutex) {
   return pthread_mutex_destroy(&mutex->ptmx);
 }
 
+typedef struct fpta_cond {
+  pthread_cond_t ptcv;
+} fpta_cond_t;
+
+static int __inline fpta_cond_init(fpta_cond_t *cond) {
+  return pthread_cond_init(&cond->ptcv, NULL);
+}
+
+static int __inline fpta_cond_wait(fpta_cond_t *cond, fpta_mutex_t *mutex) {
+  return pthread_cond_wait(&cond->ptcv, &mutex->ptmx);
+}
+
+static int __inline fpta_cond_timedwait(fpta_cond_t *cond, fpta_mutex_t *mutex,
+                                        unsigned milliseconds) {
+  struct timespec deadline;
+  int rc = clock_gettime(CLOCK_REALTIME, &deadline);
+  if (rc != 0)
+    return errno;
+  deadline.tv_sec += milliseconds / 1000;
+  deadline.tv_nsec += (milliseconds % 1000) * 1000000l;
+  if (deadline.tv_nsec >= 1000000000l) {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000000000l;
+  }
+  rc = pthread_cond_timedwait(&cond->ptcv, &mutex->ptmx, &deadline);
+  return (rc == ETIMEDOUT) ? FPTA_COND_TIMEDOUT : rc;
+}
+
+static int __inline fpta_cond_signal(fpta_cond_t *cond) {
+  return pthread_cond_signal(&cond->ptcv);
+}
+
+static int __inline fpta_cond_broadcast(fpta_cond_t *cond) {
+  return pthread_cond_broadcast(&cond->ptcv);
+}
+
+static int __inline fpta_cond_destroy(fpta_cond_t *cond) {
+  return pthread_cond_destroy(&cond->ptcv);
+}
+
+static void __inline fpta_backoff(unsigned attempt) {
+  if (attempt < 64)
+    sched_yield();
+  else
+    usleep(1000);
+}
+
 #else
 
 #ifdef _MSC_VER
@@ -230,4 +284,58 @@ static int __inline fpta_mutex_destroy(fpta_mutex_t *mutex) {
   return FPTA_SUCCESS;
 }
 
+typedef struct fpta_cond {
+  CONDITION_VARIABLE cv;
+} fpta_cond_t;
+
+static int __inline fpta_cond_init(fpta_cond_t *cond) {
+  if (!cond)
+    return FPTA_EINVAL;
+  InitializeConditionVariable(&cond->cv);
+  return FPTA_SUCCESS;
+}
+
+static int __inline fpta_cond_wait(fpta_cond_t *cond, fpta_mutex_t *mutex) {
+  if (!cond || !mutex)
+    return FPTA_EINVAL;
+  return SleepConditionVariableCS(&cond->cv, &mutex->cs, INFINITE)
+             ? FPTA_SUCCESS
+             : (int)GetLastError();
+}
+
+static int __inline fpta_cond_timedwait(fpta_cond_t *cond, fpta_mutex_t *mutex,
+                                        unsigned milliseconds) {
+  if (!cond || !mutex)
+    return FPTA_EINVAL;
+  if (SleepConditionVariableCS(&cond->cv, &mutex->cs, milliseconds))
+    return FPTA_SUCCESS;
+  const DWORD rc = GetLastError();
+  return (rc == ERROR_TIMEOUT) ? FPTA_COND_TIMEDOUT : (int)rc;
+}
+
+static int __inline fpta_cond_signal(fpta_cond_t *cond) {
+  if (!cond)
+    return FPTA_EINVAL;
+  WakeConditionVariable(&cond->cv);
+  return FPTA_SUCCESS;
+}
+
+static int __inline fpta_cond_broadcast(fpta_cond_t *cond) {
+  if (!cond)
+    return FPTA_EINVAL;
+  WakeAllConditionVariable(&cond->cv);
+  return FPTA_SUCCESS;
+}
+
+static int __inline fpta_cond_destroy(fpta_cond_t *cond) {
+  return cond ? FPTA_SUCCESS : FPTA_EINVAL;
+}
+
+static void __inline fpta_backoff(unsigned attempt) {
+  if (attempt < 64)
+    SwitchToThread();
+  else
+    Sleep(1);
+}
+
 #endif /* CMAKE_HAVE_PTHREAD_H */
@@ -0,0 +1,369 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* Параллельный просмотр диапазона.
+ *
+ * libmdbx не хранит количество элементов поддеревьев в страницах ветвей и не
+ * предоставляет доступ к разделителям внутри них. Поэтому границы партиций
+ * подбираются бисекцией в пространстве значений ключа: каждый ключ индекса
+ * отображается с сохранением порядка в 64-битный ординал, а количество строк
+ * до кандидата оценивается посредством mdbx_estimate_range() за O(log(N)).
+ * Сами границы являются синтетическими ключами, которых может не быть в БД.
+ *
+ * Каждая партиция просматривается отдельным курсором, ограниченным
+ * посредством механизма диапазонов fpta_cursor_open_ranges(). Фильтр
+ * проверяется и актуализируется однократно в вызывающем потоке, рабочие
+ * потоки его не изменяют. */
+
+enum {
+  fpta_parallel_partitions_per_thread = 4 /* для выравнивания нагрузки */,
+  fpta_parallel_min_rows = 64 /* минимальный размер партиции */,
+  fpta_parallel_batch = 64 /* размер пакета строк, как для
+                              fpta_apply_batch_visitor() */
+};
+
+/* Отображение ключей индекса в 64-битные ординалы с сохранением порядка.
+ *
+ * Для коротких типов (MDBX_INTEGERKEY) ординалом является само значение
+ * ключа. Для остальных ключи рассматриваются как строки байт в порядке
+ * сравнения (с конца для MDBX_REVERSEKEY), а ординалом являются до 8 байт
+ * после общего префикса первого и последнего ключей диапазона. */
+struct fpta_keyspace {
+  bool integer, reverse;
+  size_t width /* длина синтетического ключа */;
+  size_t prefix /* длина общего префикса */;
+  size_t bytes /* количество байт ординала */;
+  uint8_t common[sizeof(fpta_key::place)];
+
+  static uint8_t at(const MDBX_val &key, size_t i, bool reverse) {
+    if (i >= key.iov_len)
+      return 0;
+    return static_cast<const uint8_t *>(
+        key.iov_base)[reverse ? key.iov_len - 1 - i : i];
+  }
+
+  void init(fpta_shove_t shove, const MDBX_val &first, const MDBX_val &last) {
+    const fptu_type type = fpta_shove2type(shove);
+    const fpta_index_type index = fpta_shove2index(shove);
+    integer = fpta_index_is_unordered(index) ||
+              (type != /* composite */ fptu_null && type < fptu_96);
+    reverse = !integer && fpta_index_is_reverse(index);
+    prefix = bytes = 0;
+    width = first.iov_len;
+    if (integer) {
+      assert(width == 4 || width == 8);
+      return;
+    }
+
+    const bool fixed = type >= fptu_96 && type <= fptu_256;
+    const size_t limit = fixed ? first.iov_len : sizeof(common);
+    while (prefix + 1 < limit && prefix < first.iov_len &&
+           prefix < last.iov_len &&
+           at(first, prefix, reverse) == at(last, prefix, reverse)) {
+      common[prefix] = at(first, prefix, reverse);
+      ++prefix;
+    }
+    bytes = std::min(size_t(8), limit - prefix);
+    width = fixed ? limit : prefix + bytes;
+  }
+
+  uint64_t ordinal(const MDBX_val &key) const {
+    if (integer) {
+      if (key.iov_len == 4) {
+        uint32_t u32;
+        memcpy(&u32, key.iov_base, 4);
+        return u32;
+      }
+      uint64_t u64;
+      memcpy(&u64, key.iov_base, 8);
+      return u64;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+      value = value << 8 | at(key, prefix + i, reverse);
+    return value;
+  }
+
+  void synthesize(uint64_t value, uint64_t *place, MDBX_val &key) const {
+    key.iov_base = place;
+    key.iov_len = width;
+    if (integer) {
+      if (width == 4) {
+        const uint32_t u32 = uint32_t(value);
+        memcpy(place, &u32, 4);
+      } else
+        memcpy(place, &value, 8);
+      return;
+    }
+    uint8_t *const ptr = reinterpret_cast<uint8_t *>(place);
+    for (size_t i = 0; i < width; ++i) {
+      uint8_t byte = 0;
+      if (i < prefix)
+        byte = common[i];
+      else if (i < prefix + bytes)
+        byte = uint8_t(value >> ((prefix + bytes - 1 - i) * 8));
+      ptr[reverse ? width - 1 - i : i] = byte;
+    }
+  }
+};
+
+/* Задание для рабочих потоков. */
+struct fpta_parallel_job {
+  fpta_txn *txn;
+  fpta_name *column_id;
+  const fpta_filter *filter /* проверенный фильтр */;
+  std::vector<fpta_cursor_range> partitions;
+  std::atomic<size_t> next;
+  std::atomic<int> result;
+  int (*visitor)(const fptu_ro *rows, size_t count, void *context,
+                 unsigned worker);
+  void *visitor_context;
+
+  int scan(const fpta_cursor_range &partition, unsigned worker);
+  void run(unsigned worker);
+};
+
+int fpta_parallel_job::scan(const fpta_cursor_range &partition,
+                            unsigned worker) {
+  alignas(fpta_cursor) char place[sizeof(fpta_cursor)];
+  fpta_cursor *cursor = nullptr;
+  int rc = fpta_cursor_setup(txn, column_id, fpta_value_begin(),
+                             fpta_value_end(), fpta_filter_any,
+                             fpta_unsorted_dont_fetch,
+                             reinterpret_cast<fpta_cursor *>(place), &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  /* Партиция принадлежит заданию, а не курсору. */
+  cursor->ranges = const_cast<fpta_cursor_range *>(&partition);
+  cursor->ranges_count = 1;
+  fpta_cursor_range_activate(cursor, 0);
+
+  /* Числовые условия выгоднее проверять сразу для всего пакета строк,
+   * поэтому в таком случае курсор выбирает строки без фильтра. */
+  const bool batched = fpta_filter_batchable(filter);
+  if (!batched) {
+    cursor->filter = filter;
+    rc = fpta_filter_compile(filter, cursor->filter_program);
+  }
+  if (likely(rc == FPTA_SUCCESS))
+    rc = fpta_cursor_move(cursor, fpta_first);
+  fptu_ro rows[fpta_parallel_batch];
+  while (likely(rc == FPTA_SUCCESS) &&
+         likely(result.load(std::memory_order_relaxed) == FPTA_SUCCESS)) {
+    size_t n;
+    rc = fpta_cursor_get_batch(cursor, rows, fpta_parallel_batch, &n);
+    if (likely(rc == FPTA_SUCCESS) && batched)
+      n = fpta_filter_select_batch(filter, rows, n);
+    if (likely(rc == FPTA_SUCCESS) && n)
+      rc = visitor(rows, n, visitor_context, worker);
+  }
+
+  cursor->ranges = nullptr;
+  fpta_cursor_release(cursor);
+  return (rc != FPTA_NODATA) ? rc : (int)FPTA_SUCCESS;
+}
+
+void fpta_parallel_job::run(unsigned worker) {
+  while (result.load(std::memory_order_relaxed) == FPTA_SUCCESS) {
+    const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+    if (i >= partitions.size())
+      break;
+    const int rc = scan(partitions[i], worker);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      int expected = FPTA_SUCCESS;
+      result.compare_exchange_strong(expected, rc);
+    }
+  }
+}
+
+/* Делит диапазон whole, ключи которого лежат от first до last включительно,
+ * на партиции с примерно равной оценкой количества строк. */
+static int
+fpta_parallel_split(fpta_cursor *probe, const fpta_cursor_range &whole,
+                    MDBX_val first, MDBX_val last, size_t parts,
+                    std::vector<fpta_cursor_range> &partitions) {
+  MDBX_txn *const mdbx_txn = probe->txn->mdbx_txn;
+  const MDBX_dbi dbi = probe->idx_handle;
+  ptrdiff_t total = 0;
+  int rc = mdbx_estimate_range(mdbx_txn, dbi, &first, nullptr, &last, nullptr,
+                               &total);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  parts = std::min(parts, size_t(std::max(total, ptrdiff_t(0))) /
+                              fpta_parallel_min_rows);
+
+  fpta_keyspace keyspace;
+  keyspace.init(probe->index_shove(), first, last);
+  uint64_t prev = keyspace.ordinal(first);
+  const uint64_t hi = keyspace.ordinal(last);
+
+  fpta_cursor_range item = whole;
+  for (size_t i = 1; i < parts && prev < hi; ++i) {
+    const ptrdiff_t target = ptrdiff_t(total * double(i) / double(parts));
+    /* наименьший ординал, до которого оценка не меньше целевой */
+    uint64_t lo = prev + 1, up = hi;
+    uint64_t place[sizeof(fpta_key::place) / sizeof(uint64_t)];
+    while (lo < up) {
+      const uint64_t mid = lo + (up - lo) / 2;
+      MDBX_val key, begin = first;
+      keyspace.synthesize(mid, place, key);
+      ptrdiff_t distance = 0;
+      rc = mdbx_estimate_range(mdbx_txn, dbi, &begin, nullptr, &key, nullptr,
+                               &distance);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      if (distance >= target)
+        up = mid;
+      else
+        lo = mid + 1;
+    }
+    if (lo >= hi)
+      break;
+
+    MDBX_val separator;
+    keyspace.synthesize(lo, item.to_place, separator);
+    item.to.iov_base = item.to_place;
+    item.to.iov_len = separator.iov_len;
+    item.inclusive = false;
+    partitions.push_back(item);
+
+    memcpy(item.from_place, item.to_place, separator.iov_len);
+    item.from.iov_base = item.from_place;
+    item.from.iov_len = separator.iov_len;
+    prev = lo;
+  }
+
+  item.to = whole.to;
+  item.inclusive = whole.inclusive;
+  if (whole.to.iov_base)
+    memcpy(item.to_place, whole.to_place, whole.to.iov_len);
+  partitions.push_back(item);
+
+  /* границы указывают внутрь самих элементов, которые были перемещены */
+  for (auto &partition : partitions) {
+    if (partition.from.iov_base)
+      partition.from.iov_base = partition.from_place;
+    if (partition.to.iov_base)
+      partition.to.iov_base = partition.to_place;
+  }
+  return FPTA_SUCCESS;
+}
+
+int fpta_parallel_visit(fpta_txn *txn, fpta_name *column_id,
+                        fpta_value range_from, fpta_value range_to,
+                        fpta_filter *filter, unsigned nthreads,
+                        int (*visitor)(const fptu_ro *rows, size_t count,
+                                       void *context, unsigned worker),
+                        void *visitor_context) {
+  if (unlikely(!visitor || nthreads == 0))
+    return FPTA_EINVAL;
+
+  /* Пробный курсор проверяет аргументы, актуализирует фильтр и фиксирует
+   * границы диапазона в форме ключей. */
+  alignas(fpta_cursor) char place[sizeof(fpta_cursor)];
+  fpta_cursor *probe = nullptr;
+  int rc = fpta_cursor_setup(txn, column_id, range_from, range_to, filter,
+                             fpta_unsorted_dont_fetch,
+                             reinterpret_cast<fpta_cursor *>(place), &probe);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (probe->filter == fpta_filter_none ||
+      probe->seek_range_flags == fpta_cursor::need_key4epsilon) {
+    /* выборка заведомо пуста */
+    fpta_cursor_release(probe);
+    return FPTA_SUCCESS;
+  }
+
+  fpta_parallel_job job;
+  job.txn = txn;
+  job.column_id = column_id;
+  job.filter = probe->filter;
+  job.next = 0;
+  job.result = FPTA_SUCCESS;
+  job.visitor = visitor;
+  job.visitor_context = visitor_context;
+
+  try {
+    fpta_cursor_range whole;
+    whole.from.iov_base = whole.to.iov_base = nullptr;
+    whole.from.iov_len = whole.to.iov_len = 0;
+    whole.inclusive = (probe->options & fpta_zeroed_range_is_point) != 0;
+    if (probe->seek_range_flags & fpta_cursor::need_cmp_range_from) {
+      whole.from.iov_len = probe->range_from_key.mdbx.iov_len;
+      whole.from.iov_base = memcpy(whole.from_place,
+                                   probe->range_from_key.mdbx.iov_base,
+                                   whole.from.iov_len);
+    }
+    if (probe->seek_range_flags & fpta_cursor::need_cmp_range_to) {
+      whole.to.iov_len = probe->range_to_key.mdbx.iov_len;
+      whole.to.iov_base = memcpy(whole.to_place,
+                                 probe->range_to_key.mdbx.iov_base,
+                                 whole.to.iov_len);
+    }
+
+    /* Первый и последний ключи диапазона без учета фильтра. */
+    probe->filter = fpta_filter_any;
+    rc = fpta_cursor_move(probe, fpta_first);
+    if (rc == FPTA_SUCCESS) {
+      const MDBX_val first = probe->current;
+      rc = fpta_cursor_move(probe, fpta_last);
+      if (likely(rc == FPTA_SUCCESS)) {
+        const size_t parts =
+            (nthreads > 1) ? size_t(nthreads) *
+                                 fpta_parallel_partitions_per_thread
+                           : 1;
+        rc = fpta_parallel_split(probe, whole, first, probe->current, parts,
+                                 job.partitions);
+      }
+    }
+  } catch (const std::bad_alloc &) {
+    rc = FPTA_ENOMEM;
+  }
+  fpta_cursor_release(probe);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return (rc != FPTA_NODATA) ? rc : (int)FPTA_SUCCESS;
+
+  const unsigned workers =
+      unsigned(std::min(size_t(nthreads), job.partitions.size()));
+  if (workers > 1) {
+    rc = fpta_transaction_share(txn);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  std::vector<std::thread> threads;
+  try {
+    threads.reserve(workers - 1);
+    for (unsigned worker = 1; worker < workers; ++worker)
+      threads.emplace_back(&fpta_parallel_job::run, &job, worker);
+  } catch (const std::system_error &) {
+    /* недостающие потоки заменяются вызывающим */
+  } catch (const std::bad_alloc &) {
+  }
+
+  job.run(0);
+  for (auto &thread : threads)
+    thread.join();
+  return job.result;
+}
@@ -0,0 +1,262 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <mutex>
+
+static void *fpta_default_alloc(size_t bytes, void *ctx) {
+  (void)ctx;
+  return malloc(bytes);
+}
+
+static void fpta_default_free(void *ptr, size_t bytes, void *ctx) {
+  (void)bytes;
+  (void)ctx;
+  free(ptr);
+}
+
+/* Реестр "живых" пулов.
+ *
+ * Кэши потоков могут пережить закрытие БД, поэтому возврат объектов из кэша
+ * в глобальный список пула производится только под защитой мьютекса реестра
+ * и после проверки, что пул с заданным серийным номером всё ещё существует.
+ * Закрытие БД удаляет пул из реестра под тем же мьютексом, после чего
+ * объекты в кэшах потоков становятся "висячими" и просто забываются. */
+static std::mutex fpta_pool_registry_mutex;
+static fpta_pool *fpta_pool_registry;
+static std::atomic<uint64_t> fpta_pool_serial;
+
+static bool fpta_pool_is_alive(const fpta_pool *pool, const uint64_t serial) {
+  for (const fpta_pool *scan = fpta_pool_registry; scan;
+       scan = scan->registry_next)
+    if (scan == pool)
+      return scan->serial == serial;
+  return false;
+}
+
+//----------------------------------------------------------------------------
+
+struct fpta_pool_cache {
+  enum { ways = 4 };
+
+  struct slot {
+    fpta_pool *pool;
+    uint64_t serial;
+    unsigned count;
+    fpta_pool::node *items[fpta_pool::cache_depth];
+
+    void flush() {
+      if (count) {
+        std::lock_guard<std::mutex> guard(fpta_pool_registry_mutex);
+        if (fpta_pool_is_alive(pool, serial)) {
+          for (unsigned i = 1; i < count; ++i)
+            items[i - 1]->next.store(items[i]->self, std::memory_order_relaxed);
+          pool->push(items[0], items[count - 1]);
+        }
+        count = 0;
+      }
+    }
+
+    void bind(fpta_pool *owner) {
+      flush();
+      pool = owner;
+      serial = owner->serial;
+    }
+  };
+
+  slot slots[ways];
+
+  slot &lookup(fpta_pool *pool) {
+    slot &it = slots[pool->serial % ways];
+    if (unlikely(it.pool != pool || it.serial != pool->serial))
+      it.bind(pool);
+    return it;
+  }
+
+  ~fpta_pool_cache() {
+    for (auto &it : slots)
+      it.flush();
+  }
+};
+
+static thread_local fpta_pool_cache fpta_pool_tls;
+
+//----------------------------------------------------------------------------
+
+int fpta_pool::init(size_t size, const fpta_db_creation_params_ex_t *params) {
+  assert(chunks_count == 0);
+  object_size = size;
+  stride = (sizeof(node) + size + 15) & ~size_t(15);
+  head.store(0, std::memory_order_relaxed);
+  if (params && params->alloc_func) {
+    alloc_func = params->alloc_func;
+    free_func = params->free_func;
+    alloc_ctx = params->alloc_ctx;
+  } else {
+    alloc_func = fpta_default_alloc;
+    free_func = fpta_default_free;
+    alloc_ctx = nullptr;
+  }
+
+  int rc = fpta_mutex_init(&grow_mutex);
+  if (unlikely(rc != 0))
+    return rc;
+
+  std::lock_guard<std::mutex> guard(fpta_pool_registry_mutex);
+  serial = ++fpta_pool_serial;
+  registry_prev = nullptr;
+  registry_next = fpta_pool_registry;
+  if (registry_next)
+    registry_next->registry_prev = this;
+  fpta_pool_registry = this;
+  return FPTA_SUCCESS;
+}
+
+void fpta_pool::destroy() {
+  {
+    std::lock_guard<std::mutex> guard(fpta_pool_registry_mutex);
+    if (registry_prev)
+      registry_prev->registry_next = registry_next;
+    else {
+      assert(fpta_pool_registry == this);
+      fpta_pool_registry = registry_next;
+    }
+    if (registry_next)
+      registry_next->registry_prev = registry_prev;
+    registry_prev = registry_next = nullptr;
+  }
+
+  for (unsigned i = 0; i < chunks_count; ++i)
+    free_func(chunks[i], stride * chunk_items, alloc_ctx);
+  chunks_count = 0;
+  head.store(0, std::memory_order_relaxed);
+
+  int err = fpta_mutex_destroy(&grow_mutex);
+  assert(err == 0);
+  (void)err;
+}
+
+//----------------------------------------------------------------------------
+
+fpta_pool::node *fpta_pool::pop() {
+  uint64_t top = head.load(std::memory_order_acquire);
+  for (;;) {
+    const uint32_t index = uint32_t(top);
+    if (!index)
+      return nullptr;
+    node *const item = index2node(index);
+    /* Значение next может оказаться мусорным, если элемент был одновременно
+     * извлечен другим потоком, но тогда не пройдет CAS из-за смены тега. */
+    const uint64_t next = item->next.load(std::memory_order_relaxed);
+    const uint64_t tag = (top >> 32) + 1;
+    if (head.compare_exchange_weak(top, tag << 32 | next,
+                                   std::memory_order_acquire,
+                                   std::memory_order_acquire))
+      return item;
+  }
+}
+
+void fpta_pool::push(node *first, node *last) {
+  uint64_t top = head.load(std::memory_order_relaxed);
+  for (;;) {
+    last->next.store(uint32_t(top), std::memory_order_relaxed);
+    const uint64_t tag = (top >> 32) + 1;
+    if (head.compare_exchange_weak(top, tag << 32 | first->self,
+                                   std::memory_order_release,
+                                   std::memory_order_relaxed))
+      return;
+  }
+}
+
+__cold fpta_pool::node *fpta_pool::grow() {
+  fpta_lock_guard guard;
+  if (unlikely(guard.lock(&grow_mutex) != 0))
+    return nullptr;
+
+  /* Пока ждали мьютекс, другой поток мог нарастить пул. */
+  node *item = pop();
+  if (item)
+    return item;
+
+  if (unlikely(chunks_count >= max_chunks)) {
+    /* Исчерпан лимит блоков, размещаем объект индивидуально. */
+    item = static_cast<node *>(alloc_func(stride, alloc_ctx));
+    if (likely(item)) {
+      new (item) node();
+      item->self = 0;
+    }
+    return item;
+  }
+
+  char *const chunk =
+      static_cast<char *>(alloc_func(stride * chunk_items, alloc_ctx));
+  if (unlikely(chunk == nullptr))
+    return nullptr;
+
+  const uint32_t base = chunks_count * chunk_items;
+  for (unsigned i = 0; i < chunk_items; ++i) {
+    node *const it = new (chunk + stride * i) node();
+    it->self = base + i + 1;
+    it->next.store(base + i + 2, std::memory_order_relaxed);
+  }
+  chunks[chunks_count] = chunk;
+  chunks_count += 1;
+
+  /* Первый элемент отдаем вызывающему, остальные в глобальный список. */
+  push(index2node(base + 2), index2node(base + chunk_items));
+  return index2node(base + 1);
+}
+
+//----------------------------------------------------------------------------
+
+void *fpta_pool::get() {
+  fpta_pool_cache::slot &cache = fpta_pool_tls.lookup(this);
+  node *item = likely(cache.count) ? cache.items[--cache.count] : pop();
+  if (unlikely(item == nullptr)) {
+    item = grow();
+    if (unlikely(item == nullptr))
+      return nullptr;
+  }
+
+  void *object = node2object(item);
+  memset(object, 0, object_size);
+  return object;
+}
+
+void fpta_pool::put(void *object) {
+  node *const item = object2node(object);
+#ifndef NDEBUG
+  fpta_pollute(object, object_size, 0);
+#endif
+  if (unlikely(item->self == 0)) {
+    free_func(item, stride, alloc_ctx);
+    return;
+  }
+
+  fpta_pool_cache::slot &cache = fpta_pool_tls.lookup(this);
+  if (unlikely(cache.count == cache_depth)) {
+    /* Кэш потока заполнен, сбрасываем половину в глобальный список. */
+    const unsigned keep = cache_depth / 2;
+    for (unsigned i = keep + 1; i < cache_depth; ++i)
+      cache.items[i - 1]->next.store(cache.items[i]->self,
+                                     std::memory_order_relaxed);
+    push(cache.items[keep], cache.items[cache_depth - 1]);
+    cache.count = keep;
+  }
+  cache.items[cache.count++] = item;
+}
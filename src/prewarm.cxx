@@ -0,0 +1,375 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#endif
+
+/* Фоновый прогрев страниц таблиц и индексов.
+ *
+ * libmdbx не предоставляет номера страниц отдельных деревьев (кроме
+ * предназначенного для mdbx_chk обхода всей БД), поэтому страницы загружаются
+ * в память обходом деревьев курсором. При этом затрагиваются все не-листьевые
+ * и листьевые страницы каждого дерева, а объем работы оценивается по
+ * количеству страниц, как в fpta_table_info_ex().
+ *
+ * Сначала в транзакции чтения составляется план: список деревьев с оценкой
+ * объема каждого, усеченный бюджетом. Затем деревья обходятся в управляемой
+ * сессии (см fpta_transaction_autorestart()), чтобы долгий прогрев не
+ * удерживал старый MVCC-снимок. */
+
+enum {
+  fpta_prewarm_progress_interval = 64 /* период обновления счетчиков */,
+  fpta_prewarm_restart_lag = 1 /* порог для перезапуска транзакции */
+};
+
+struct fpta_prewarm_tree {
+  size_t table /* индекс в fpta_prewarm::tables */;
+  unsigned column /* номер индексированной колонки, 0 для PK */;
+  size_t bytes /* запланированный объем */;
+  size_t item_bytes /* средний объем на один элемент дерева */;
+};
+
+struct fpta_prewarm {
+  fpta_db *db;
+  fpta_prewarm_flags flags;
+  size_t budget;
+  bool all_tables;
+  std::vector<fpta_shove_t> tables;
+
+  std::atomic<bool> cancel;
+  std::atomic<bool> running;
+  std::atomic<size_t> planned_bytes, warmed_bytes;
+  std::atomic<unsigned> planned_trees, warmed_trees;
+  std::atomic<int> error;
+  std::thread thread;
+
+  void run();
+  int plan(fpta_txn *txn, std::vector<fpta_name> &names,
+           std::vector<fpta_prewarm_tree> &trees);
+  int walk(fpta_txn *txn, fpta_name *table_id, const fpta_prewarm_tree &tree,
+           size_t page_size);
+};
+
+static void fpta_prewarm_names_destroy(std::vector<fpta_name> &names) {
+  for (auto &name : names)
+    fpta_name_destroy(&name);
+  names.clear();
+}
+
+int fpta_prewarm::plan(fpta_txn *txn, std::vector<fpta_name> &names,
+                       std::vector<fpta_prewarm_tree> &trees) {
+  if (all_tables && txn->db->schema_dbi /* есть схема */) {
+    fpta_schema_info *schema =
+        (fpta_schema_info *)malloc(sizeof(fpta_schema_info));
+    if (unlikely(schema == nullptr))
+      return FPTA_ENOMEM;
+    int rc = fpta_schema_fetch(txn, schema);
+    if (likely(rc == FPTA_SUCCESS)) {
+      for (unsigned i = 0; i < schema->tables_count; ++i)
+        tables.push_back(schema->tables_names[i].shove);
+      fpta_schema_destroy(schema);
+    }
+    free(schema);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  const size_t space4stat =
+      offsetof(fpta_table_stat, index_costs) +
+      sizeof(fpta_table_stat::index_cost_info) * (fpta_max_indexes + 1);
+  fpta_table_stat *stat = (fpta_table_stat *)malloc(space4stat);
+  if (unlikely(stat == nullptr))
+    return FPTA_ENOMEM;
+
+  int rc = FPTA_SUCCESS;
+  size_t budget_left = budget ? budget : SIZE_MAX;
+  names.resize(tables.size());
+  for (size_t i = 0; i < tables.size() && budget_left > 0; ++i) {
+    fpta_name *table_id = &names[i];
+    memset(table_id, 0, sizeof(fpta_name));
+    table_id->shove = tables[i];
+    rc = fpta_table_info_ex(txn, table_id, nullptr, stat, space4stat);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      if (rc == FPTA_NOTFOUND) {
+        /* Таблица не существует или была удалена. */
+        rc = FPTA_SUCCESS;
+        continue;
+      }
+      break;
+    }
+
+    for (unsigned n = 0; n < stat->index_costs_provided && budget_left > 0;
+         ++n) {
+      if (!(flags & (n ? fpta_prewarm_secondary : fpta_prewarm_primary)))
+        continue;
+      const auto &cost = stat->index_costs[n];
+      if (cost.items == 0)
+        continue;
+
+      fpta_prewarm_tree tree;
+      tree.table = i;
+      tree.column = n;
+      tree.bytes = std::min(cost.bytes, budget_left);
+      tree.item_bytes = std::max(cost.bytes / cost.items, size_t(1));
+      budget_left -= tree.bytes;
+      trees.push_back(tree);
+    }
+  }
+  free(stat);
+
+  size_t total = 0;
+  for (const auto &tree : trees)
+    total += tree.bytes;
+  planned_bytes.store(total, std::memory_order_relaxed);
+  planned_trees.store(unsigned(trees.size()), std::memory_order_release);
+  return rc;
+}
+
+int fpta_prewarm::walk(fpta_txn *txn, fpta_name *table_id,
+                       const fpta_prewarm_tree &tree, size_t page_size) {
+  int rc = fpta_name_refresh(txn, table_id);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_name column_id;
+  rc = fpta_table_column_get(table_id, tree.column, &column_id);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (!fpta_is_indexed(column_id.shove))
+    /* Схема изменилась после составления плана. */
+    return FPTA_SUCCESS;
+
+  fpta_cursor *cursor;
+  rc = fpta_cursor_open(txn, &column_id, fpta_value_begin(), fpta_value_end(),
+                        nullptr, fpta_unsorted_dont_fetch | fpta_readahead,
+                        &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const bool touch_rows =
+      tree.column == 0 && (flags & fpta_prewarm_rows) != 0;
+  const size_t base = warmed_bytes.load(std::memory_order_relaxed);
+  size_t done = 0, steps = 0;
+  unsigned sink = 0;
+  for (rc = fpta_cursor_move(cursor, fpta_first); rc == FPTA_SUCCESS;
+       rc = fpta_cursor_move(cursor, fpta_next)) {
+    if (touch_rows) {
+      fptu_ro row;
+      rc = fpta_cursor_get(cursor, &row);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+      /* Читаем по байту из каждой страницы строки. */
+      const volatile char *const ptr = (const char *)row.sys.iov_base;
+      for (size_t offset = 0; offset < row.sys.iov_len; offset += page_size)
+        sink += ptr[offset];
+    }
+
+    done += tree.item_bytes;
+    if (unlikely(done >= tree.bytes))
+      break;
+    if (unlikely(++steps % fpta_prewarm_progress_interval == 0)) {
+      warmed_bytes.store(base + done, std::memory_order_relaxed);
+      if (unlikely(cancel.load(std::memory_order_relaxed))) {
+        rc = FPTA_TXN_CANCELLED;
+        break;
+      }
+    }
+  }
+  (void)sink;
+
+  int err = fpta_cursor_close(cursor);
+  if (rc == FPTA_NODATA || rc == FPTA_SUCCESS)
+    rc = err;
+  warmed_bytes.store(base + tree.bytes, std::memory_order_relaxed);
+  return rc;
+}
+
+void fpta_prewarm::run() {
+  std::vector<fpta_name> names;
+  std::vector<fpta_prewarm_tree> trees;
+
+  fpta_txn *txn = nullptr;
+  int rc = fpta_transaction_begin(db, fpta_read, &txn);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
+
+  rc = fpta_transaction_autorestart(txn, fpta_prewarm_restart_lag, 0, 0);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
+
+  rc = plan(txn, names, trees);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
+
+  MDBX_envinfo info;
+  rc = mdbx_env_info_ex(db->mdbx_env, txn->mdbx_txn, &info, sizeof(info));
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto bailout;
+
+#if defined(POSIX_FADV_WILLNEED)
+  if (all_tables) {
+    /* Если прогреваются все таблицы и бюджет покрывает используемую часть
+     * файла, то запрашиваем у ОС упреждающее чтение файла целиком. */
+    const uint64_t used =
+        (info.mi_last_pgno + 1) * uint64_t(info.mi_dxb_pagesize);
+    mdbx_filehandle_t fd;
+    if ((budget == 0 || budget >= used) &&
+        mdbx_env_get_fd(db->mdbx_env, &fd) == MDBX_SUCCESS)
+      (void)posix_fadvise(fd, 0, off_t(used), POSIX_FADV_WILLNEED);
+  }
+#endif /* POSIX_FADV_WILLNEED */
+
+  for (const auto &tree : trees) {
+    if (unlikely(cancel.load(std::memory_order_relaxed))) {
+      rc = FPTA_TXN_CANCELLED;
+      break;
+    }
+    rc = walk(txn, &names[tree.table], tree, info.mi_sys_pagesize);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      /* Изменение схемы или удаление таблицы в ходе прогрева
+       * не является ошибкой, переходим к следующему дереву. */
+      if (rc != FPTA_SCHEMA_CHANGED && rc != FPTA_NOTFOUND)
+        break;
+      rc = FPTA_SUCCESS;
+    }
+    warmed_trees.fetch_add(1, std::memory_order_relaxed);
+  }
+
+bailout:
+  if (txn) {
+    int err = fpta_transaction_end(txn, false);
+    if (rc == FPTA_SUCCESS)
+      rc = err;
+  }
+  fpta_prewarm_names_destroy(names);
+  error.store(rc, std::memory_order_relaxed);
+  running.store(false, std::memory_order_release);
+}
+
+void fpta_prewarm_destroy(fpta_db *db) {
+  fpta_prewarm *prewarm = db->prewarm;
+  if (!prewarm)
+    return;
+
+  prewarm->cancel.store(true, std::memory_order_relaxed);
+  if (prewarm->thread.joinable())
+    prewarm->thread.join();
+  db->prewarm = nullptr;
+  delete prewarm;
+}
+
+//----------------------------------------------------------------------------
+
+int fpta_db_prewarm(fpta_db *db, fpta_name *const *table_ids,
+                    size_t tables_count, fpta_prewarm_flags flags,
+                    size_t budget_bytes) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+  if (unlikely(table_ids == nullptr && tables_count))
+    return FPTA_EINVAL;
+  if (unlikely((flags & ~fpta_prewarm_flags(fpta_prewarm_primary |
+                                             fpta_prewarm_secondary |
+                                             fpta_prewarm_rows)) ||
+               !(flags & (fpta_prewarm_primary | fpta_prewarm_secondary))))
+    return FPTA_EFLAG;
+
+  if (db->prewarm) {
+    if (db->prewarm->running.load(std::memory_order_acquire))
+      return FPTA_EBUSY;
+    fpta_prewarm_destroy(db);
+  }
+
+  fpta_prewarm *prewarm = new (std::nothrow) fpta_prewarm();
+  if (unlikely(prewarm == nullptr))
+    return FPTA_ENOMEM;
+
+  prewarm->db = db;
+  prewarm->flags = flags;
+  prewarm->budget = budget_bytes;
+  prewarm->all_tables = table_ids == nullptr;
+  prewarm->cancel = false;
+  prewarm->planned_bytes = prewarm->warmed_bytes = 0;
+  prewarm->planned_trees = prewarm->warmed_trees = 0;
+  prewarm->error = FPTA_SUCCESS;
+  prewarm->running = true;
+
+  int rc = FPTA_SUCCESS;
+  try {
+    for (size_t i = 0; i < tables_count; ++i) {
+      rc = fpta_id_validate(table_ids[i], fpta_table);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+      prewarm->tables.push_back(table_ids[i]->shove);
+    }
+    if (likely(rc == FPTA_SUCCESS) && table_ids && prewarm->tables.empty())
+      /* Пустой список таблиц, прогревать нечего. */
+      prewarm->running = false;
+    else if (likely(rc == FPTA_SUCCESS))
+      prewarm->thread = std::thread(&fpta_prewarm::run, prewarm);
+  } catch (const std::system_error &e) {
+    rc = e.code().value() ? e.code().value() : int(FPTA_EOOPS);
+  } catch (const std::bad_alloc &) {
+    rc = FPTA_ENOMEM;
+  }
+
+  if (unlikely(rc != FPTA_SUCCESS)) {
+    delete prewarm;
+    return rc;
+  }
+  db->prewarm = prewarm;
+  return FPTA_SUCCESS;
+}
+
+int fpta_db_prewarm_info(fpta_db *db, fpta_prewarm_info *info) {
+  if (unlikely(!fpta_db_validate(db) || !info))
+    return FPTA_EINVAL;
+
+  const fpta_prewarm *prewarm = db->prewarm;
+  if (!prewarm)
+    return FPTA_NODATA;
+
+  info->running = prewarm->running.load(std::memory_order_acquire);
+  info->planned_trees = prewarm->planned_trees.load(std::memory_order_acquire);
+  info->planned_bytes = prewarm->planned_bytes.load(std::memory_order_relaxed);
+  info->warmed_trees = prewarm->warmed_trees.load(std::memory_order_relaxed);
+  info->warmed_bytes = prewarm->warmed_bytes.load(std::memory_order_relaxed);
+  info->error = info->running ? int(FPTA_SUCCESS)
+                              : prewarm->error.load(std::memory_order_relaxed);
+  return FPTA_SUCCESS;
+}
+
+int fpta_db_prewarm_stop(fpta_db *db, bool cancel) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  fpta_prewarm *prewarm = db->prewarm;
+  if (!prewarm)
+    return FPTA_NODATA;
+
+  if (cancel)
+    prewarm->cancel.store(true, std::memory_order_relaxed);
+  if (prewarm->thread.joinable())
+    prewarm->thread.join();
+  return prewarm->error.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,324 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <new>
+#include <vector>
+
+/* Множество значений для условия fpta_node_in.
+ *
+ * Принадлежность значения поля множеству должна в точности совпадать
+ * с результатом цепочки сравнений fpta_node_eq, в том числе для сравнений
+ * разных типов. Поэтому целые числа хранятся точно (отдельно неотрицательные
+ * и отрицательные), а для сравнения полей с плавающей точкой дополнительно
+ * хранятся все числа множества, приведенные к double. Строки и двоичные
+ * данные сравниваются побайтно, поэтому размещаются в общей хеш-таблице,
+ * а вид значения учитывается при поиске в зависимости от типа поля. */
+
+struct fpta_value_set_item {
+  uint64_t hash;
+  const void *data /* nullptr для свободного элемента */;
+  size_t length;
+  fpta_value_type kind /* fpta_string или fpta_binary */;
+};
+
+struct fpta_value_set {
+  unsigned kinds /* маска (1 << fpta_value_type) имеющихся значений */;
+  std::vector<uint64_t> unsigneds /* целые >= 0 */;
+  std::vector<int64_t> negatives /* целые < 0 */;
+  std::vector<double> floats /* значения с плавающей точкой */;
+  std::vector<double> numbers /* все числа, приведенные к double */;
+  std::vector<uint64_t> datetimes;
+  std::vector<fpta_value_set_item> table /* размер кратен степени 2 */;
+  std::vector<char> bytes /* копии строк и двоичных данных */;
+
+  static uint64_t hash(const void *data, size_t length) {
+    return t1ha2_atonce(data, length, 2018);
+  }
+  bool insert(const void *data, size_t length, fpta_value_type kind);
+  bool lookup(const void *data, size_t length, bool any_kind) const;
+  bool match_unsigned(uint64_t value) const;
+  bool match_signed(int64_t value) const;
+  bool match_float(double value) const;
+};
+
+template <typename T>
+static inline void fpta_value_set_unique(std::vector<T> &vector) {
+  std::sort(vector.begin(), vector.end());
+  vector.erase(std::unique(vector.begin(), vector.end()), vector.end());
+}
+
+template <typename T>
+static __hot inline bool fpta_value_set_search(const std::vector<T> &vector,
+                                               T value) {
+  return std::binary_search(vector.begin(), vector.end(), value);
+}
+
+bool fpta_value_set::insert(const void *data, size_t length,
+                            fpta_value_type kind) {
+  const size_t mask = table.size() - 1;
+  const uint64_t h = hash(data, length);
+  for (size_t i = size_t(h) & mask;; i = (i + 1) & mask) {
+    fpta_value_set_item &item = table[i];
+    if (!item.data) {
+      item.hash = h;
+      item.data = data;
+      item.length = length;
+      item.kind = kind;
+      return true;
+    }
+    if (item.hash == h && item.length == length && item.kind == kind &&
+        memcmp(item.data, data, length) == 0)
+      return false /* повтор */;
+  }
+}
+
+__hot bool fpta_value_set::lookup(const void *data, size_t length,
+                                  bool any_kind) const {
+  if (table.empty())
+    return false;
+  const size_t mask = table.size() - 1;
+  const uint64_t h = hash(data, length);
+  for (size_t i = size_t(h) & mask;; i = (i + 1) & mask) {
+    const fpta_value_set_item &item = table[i];
+    if (!item.data)
+      return false;
+    if (item.hash == h && item.length == length &&
+        (any_kind || item.kind == fpta_binary) &&
+        memcmp(item.data, data, length) == 0)
+      return true;
+  }
+}
+
+__hot bool fpta_value_set::match_unsigned(uint64_t value) const {
+  return fpta_value_set_search(unsigneds, value) ||
+         fpta_value_set_search(floats, double(value));
+}
+
+__hot bool fpta_value_set::match_signed(int64_t value) const {
+  if (value >= 0)
+    return match_unsigned(uint64_t(value));
+  return fpta_value_set_search(negatives, value) ||
+         fpta_value_set_search(floats, double(value));
+}
+
+__hot bool fpta_value_set::match_float(double value) const {
+  return fpta_value_set_search(numbers, value);
+}
+
+//----------------------------------------------------------------------------
+
+static int fpta_value_set_build(fpta_value_set *set, const fpta_value *values,
+                                size_t count) {
+  size_t bytes = 0, items = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const fpta_value &value = values[i];
+    switch (value.type) {
+    default:
+      return FPTA_EINVAL;
+    case fpta_signed_int:
+    case fpta_unsigned_int:
+    case fpta_float_point:
+    case fpta_datetime:
+      break;
+    case fpta_string:
+    case fpta_binary:
+    case fpta_shoved:
+      if (unlikely(value.binary_length && !value.binary_data))
+        return FPTA_EINVAL;
+      bytes += value.binary_length + 1;
+      items += 1;
+      break;
+    }
+  }
+
+  set->kinds = 0;
+  if (items) {
+    size_t size = 8;
+    while (size < items * 2)
+      size <<= 1;
+    set->table.resize(size, fpta_value_set_item{0, nullptr, 0, fpta_null});
+    /* Память не перераспределяется, поэтому указатели на копии значений
+     * в элементах хеш-таблицы остаются действительными. */
+    set->bytes.reserve(bytes);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const fpta_value &value = values[i];
+    switch (value.type) {
+    default:
+      assert(false);
+      return FPTA_EOOPS;
+
+    case fpta_signed_int:
+      if (value.sint < 0)
+        set->negatives.push_back(value.sint);
+      else
+        set->unsigneds.push_back(uint64_t(value.sint));
+      set->numbers.push_back(double(value.sint));
+      break;
+
+    case fpta_unsigned_int:
+      set->unsigneds.push_back(value.uint);
+      set->numbers.push_back(double(value.uint));
+      break;
+
+    case fpta_float_point:
+      if (erthink::fpclassify_from_uint(value.uint).is_nan())
+        /* NaN не равен ни одному значению. Проверка по битовому
+         * представлению, так как std::isnan() при -ffast-math может
+         * считаться всегда ложным. */
+        break;
+      set->floats.push_back(value.fp);
+      set->numbers.push_back(value.fp);
+      break;
+
+    case fpta_datetime:
+      set->datetimes.push_back(value.datetime.fixedpoint);
+      break;
+
+    case fpta_string:
+    case fpta_binary:
+    case fpta_shoved: {
+      const fpta_value_type kind =
+          (value.type == fpta_string) ? fpta_string : fpta_binary;
+      const size_t offset = set->bytes.size();
+      set->bytes.insert(set->bytes.end(),
+                        static_cast<const char *>(value.binary_data),
+                        static_cast<const char *>(value.binary_data) +
+                            value.binary_length);
+      set->bytes.push_back(0);
+      if (!set->insert(set->bytes.data() + offset, value.binary_length, kind))
+        set->bytes.resize(offset);
+    } break;
+    }
+    set->kinds |= 1u << ((value.type == fpta_shoved) ? fpta_binary
+                                                      : value.type);
+  }
+
+  fpta_value_set_unique(set->unsigneds);
+  fpta_value_set_unique(set->negatives);
+  fpta_value_set_unique(set->floats);
+  fpta_value_set_unique(set->numbers);
+  fpta_value_set_unique(set->datetimes);
+  return FPTA_SUCCESS;
+}
+
+int fpta_filter_in_init(fpta_filter *filter, fpta_name *column_id,
+                        const fpta_value *values, size_t count) {
+  if (unlikely(filter == nullptr || (values == nullptr && count != 0)))
+    return FPTA_EINVAL;
+
+  int rc = fpta_id_validate(column_id, fpta_column);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_value_set *set = new (std::nothrow) fpta_value_set;
+  if (unlikely(set == nullptr))
+    return FPTA_ENOMEM;
+
+  try {
+    rc = fpta_value_set_build(set, values, count);
+  } catch (const std::bad_alloc &) {
+    rc = FPTA_ENOMEM;
+  }
+  if (unlikely(rc != FPTA_SUCCESS)) {
+    delete set;
+    return rc;
+  }
+
+  filter->type = fpta_node_in;
+  filter->node_in.left_id = column_id;
+  filter->node_in.set = set;
+  return FPTA_SUCCESS;
+}
+
+int fpta_filter_in_destroy(fpta_filter *filter) {
+  if (unlikely(filter == nullptr || filter->type != fpta_node_in))
+    return FPTA_EINVAL;
+
+  delete filter->node_in.set;
+  filter->node_in.set = nullptr;
+  return FPTA_SUCCESS;
+}
+
+unsigned fpta_value_set_kinds(const fpta_value_set *set) { return set->kinds; }
+
+__hot bool fpta_value_set_match(const fpta_value_set *set,
+                                const fptu_field *pf) {
+  const auto payload = pf->payload();
+  const void *data = payload->fixbin;
+  size_t length;
+
+  switch (pf->type()) {
+  case fptu_null /* here is/should not a composite column/index */:
+    return set->lookup("", 0, false);
+
+  case fptu_uint16:
+    return set->match_unsigned(pf->get_payload_uint16());
+  case fptu_uint32:
+    return set->match_unsigned(payload->peek_u32());
+  case fptu_uint64:
+    return set->match_unsigned(payload->peek_u64());
+  case fptu_int32:
+    return set->match_signed(payload->peek_i32());
+  case fptu_int64:
+    return set->match_signed(payload->peek_i64());
+  case fptu_fp32:
+    /* NaN в колонке также не равен ни одному значению */
+    return !erthink::fpclassify_from_uint(payload->peek_u32()).is_nan() &&
+           set->match_float(payload->peek_fp32());
+  case fptu_fp64:
+    return !erthink::fpclassify_from_uint(payload->peek_u64()).is_nan() &&
+           set->match_float(payload->peek_fp64());
+  case fptu_datetime:
+    return fpta_value_set_search(set->datetimes, payload->peek_u64());
+
+  case fptu_96:
+    length = 12;
+    break;
+  case fptu_128:
+    length = 16;
+    break;
+  case fptu_160:
+    length = 20;
+    break;
+  case fptu_256:
+    length = 32;
+    break;
+
+  case fptu_cstr:
+    return set->lookup(payload->cstr, strlen(payload->cstr), true);
+
+  case fptu_opaque:
+    return set->lookup(payload->inner_begin(), payload->varlen_opaque_bytes(),
+                       true);
+
+  case fptu_nested:
+    length = payload->varlen_brutto_size();
+    data = payload;
+    break;
+
+  default: /* fptu_farray */
+    length = payload->varlen_netto_size();
+    data = payload->inner_begin();
+    break;
+  }
+
+  return set->lookup(data, length, false);
+}
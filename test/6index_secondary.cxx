@@ -437,6 +437,19 @@ TEST_P(IndexSecondary, basic) {
     SCOPED_TRACE("key: " + std::to_string(key.type) + ", length " +
                  std::to_string(key.binary_length));
 
+    // ключи из индекса, без чтения строки
+    fpta_value se_key, pk_key;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get_keys(cursor, &se_key, &pk_key));
+    EXPECT_EQ(key.type, se_key.type);
+    EXPECT_EQ(key.binary_length, se_key.binary_length);
+    EXPECT_EQ(key.uint, se_key.uint);
+    if (pk_key.type != fpta_shoved) {
+      fptu_ro row_by_pk;
+      ASSERT_EQ(FPTA_OK, fpta_get(txn_guard.get(), &col_pk, &pk_key,
+                                  &row_by_pk));
+      EXPECT_EQ(tuple.sys.iov_base, row_by_pk.sys.iov_base);
+    }
+
     auto tuple_order = (int)fptu_get_sint(tuple, col_order.column.num, &error);
     ASSERT_EQ(FPTU_OK, error);
     if (fpta_index_is_ordered(se_index)) {
@@ -492,6 +505,39 @@ TEST_P(IndexSecondary, basic) {
   }
 
   EXPECT_EQ(FPTA_NODATA, fpta_cursor_eof(cursor));
+
+  // курсор "только по ключам" не читает строки
+  fpta_cursor *keys_cursor = nullptr;
+  fpta_filter filter;
+  filter.type = fpta_node_ne;
+  filter.node_cmp.left_id = &col_order;
+  filter.node_cmp.right_value = fpta_value_sint(-1);
+  EXPECT_EQ(FPTA_EFLAG,
+            fpta_cursor_open(txn_guard.get(), &col_se, fpta_value_begin(),
+                             fpta_value_end(), &filter,
+                             fpta_unsorted | fpta_keys_only, &keys_cursor));
+  EXPECT_EQ(nullptr, keys_cursor);
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn_guard.get(), &col_se,
+                                      fpta_value_begin(), fpta_value_end(),
+                                      nullptr,
+                                      fpta_unsorted_dont_fetch | fpta_keys_only,
+                                      &keys_cursor));
+  ASSERT_NE(nullptr, keys_cursor);
+  unsigned keys = 0;
+  int rc = fpta_cursor_move(keys_cursor, fpta_first);
+  for (; rc == FPTA_OK; rc = fpta_cursor_move(keys_cursor, fpta_next)) {
+    fptu_ro tuple;
+    EXPECT_EQ(FPTA_EFLAG, fpta_cursor_get(keys_cursor, &tuple));
+    fpta_value pk_key;
+    EXPECT_EQ(FPTA_OK, fpta_cursor_get_keys(keys_cursor, nullptr, &pk_key));
+    ++keys;
+  }
+  EXPECT_EQ(FPTA_NODATA, rc);
+  EXPECT_EQ(n, keys);
+  fpta_cursor_stat stat;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_info(keys_cursor, &stat));
+  EXPECT_EQ(0u, stat.pk_lookups);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(keys_cursor));
 }
 
 //----------------------------------------------------------------------------
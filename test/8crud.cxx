@@ -1519,6 +1519,250 @@ TEST(Nullable, SchemaReload) {
 
 //----------------------------------------------------------------------------
 
+static int savepoint_insert(fpta_txn *txn, fpta_name *table, fpta_name *pk,
+                            fpta_name *se, uint64_t key, uint64_t value) {
+  int rc = fpta_name_refresh_couple(txn, table, pk);
+  if (rc == FPTA_OK)
+    rc = fpta_name_refresh_couple(txn, table, se);
+  if (rc != FPTA_OK)
+    return rc;
+
+  fptu_rw *row = fptu_alloc(2, 32);
+  if (!row)
+    return FPTA_ENOMEM;
+  rc = fpta_upsert_column(row, pk, fpta_value_uint(key));
+  if (rc == FPTA_OK)
+    rc = fpta_upsert_column(row, se, fpta_value_uint(value));
+  if (rc == FPTA_OK)
+    rc = fpta_insert_row(txn, table, fptu_take_noshrink(row));
+  free(row);
+  return rc;
+}
+
+TEST(CRUD, Savepoints) {
+  /* Сценарий:
+   *  - точки сохранения недоступны в режиме MDBX_WRITEMAP;
+   *  - откат точки сохранения отменяет только её изменения,
+   *    а освобождение переносит их в объемлющую транзакцию;
+   *  - ошибка во вторичном индексе, обычно приводящая к прерыванию
+   *    всей транзакции, внутри точки сохранения откатывает только её. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_lazy, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  EXPECT_EQ(FPTA_ENOIMP, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_EPERM, fpta_savepoint_rollback(txn));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_sync, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("se", fptu_uint64,
+                                          fpta_secondary_unique_unordered,
+                                          &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, pk, se;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &se, "se"));
+
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  EXPECT_EQ(FPTA_EPERM, fpta_savepoint_release(txn));
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 1, 1));
+
+  /* откат */
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 2, 2));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_rollback(txn));
+
+  /* освобождение вложенных точек */
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 3, 3));
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 4, 4));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_release(txn));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_release(txn));
+
+  /* нарушение уникальности вторичного индекса */
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 5, 5));
+  EXPECT_EQ(FPTA_KEYEXIST, savepoint_insert(txn, &table, &pk, &se, 6, 1));
+  /* точка сохранения осталась активной, транзакция жива */
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 7, 7));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_release(txn));
+
+  /* незавершенная точка сохранения фиксируется вместе с транзакцией */
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, 8, 8));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  const uint64_t expected[] = {1, 3, 4, 7, 8};
+  size_t row_count = 0;
+  EXPECT_EQ(FPTA_OK, fpta_table_info(txn, &table, &row_count, nullptr));
+  EXPECT_EQ(sizeof(expected) / sizeof(expected[0]), row_count);
+  for (uint64_t key = 1; key <= 8; ++key) {
+    fptu_ro row;
+    fpta_value value = fpta_value_uint(key);
+    const bool present = std::find(std::begin(expected), std::end(expected),
+                                   key) != std::end(expected);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+    EXPECT_EQ(present ? FPTA_OK : FPTA_NOTFOUND,
+              fpta_get(txn, &pk, &value, &row))
+        << key;
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&pk);
+  fpta_name_destroy(&se);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(CRUD, SavepointCursors) {
+  /* Сценарий:
+   *  - курсор открытый внутри точки сохранения обновляет и удаляет строки,
+   *    после отката точки сохранения он отменяется;
+   *  - курсор открытый до точки сохранения удаляет строку внутри неё,
+   *    после неявного отката из-за ошибки он также отменяется;
+   *  - курсор открытый внутри точки сохранения переживает её освобождение
+   *    с сохранением позиции;
+   *  - заново открытый курсор видит восстановленные строки. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_sync, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("se", fptu_uint64,
+                                          fpta_secondary_unique_unordered,
+                                          &def));
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, pk, se;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &se, "se"));
+
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  for (uint64_t key = 1; key <= 4; ++key)
+    ASSERT_EQ(FPTA_OK, savepoint_insert(txn, &table, &pk, &se, key, key));
+
+  fptu_rw *row = fptu_alloc(2, 32);
+  ASSERT_NE(nullptr, row);
+  fpta_cursor *cursor = nullptr;
+  fpta_value key;
+
+  /* обновление и удаление посредством курсора с последующим откатом */
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                             nullptr, fpta_ascending, &cursor));
+  ASSERT_EQ(FPTU_OK, fptu_clear(row));
+  ASSERT_EQ(FPTA_OK, fpta_upsert_column(row, &pk, fpta_value_uint(1)));
+  ASSERT_EQ(FPTA_OK, fpta_upsert_column(row, &se, fpta_value_uint(42)));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_update(cursor, fptu_take_noshrink(row)));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_delete(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_rollback(txn));
+  EXPECT_EQ(FPTA_TXN_CANCELLED, fpta_cursor_key(cursor, &key));
+  EXPECT_EQ(FPTA_TXN_CANCELLED, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(FPTA_TXN_CANCELLED, fpta_cursor_delete(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  /* удаление курсором объемлющей транзакции и неявный откат */
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                             nullptr, fpta_descending, &cursor));
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_delete(cursor));
+  EXPECT_EQ(FPTA_KEYEXIST, savepoint_insert(txn, &table, &pk, &se, 5, 1));
+  EXPECT_EQ(FPTA_TXN_CANCELLED, fpta_cursor_delete(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_release(txn));
+
+  /* позиция курсора сохраняется при освобождении точки сохранения */
+  ASSERT_EQ(FPTA_OK, fpta_savepoint_begin(txn));
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                             nullptr, fpta_ascending, &cursor));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(FPTA_OK, fpta_savepoint_release(txn));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_key(cursor, &key));
+  EXPECT_EQ(2u, key.uint);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_key(cursor, &key));
+  EXPECT_EQ(3u, key.uint);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  /* все изменения откачены */
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                             nullptr, fpta_ascending, &cursor));
+  for (uint64_t expected = 1; expected <= 4; ++expected) {
+    fptu_ro tuple;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &tuple));
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(tuple, &pk, &value));
+    EXPECT_EQ(expected, value.uint);
+    EXPECT_EQ(FPTA_OK, fpta_get_column(tuple, &se, &value));
+    EXPECT_EQ(expected, value.uint);
+    EXPECT_EQ(expected < 4 ? FPTA_OK : FPTA_NODATA,
+              fpta_cursor_move(cursor, fpta_next));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  free(row);
+
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&pk);
+  fpta_name_destroy(&se);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//----------------------------------------------------------------------------
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   mdbx_setup_debug(MDBX_LOG_WARN,
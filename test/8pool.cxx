@@ -0,0 +1,300 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "fpta_test.h"
+#include <atomic>
+#include <chrono>
+
+#if STDTHREAD_WORKS
+#include <thread>
+#endif /* STDTHREAD_WORKS */
+
+static const char testdb_name[] = TEST_DB_DIR "ut_pool.fpta";
+static const char testdb_name_lck[] =
+    TEST_DB_DIR "ut_pool.fpta" MDBX_LOCK_SUFFIX;
+
+struct allocator_stat {
+  std::atomic<size_t> allocs, frees, bytes;
+};
+
+static void *counting_alloc(size_t bytes, void *ctx) {
+  allocator_stat *stat = static_cast<allocator_stat *>(ctx);
+  stat->allocs += 1;
+  stat->bytes += bytes;
+  return malloc(bytes);
+}
+
+static void counting_free(void *ptr, size_t bytes, void *ctx) {
+  allocator_stat *stat = static_cast<allocator_stat *>(ctx);
+  stat->frees += 1;
+  stat->bytes -= bytes;
+  free(ptr);
+}
+
+class Pool : public ::testing::Test {
+protected:
+  fpta_db *db = nullptr;
+  allocator_stat stat;
+  fpta_name table, pk;
+
+  void SetUp() override {
+    stat.allocs = stat.frees = stat.bytes = 0;
+    if (REMOVE_FILE(testdb_name) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+    if (REMOVE_FILE(testdb_name_lck) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+
+    fpta_db_creation_params_ex_t creation_params;
+    memset(&creation_params, 0, sizeof(creation_params));
+    creation_params.base.params_size = sizeof(creation_params);
+    creation_params.base.file_mode = 0644;
+    creation_params.base.size_lower = creation_params.base.size_upper = 1 << 20;
+    creation_params.base.pagesize = -1;
+    creation_params.base.growth_step = -1;
+    creation_params.base.shrink_threshold = -1;
+    creation_params.alloc_func = counting_alloc;
+    creation_params.free_func = counting_free;
+    creation_params.alloc_ctx = &stat;
+
+    ASSERT_EQ(FPTA_OK, fpta_db_create_or_open(nullptr, testdb_name, fpta_weak,
+                                              fpta_regime_default, true, &db,
+                                              &creation_params.base));
+    ASSERT_NE(nullptr, db);
+
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("pk", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+    EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+  }
+
+  void TearDown() override {
+    fpta_name_destroy(&table);
+    fpta_name_destroy(&pk);
+    if (db) {
+      EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+      /* Все блоки пула должны быть возвращены распределителю. */
+      EXPECT_EQ(stat.allocs.load(), stat.frees.load());
+      EXPECT_EQ(0u, stat.bytes.load());
+    }
+    ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+    ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+  }
+
+  void cycle() {
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+    ASSERT_NE(nullptr, txn);
+    fpta_cursor *cursor = nullptr;
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_open(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                               nullptr, fpta_unsorted_dont_fetch, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    ASSERT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+};
+
+TEST(PoolParams, AllocatorMismatch) {
+  fpta_db_creation_params_ex_t creation_params;
+  memset(&creation_params, 0, sizeof(creation_params));
+  creation_params.base.params_size = sizeof(creation_params);
+  creation_params.base.file_mode = 0644;
+  creation_params.base.size_lower = creation_params.base.size_upper = 1 << 20;
+  creation_params.base.pagesize = -1;
+  creation_params.base.growth_step = -1;
+  creation_params.base.shrink_threshold = -1;
+  creation_params.alloc_func = counting_alloc;
+
+  fpta_db *db = nullptr;
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_db_create_or_open(nullptr, testdb_name, fpta_weak,
+                                   fpta_regime_default, true, &db,
+                                   &creation_params.base));
+  EXPECT_EQ(nullptr, db);
+}
+
+TEST_F(Pool, Reuse) {
+  /* Повторные циклы открытия/закрытия не должны вызывать распределитель. */
+  cycle();
+  const size_t allocs = stat.allocs;
+  EXPECT_LT(0u, allocs);
+  for (int i = 0; i < 1000; ++i)
+    cycle();
+  EXPECT_EQ(allocs, stat.allocs.load());
+
+  /* Одновременно живущие объекты сверх кэша потока берутся из общего списка
+   * и наращивают пул блоками. */
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  std::vector<fpta_cursor *> cursors;
+  for (int i = 0; i < 100; ++i) {
+    fpta_cursor *cursor = nullptr;
+    EXPECT_EQ(FPTA_OK,
+              fpta_cursor_open(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                               nullptr, fpta_unsorted_dont_fetch, &cursor));
+    cursors.push_back(cursor);
+  }
+  EXPECT_LT(allocs, stat.allocs.load());
+  EXPECT_GT(allocs + 10, stat.allocs.load());
+  for (auto cursor : cursors)
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+}
+
+#if STDTHREAD_WORKS
+TEST_F(Pool, Threaded) {
+  const int threadNum = 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i)
+    threads.push_back(std::thread([this]() {
+      for (int n = 0; n < 10000; ++n)
+        cycle();
+    }));
+  for (auto &thread : threads)
+    thread.join();
+  /* Объекты из кэшей завершившихся потоков должны вернуться в пул. */
+  const size_t allocs = stat.allocs;
+  for (int i = 0; i < 1000; ++i)
+    cycle();
+  EXPECT_EQ(allocs, stat.allocs.load());
+}
+#endif /* STDTHREAD_WORKS */
+
+TEST_F(Pool, DISABLED_Benchmark) {
+  /* Псевдо-тест замера стоимости цикла begin/open/close/end для сравнения
+   * с предыдущими версиями (размещение через calloc/free).
+   *
+   * Результат зависит от окружения и ничего не проверяет, поэтому тест
+   * выполняется только явно, посредством --gtest_also_run_disabled_tests. */
+  const auto limit = std::chrono::milliseconds(250);
+
+  size_t count = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::nanoseconds duration;
+  do {
+    for (int i = 0; i < 100; ++i) {
+      fpta_txn *txn = nullptr;
+      ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+      ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    }
+    count += 100;
+    duration = std::chrono::steady_clock::now() - start;
+  } while (duration < limit);
+  std::cout << "[ BENCHMARK] read txn begin/end: "
+            << duration.count() / count << " ns/cycle" << std::endl;
+
+  count = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    for (int i = 0; i < 100; ++i)
+      cycle();
+    count += 100;
+    duration = std::chrono::steady_clock::now() - start;
+  } while (duration < limit);
+  std::cout << "[ BENCHMARK] begin/open/close/end: "
+            << duration.count() / count << " ns/cycle" << std::endl;
+}
+
+TEST_F(Pool, ParkedRead) {
+  fpta_txn *reader = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &reader));
+  ASSERT_NE(nullptr, reader);
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_resume(reader));
+
+  /* Открытые курсоры препятствуют парковке. */
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(reader, &table, &pk));
+  fpta_cursor *cursor = nullptr;
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(reader, &pk, fpta_value_begin(), fpta_value_end(),
+                             nullptr, fpta_unsorted_dont_fetch, &cursor));
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_park(reader));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  uint64_t version_before, version_after;
+  EXPECT_EQ(FPTA_OK,
+            fpta_transaction_versions(reader, &version_before, nullptr));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_park(reader));
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_park(reader));
+
+  /* Пока читатель припаркован, изменения не блокируются. */
+  fpta_txn *writer = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &writer));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(writer, &table, &pk));
+  fptu_rw *row = fptu_alloc(1, 16);
+  ASSERT_NE(nullptr, row);
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(row, &pk, fpta_value_uint(42)));
+  EXPECT_EQ(FPTA_OK, fpta_insert_row(writer, &table, fptu_take_noshrink(row)));
+  free(row);
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(writer, false));
+
+  ASSERT_EQ(FPTA_OK, fpta_transaction_resume(reader));
+  EXPECT_EQ(FPTA_OK,
+            fpta_transaction_versions(reader, &version_after, nullptr));
+  EXPECT_LT(version_before, version_after);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(reader, &table, &pk));
+  fpta_value key = fpta_value_uint(42);
+  fptu_ro found;
+  EXPECT_EQ(FPTA_OK, fpta_get(reader, &pk, &key, &found));
+
+  /* Припаркованная транзакция завершается обычным образом. */
+  ASSERT_EQ(FPTA_OK, fpta_transaction_park(reader));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(reader, false));
+
+  /* После завершения слот читателя должен быть освобожден. */
+  cycle();
+}
+
+TEST_F(Pool, DISABLED_ParkedReadBenchmark) {
+  /* Псевдо-тест замера стоимости цикла park/resume в сравнении
+   * с begin/end, см Pool.DISABLED_Benchmark. */
+  fpta_txn *reader = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &reader));
+  ASSERT_NE(nullptr, reader);
+
+  const auto limit = std::chrono::milliseconds(250);
+  size_t count = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::nanoseconds duration;
+  do {
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ(FPTA_OK, fpta_transaction_park(reader));
+      ASSERT_EQ(FPTA_OK, fpta_transaction_resume(reader));
+    }
+    count += 100;
+    duration = std::chrono::steady_clock::now() - start;
+  } while (duration < limit);
+  std::cout << "[ BENCHMARK] read txn park/resume: "
+            << duration.count() / count << " ns/cycle" << std::endl;
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(reader, false));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,540 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "fpta_test.h"
+#include <atomic>
+#include <chrono>
+
+#if STDTHREAD_WORKS
+#include <thread>
+#endif /* STDTHREAD_WORKS */
+
+#if defined(_WIN32) || defined(_WIN64)
+#define getpid() GetCurrentProcessId()
+#else
+#include <unistd.h>
+#endif
+
+static const char testdb_name[] = TEST_DB_DIR "ut_readers.fpta";
+static const char testdb_name_lck[] =
+    TEST_DB_DIR "ut_readers.fpta" MDBX_LOCK_SUFFIX;
+
+class Readers : public ::testing::Test {
+protected:
+  fpta_db *db = nullptr;
+  fpta_name table, pk, data;
+
+  void open(unsigned max_readers) {
+    if (REMOVE_FILE(testdb_name) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+    if (REMOVE_FILE(testdb_name_lck) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+
+    fpta_db_creation_params_ex_t creation_params;
+    memset(&creation_params, 0, sizeof(creation_params));
+    creation_params.base.params_size = sizeof(creation_params);
+    creation_params.base.file_mode = 0644;
+    creation_params.base.size_lower = creation_params.base.size_upper = 1 << 20;
+    creation_params.base.pagesize = 4096;
+    creation_params.base.growth_step = -1;
+    creation_params.base.shrink_threshold = -1;
+    creation_params.max_readers = max_readers;
+
+    ASSERT_EQ(FPTA_OK, fpta_db_create_or_open(nullptr, testdb_name, fpta_weak,
+                                              fpta_regime_default, true, &db,
+                                              &creation_params.base));
+    ASSERT_NE(nullptr, db);
+
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("pk", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("data", fptu_opaque,
+                                            fpta_noindex_nullable, &def));
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+    EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &data, "data"));
+  }
+
+  void TearDown() override {
+    fpta_name_destroy(&table);
+    fpta_name_destroy(&pk);
+    fpta_name_destroy(&data);
+    if (db) {
+      EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+      ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+      ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+    }
+  }
+
+  /* Обновляет запись с заданным ключом значением размером в страницу БД,
+   * тем самым каждая транзакция отправляет в мусор несколько страниц. */
+  int update(uint64_t key) {
+    fpta_txn *txn = nullptr;
+    int rc = fpta_transaction_begin(db, fpta_write, &txn);
+    if (rc != FPTA_OK)
+      return rc;
+
+    rc = fpta_name_refresh_couple(txn, &table, &pk);
+    if (rc == FPTA_OK)
+      rc = fpta_name_refresh_couple(txn, &table, &data);
+    if (rc == FPTA_OK) {
+      static uint64_t payload[4096 / sizeof(uint64_t)];
+      payload[0] += 1;
+      fptu_rw *row = fptu_alloc(2, sizeof(payload) + 16);
+      if (!row)
+        rc = FPTA_ENOMEM;
+      else {
+        rc = fpta_upsert_column(row, &pk, fpta_value_uint(key));
+        if (rc == FPTA_OK)
+          rc = fpta_upsert_column(
+              row, &data, fpta_value_binary(payload, sizeof(payload)));
+        if (rc == FPTA_OK)
+          rc = fpta_upsert_row(txn, &table, fptu_take_noshrink(row));
+        free(row);
+      }
+    }
+
+    int err = fpta_transaction_end(txn, rc != FPTA_OK);
+    return (rc != FPTA_OK) ? rc : err;
+  }
+
+  /* Вставляет (или удаляет) строки с ключами из заданного списка,
+   * в отдельном потоке, так как текущий поток занят транзакцией чтения. */
+  int modify(std::initializer_list<uint64_t> keys, bool remove = false) {
+    int rc = FPTA_OK;
+    auto worker = [&]() {
+      fpta_txn *txn = nullptr;
+      rc = fpta_transaction_begin(db, fpta_write, &txn);
+      if (rc != FPTA_OK)
+        return;
+      rc = fpta_name_refresh_couple(txn, &table, &pk);
+      for (auto key : keys) {
+        if (rc != FPTA_OK)
+          break;
+        fptu_rw *row = fptu_alloc(1, 8);
+        if (!row) {
+          rc = FPTA_ENOMEM;
+          break;
+        }
+        rc = fpta_upsert_column(row, &pk, fpta_value_uint(key));
+        if (rc == FPTA_OK)
+          rc = remove ? fpta_delete(txn, &table, fptu_take_noshrink(row))
+                      : fpta_upsert_row(txn, &table, fptu_take_noshrink(row));
+        free(row);
+      }
+      int err = fpta_transaction_end(txn, rc != FPTA_OK);
+      if (rc == FPTA_OK)
+        rc = err;
+    };
+#if STDTHREAD_WORKS
+    std::thread thread(worker);
+    thread.join();
+#else
+    worker();
+#endif /* STDTHREAD_WORKS */
+    return rc;
+  }
+};
+
+struct readers_collector {
+  std::vector<fpta_reader_info> list;
+
+  static int enumerate(void *ctx, const fpta_reader_info *info) {
+    static_cast<readers_collector *>(ctx)->list.push_back(*info);
+    return 0;
+  }
+};
+
+TEST_F(Readers, MaxReaders) {
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  fpta_db_stat_t stat;
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_LE(unsigned(FPTA_DEFAULT_MAX_READERS), stat.maxreaders);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  db = nullptr;
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&pk);
+  fpta_name_destroy(&data);
+
+  ASSERT_NO_FATAL_FAILURE(open(500));
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_LE(500u, stat.maxreaders);
+}
+
+TEST_F(Readers, List) {
+  ASSERT_NO_FATAL_FAILURE(open(0));
+
+  readers_collector collector;
+  EXPECT_EQ(FPTA_NODATA, fpta_db_readers(db, readers_collector::enumerate,
+                                         &collector));
+  EXPECT_TRUE(collector.list.empty());
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_readers(db, nullptr, nullptr));
+
+  fpta_txn *reader = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &reader));
+  uint64_t snapshot;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(reader, &snapshot, nullptr));
+
+#if STDTHREAD_WORKS
+  /* Пишущие транзакции выполняются в отдельном потоке, так как текущий
+   * поток уже занят транзакцией чтения. */
+  std::thread writer([this]() {
+    for (unsigned i = 0; i < 3; ++i)
+      EXPECT_EQ(FPTA_OK, update(i));
+  });
+  writer.join();
+  const uint64_t expected_lag = 3;
+#else
+  const uint64_t expected_lag = 0;
+#endif /* STDTHREAD_WORKS */
+
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_readers(db, readers_collector::enumerate, &collector));
+  ASSERT_EQ(1u, collector.list.size());
+  EXPECT_LE(0, collector.list[0].slot);
+  EXPECT_EQ(intptr_t(getpid()), collector.list[0].pid);
+  EXPECT_EQ(snapshot, collector.list[0].txnid);
+  EXPECT_EQ(expected_lag, collector.list[0].lag);
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(reader, false));
+  collector.list.clear();
+  EXPECT_EQ(FPTA_NODATA, fpta_db_readers(db, readers_collector::enumerate,
+                                         &collector));
+}
+
+#if STDTHREAD_WORKS
+
+struct laggard_handler {
+  std::atomic<unsigned> calls{0};
+  std::atomic<bool> restart_requested{false}, restarted{false};
+  fpta_laggard_action action = fpta_laggard_giveup;
+  fpta_reader_info last;
+
+  static fpta_laggard_action handle(fpta_db *db, const fpta_reader_info *info,
+                                    int retry, void *ctx) {
+    (void)db;
+    laggard_handler *self = static_cast<laggard_handler *>(ctx);
+    if (retry < 0)
+      /* Уведомление о завершении цикла обработки. */
+      return fpta_laggard_retry;
+
+    self->calls += 1;
+    self->last = *info;
+    if (self->action != fpta_laggard_retry)
+      return self->action;
+
+    /* Просим читателя перезапустить транзакцию и ждем реакции. */
+    self->restart_requested = true;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!self->restarted) {
+      if (std::chrono::steady_clock::now() > deadline)
+        return fpta_laggard_giveup;
+      std::this_thread::yield();
+    }
+    return fpta_laggard_retry;
+  }
+};
+
+TEST_F(Readers, LaggardGiveUp) {
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  laggard_handler handler;
+  ASSERT_EQ(FPTA_OK,
+            fpta_db_set_laggard_handler(db, laggard_handler::handle, &handler));
+
+  fpta_txn *reader = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &reader));
+  uint64_t snapshot;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(reader, &snapshot, nullptr));
+
+  /* Пока читатель удерживает снимок, место в БД исчерпывается. */
+  int rc = FPTA_OK;
+  std::thread writer([this, &rc]() {
+    for (unsigned i = 0; i < 1000 && rc == FPTA_OK; ++i)
+      rc = update(i % 8);
+  });
+  writer.join();
+  EXPECT_EQ(FPTA_DB_FULL, rc);
+  EXPECT_LT(0u, handler.calls.load());
+  EXPECT_EQ(intptr_t(getpid()), handler.last.pid);
+  EXPECT_EQ(snapshot, handler.last.txnid);
+  EXPECT_LT(0u, handler.last.lag);
+
+  /* После завершения читателя место снова доступно. */
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(reader, false));
+  std::thread after([this, &rc]() {
+    for (unsigned i = 0; i < 100 && rc != FPTA_OK; ++i)
+      rc = update(i % 8);
+  });
+  after.join();
+  EXPECT_EQ(FPTA_OK, rc);
+}
+
+TEST_F(Readers, LaggardRestart) {
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  laggard_handler handler;
+  handler.action = fpta_laggard_retry;
+  ASSERT_EQ(FPTA_OK,
+            fpta_db_set_laggard_handler(db, laggard_handler::handle, &handler));
+
+  /* Читатель ждет просьбы о перезапуске и освобождает снимок. */
+  std::atomic<bool> reader_started{false};
+  std::thread reader([this, &handler, &reader_started]() {
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+    reader_started = true;
+    while (!handler.restart_requested)
+      std::this_thread::yield();
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    handler.restarted = true;
+  });
+  while (!reader_started)
+    std::this_thread::yield();
+
+  int rc = FPTA_OK;
+  std::thread writer([this, &rc]() {
+    for (unsigned i = 0; i < 1000 && rc == FPTA_OK; ++i)
+      rc = update(i % 8);
+  });
+  writer.join();
+  reader.join();
+  EXPECT_EQ(FPTA_OK, rc);
+  EXPECT_LT(0u, handler.calls.load());
+  EXPECT_TRUE(handler.restarted.load());
+}
+
+
+static uint64_t cursor_key(fpta_cursor *cursor) {
+  fpta_value key;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_key(cursor, &key));
+  return key.uint;
+}
+
+TEST_F(Readers, ManagedCheckpoint) {
+  /* Сценарий:
+   *  - курсоры управляемой сессии продолжают просмотр после перезапуска;
+   *  - удаление текущей строки не приводит к пропускам и повторам;
+   *  - после перезапуска видны строки, вставленные впереди курсора. */
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  ASSERT_EQ(FPTA_OK, modify({10, 20, 30, 40, 50}));
+
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_checkpoint(txn));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_autorestart(txn, 1, 0, 0));
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_park(txn));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+
+  fpta_cursor *ascending = nullptr, *descending = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &ascending));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_descending, &descending));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_move(ascending, fpta_next));
+  EXPECT_EQ(20u, cursor_key(ascending));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_move(descending, fpta_next));
+  EXPECT_EQ(40u, cursor_key(descending));
+
+  uint64_t before, after;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &before, nullptr));
+  /* Без изменений перезапуск не выполняется. */
+  EXPECT_EQ(FPTA_OK, fpta_transaction_checkpoint(txn));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &after, nullptr));
+  EXPECT_EQ(before, after);
+
+  ASSERT_EQ(FPTA_OK, modify({20, 40}, true));
+  ASSERT_EQ(FPTA_OK, modify({5, 25, 35, 45}));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_checkpoint(txn));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &after, nullptr));
+  EXPECT_LT(before, after);
+
+  std::vector<uint64_t> rest;
+  while (fpta_cursor_move(ascending, fpta_next) == FPTA_OK)
+    rest.push_back(cursor_key(ascending));
+  EXPECT_EQ(std::vector<uint64_t>({25, 30, 35, 45, 50}), rest);
+
+  rest.clear();
+  while (fpta_cursor_move(descending, fpta_next) == FPTA_OK)
+    rest.push_back(cursor_key(descending));
+  EXPECT_EQ(std::vector<uint64_t>({35, 30, 25, 10, 5}), rest);
+
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(ascending));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(descending));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+}
+
+TEST_F(Readers, ManagedEarlyCursor) {
+  /* Курсор открытый до включения управляемой сессии также
+   * переустанавливается при перезапуске. */
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  ASSERT_EQ(FPTA_OK, modify({10, 20, 30}));
+
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+  fpta_cursor *cursor = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(20u, cursor_key(cursor));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_autorestart(txn, 1, 0, 0));
+
+  uint64_t before, after;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &before, nullptr));
+  ASSERT_EQ(FPTA_OK, modify({20}, true));
+  ASSERT_EQ(FPTA_OK, modify({25}));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_checkpoint(txn));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &after, nullptr));
+  EXPECT_LT(before, after);
+
+  std::vector<uint64_t> rest;
+  while (fpta_cursor_move(cursor, fpta_next) == FPTA_OK)
+    rest.push_back(cursor_key(cursor));
+  EXPECT_EQ(std::vector<uint64_t>({25, 30}), rest);
+
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+}
+
+TEST_F(Readers, ManagedBatch) {
+  /* Пакетная выборка в управляемой сессии: перезапуск выполняется перед
+   * выборкой пакета, а удаление строки в позиции курсора не приводит
+   * к пропускам и повторам. */
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  ASSERT_EQ(FPTA_OK, modify({10, 20, 30, 40, 50}));
+
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_autorestart(txn, 1, 0, 0));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+
+  fpta_cursor *ascending = nullptr, *descending = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &ascending));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_descending, &descending));
+
+  /* Пакет больше интервала проверок, чтобы вызвать перезапуск. */
+  std::vector<fpta_value> keys(2048);
+  size_t fetched;
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_get_batch_ex(ascending, nullptr, keys.data(), 2,
+                                     &fetched));
+  ASSERT_EQ(2u, fetched);
+  EXPECT_EQ(10u, keys[0].uint);
+  EXPECT_EQ(20u, keys[1].uint);
+  EXPECT_EQ(30u, cursor_key(ascending));
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_get_batch_ex(descending, nullptr, keys.data(), 2,
+                                     &fetched));
+  ASSERT_EQ(2u, fetched);
+  EXPECT_EQ(50u, keys[0].uint);
+  EXPECT_EQ(40u, keys[1].uint);
+  EXPECT_EQ(30u, cursor_key(descending));
+
+  ASSERT_EQ(FPTA_OK, modify({30}, true));
+  ASSERT_EQ(FPTA_OK, modify({35}));
+
+  ASSERT_EQ(FPTA_OK, fpta_cursor_get_batch_ex(ascending, nullptr, keys.data(),
+                                              keys.size(), &fetched));
+  EXPECT_EQ(std::vector<uint64_t>({35, 40, 50}),
+            std::vector<uint64_t>({keys[0].uint, keys[1].uint, keys[2].uint}));
+  EXPECT_EQ(3u, fetched);
+  ASSERT_EQ(FPTA_OK, fpta_cursor_get_batch_ex(descending, nullptr, keys.data(),
+                                              keys.size(), &fetched));
+  EXPECT_EQ(2u, fetched);
+  EXPECT_EQ(20u, keys[0].uint);
+  EXPECT_EQ(10u, keys[1].uint);
+
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(ascending));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(descending));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+}
+
+TEST_F(Readers, ManagedAutoRestart) {
+  /* Долгий просмотр с периодическими изменениями данных: транзакция
+   * перезапускается самостоятельно и не удерживает старые снимки. */
+  ASSERT_NO_FATAL_FAILURE(open(0));
+  const unsigned total = 5000;
+  for (unsigned i = 0; i < total; i += 500) {
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+    for (unsigned n = i; n < i + 500; ++n) {
+      fptu_rw *row = fptu_alloc(1, 8);
+      ASSERT_NE(nullptr, row);
+      ASSERT_EQ(FPTA_OK, fpta_upsert_column(row, &pk, fpta_value_uint(n * 2)));
+      ASSERT_EQ(FPTA_OK,
+                fpta_insert_row(txn, &table, fptu_take_noshrink(row)));
+      free(row);
+    }
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_autorestart(txn, 1, 0, 0));
+  uint64_t before, after;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &before, nullptr));
+
+  fpta_cursor *cursor = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  unsigned count = 0;
+  uint64_t prev = 0;
+  do {
+    const uint64_t key = cursor_key(cursor);
+    if (count) {
+      ASSERT_LT(prev, key);
+    }
+    prev = key;
+    count += 1;
+    if (count % 700 == 0) {
+      /* Нечетные ключи впереди курсора не должны нарушать порядок. */
+      ASSERT_EQ(FPTA_OK, modify({key + 1001}));
+    }
+  } while (fpta_cursor_move(cursor, fpta_next) == FPTA_OK);
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &after, nullptr));
+  EXPECT_LT(before, after);
+  EXPECT_LE(total, count);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+}
+
+#endif /* STDTHREAD_WORKS */
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
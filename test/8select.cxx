@@ -505,6 +505,1186 @@ TEST(Select, ChoppedLookup) {
 
 //----------------------------------------------------------------------------
 
+struct merge_join_collector {
+  fpta_name *left_key, *left_id, *right_key, *right_id;
+  int stop_after /* результат функтора */;
+  std::vector<uint64_t> keys;
+  std::vector<std::pair<uint64_t, uint64_t>> pairs;
+
+  static uint64_t get(const fptu_ro *row, fpta_name *column) {
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(*row, column, &value));
+    return value.uint;
+  }
+
+  static int visitor(const fptu_ro *left_row, const fptu_ro *right_row,
+                     void *context) {
+    merge_join_collector *self = static_cast<merge_join_collector *>(context);
+    const uint64_t key = get(left_row, self->left_key);
+    EXPECT_EQ(key, get(right_row, self->right_key));
+    self->keys.push_back(key);
+    self->pairs.emplace_back(get(left_row, self->left_id),
+                             get(right_row, self->right_id));
+    return self->stop_after;
+  }
+};
+
+TEST(Select, MergeJoin) {
+  /* Проверка соединения слиянием посредством fpta_merge_join().
+   *
+   * Сценарий:
+   *  1. Создаем таблицы sessions (id = 3 * i) и counters (cid = i,
+   *     sid = i % 150), в последней значения sid повторяются.
+   *
+   *  2. Соединяем sessions.id с counters.sid, counters.sid с sessions.id
+   *     и counters.sid с самим собой (дубликаты с обеих сторон),
+   *     по-возрастанию и по-убыванию.
+   *
+   *  3. Сверяем полученные пары с результатом соединения вложенными циклами
+   *     и порядок ключей, проверяем прерывание функтором и отказы для
+   *     несовместимых курсоров. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime4testing,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  { // create tables
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("id", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                           "tag", fptu_cstr,
+                           fpta_secondary_withdups_ordered_obverse, &def));
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "sessions", &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("cid", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                           "sid", fptu_uint64,
+                           fpta_secondary_withdups_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "counters", &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_name sessions, id, tag, counters, cid, sid;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&sessions, "sessions"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&sessions, &id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&sessions, &tag, "tag"));
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&counters, "counters"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&counters, &cid, "cid"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&counters, &sid, "sid"));
+
+  const unsigned sessions_count = 100, counters_count = 400;
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &sessions, &id));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &sessions, &tag));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &counters, &cid));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &counters, &sid));
+  fptu_rw *pt = fptu_alloc(2, 64);
+  ASSERT_NE(nullptr, pt);
+  for (unsigned i = 0; i < sessions_count; ++i) {
+    ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &id, fpta_value_uint(i * 3)));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(
+                           pt, &tag, fpta_value_cstr(i % 2 ? "odd" : "even")));
+    ASSERT_EQ(FPTA_OK,
+              fpta_insert_row(txn, &sessions, fptu_take_noshrink(pt)));
+  }
+  for (unsigned i = 0; i < counters_count; ++i) {
+    ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &cid, fpta_value_uint(i)));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &sid, fpta_value_uint(i % 150)));
+    ASSERT_EQ(FPTA_OK,
+              fpta_insert_row(txn, &counters, fptu_take_noshrink(pt)));
+  }
+  free(pt);
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+
+  struct side {
+    fpta_name *key, *id;
+    std::vector<std::pair<uint64_t, uint64_t>> rows /* key, id */;
+  };
+  side s_by_id{&id, &id, {}}, c_by_sid{&sid, &cid, {}};
+  for (unsigned i = 0; i < sessions_count; ++i)
+    s_by_id.rows.emplace_back(i * 3, i * 3);
+  for (unsigned i = 0; i < counters_count; ++i)
+    c_by_sid.rows.emplace_back(i % 150, i);
+
+  const std::pair<const side *, const side *> cases[] = {
+      {&s_by_id, &c_by_sid}, {&c_by_sid, &s_by_id}, {&c_by_sid, &c_by_sid}};
+  for (size_t n = 0; n < 3; ++n) {
+    const auto &join = cases[n];
+    for (const auto ordering : {fpta_ascending, fpta_descending}) {
+      SCOPED_TRACE("join-case " + std::to_string(n) + ", ordering " +
+                   std::to_string(ordering));
+      std::vector<std::pair<uint64_t, uint64_t>> expected;
+      for (const auto &l : join.first->rows)
+        for (const auto &r : join.second->rows)
+          if (l.first == r.first)
+            expected.emplace_back(l.second, r.second);
+      std::sort(expected.begin(), expected.end());
+
+      fpta_cursor *left, *right;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, join.first->key,
+                                          fpta_value_begin(), fpta_value_end(),
+                                          nullptr, ordering, &left));
+      ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, join.second->key,
+                                          fpta_value_begin(), fpta_value_end(),
+                                          nullptr, ordering, &right));
+      merge_join_collector collector{join.first->key,  join.first->id,
+                                     join.second->key, join.second->id,
+                                     FPTA_OK,          {},
+                                     {}};
+      EXPECT_EQ(FPTA_OK, fpta_merge_join(left, right,
+                                         merge_join_collector::visitor,
+                                         &collector));
+      if (ordering == fpta_ascending)
+        EXPECT_TRUE(std::is_sorted(collector.keys.begin(),
+                                   collector.keys.end()));
+      else
+        EXPECT_TRUE(std::is_sorted(collector.keys.rbegin(),
+                                   collector.keys.rend()));
+      std::sort(collector.pairs.begin(), collector.pairs.end());
+      EXPECT_EQ(expected, collector.pairs);
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(left));
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(right));
+    }
+  }
+
+  fpta_cursor *left, *right, *other;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &id, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &left));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &sid, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &right));
+  merge_join_collector collector{&id, &id, &sid, &cid, 42, {}, {}};
+  EXPECT_EQ(42, fpta_merge_join(left, right, merge_join_collector::visitor,
+                                &collector));
+  EXPECT_EQ(1u, collector.pairs.size());
+  EXPECT_EQ(FPTA_EINVAL, fpta_merge_join(left, left,
+                                         merge_join_collector::visitor,
+                                         &collector));
+  EXPECT_EQ(FPTA_EINVAL, fpta_merge_join(left, right, nullptr, &collector));
+
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &sid, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_descending, &other));
+  EXPECT_EQ(FPTA_EFLAG, fpta_merge_join(left, other,
+                                        merge_join_collector::visitor,
+                                        &collector));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(other));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &tag, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &other));
+  EXPECT_EQ(FPTA_ETYPE, fpta_merge_join(left, other,
+                                        merge_join_collector::visitor,
+                                        &collector));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(other));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(left));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(right));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  /* В пишущей транзакции соединение не допускается. */
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &id, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &left));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &sid, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &right));
+  EXPECT_EQ(FPTA_EPERM, fpta_merge_join(left, right,
+                                        merge_join_collector::visitor,
+                                        &collector));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(left));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(right));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, true));
+
+  fpta_name_destroy(&sessions);
+  fpta_name_destroy(&id);
+  fpta_name_destroy(&tag);
+  fpta_name_destroy(&counters);
+  fpta_name_destroy(&cid);
+  fpta_name_destroy(&sid);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Select, WideRowFilter) {
+  /* Проверка фильтров с условиями на многие колонки широких строк.
+   *
+   * Сценарий:
+   *  1. Создаем таблицу с первичным ключом и 24 nullable-колонками,
+   *     в строках которой отсутствует часть полей.
+   *
+   *  2. Открываем курсоры с фильтрами, обращающимися к нескольким колонкам
+   *     (в том числе повторно, к отсутствующим полям и к NULL), а также
+   *     к большему количеству колонок, чем умещается в таблице слотов.
+   *
+   *  3. Сверяем выборку курсора с результатом fpta_filter_match(). */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime4testing,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  const unsigned columns_count = 24, rows_count = 300;
+  { // create table
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("id", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    for (unsigned i = 0; i < columns_count; ++i)
+      EXPECT_EQ(FPTA_OK,
+                fpta_column_describe(("c" + std::to_string(i)).c_str(),
+                                     fptu_int32, fpta_noindex_nullable, &def));
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "telemetry", &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_name table, id, cols[columns_count];
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "telemetry"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &id, "id"));
+  for (unsigned i = 0; i < columns_count; ++i)
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &cols[i],
+                                        ("c" + std::to_string(i)).c_str()));
+
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &id));
+  for (unsigned i = 0; i < columns_count; ++i)
+    ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &cols[i]));
+  fptu_rw *pt = fptu_alloc(columns_count + 1, columns_count * 8);
+  ASSERT_NE(nullptr, pt);
+  for (unsigned n = 0; n < rows_count; ++n) {
+    ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &id, fpta_value_uint(n)));
+    for (unsigned i = 0; i < columns_count; ++i) {
+      if ((n * i + 1) % 5 == 0)
+        continue /* часть полей отсутствует */;
+      ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &cols[i],
+                                            fpta_value_sint(n * (i + 1) % 7)));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  free(pt);
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+
+  auto check = [&](fpta_filter *filter) {
+    std::vector<uint64_t> rows, expected;
+    fpta_cursor *cursor = nullptr;
+    int rc = fpta_cursor_open(txn, &id, fpta_value_begin(), fpta_value_end(),
+                              filter, fpta_ascending, &cursor);
+    if (rc != FPTA_NODATA) {
+      ASSERT_EQ(FPTA_OK, rc);
+      while (rc == FPTA_OK) {
+        fptu_ro row;
+        fpta_value value;
+        ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+        ASSERT_EQ(FPTA_OK, fpta_get_column(row, &id, &value));
+        rows.push_back(value.uint);
+        rc = fpta_cursor_move(cursor, fpta_next);
+      }
+      EXPECT_EQ(FPTA_NODATA, rc);
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    }
+
+    ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &id, fpta_value_begin(),
+                                        fpta_value_end(), nullptr,
+                                        fpta_ascending, &cursor));
+    do {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &id, &value));
+      if (fpta_filter_match(filter, row))
+        expected.push_back(value.uint);
+    } while (fpta_cursor_move(cursor, fpta_next) == FPTA_OK);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(expected, rows);
+  };
+
+  // c3 > 2 AND c7 != NULL AND (c11 == 4 OR NOT c19 < 3)
+  // AND odd(c5) AND c3 != 6 AND c23 <= 5
+  fpta_filter gt, not_null, eq, lt, not_lt, odd, ne, le, or1, and1, and2, and3,
+      and4, and5;
+  gt.type = fpta_node_gt;
+  gt.node_cmp.left_id = &cols[3];
+  gt.node_cmp.right_value = fpta_value_sint(2);
+  not_null.type = fpta_node_ne;
+  not_null.node_cmp.left_id = &cols[7];
+  not_null.node_cmp.right_value = fpta_value_null();
+  eq.type = fpta_node_eq;
+  eq.node_cmp.left_id = &cols[11];
+  eq.node_cmp.right_value = fpta_value_sint(4);
+  lt.type = fpta_node_lt;
+  lt.node_cmp.left_id = &cols[19];
+  lt.node_cmp.right_value = fpta_value_sint(3);
+  not_lt.type = fpta_node_not;
+  not_lt.node_not = &lt;
+  odd.type = fpta_node_fncol;
+  odd.node_fncol.column_id = &cols[5];
+  odd.node_fncol.arg = nullptr /* unused */;
+  odd.node_fncol.predicate = [](const fptu_field *column, void *) {
+    return column && (fptu_field_int32(column) & 1) != 0;
+  };
+  ne.type = fpta_node_ne;
+  ne.node_cmp.left_id = &cols[3];
+  ne.node_cmp.right_value = fpta_value_sint(6);
+  le.type = fpta_node_le;
+  le.node_cmp.left_id = &cols[23];
+  le.node_cmp.right_value = fpta_value_sint(5);
+  or1.type = fpta_node_or;
+  or1.node_or.a = &eq;
+  or1.node_or.b = &not_lt;
+  and1.type = and2.type = and3.type = and4.type = and5.type = fpta_node_and;
+  and1.node_and.a = &gt;
+  and1.node_and.b = &not_null;
+  and2.node_and.a = &and1;
+  and2.node_and.b = &or1;
+  and3.node_and.a = &and2;
+  and3.node_and.b = &odd;
+  and4.node_and.a = &ne;
+  and4.node_and.b = &le;
+  and5.node_and.a = &and3;
+  and5.node_and.b = &and4;
+  check(&and5);
+  check(&or1);
+
+  // NOT c0 == 6 AND NOT c1 == 6 ... AND NOT c19 == 6, колонок больше
+  // чем слотов, поэтому поля ищутся по-отдельности
+  fpta_filter eqs[20], nots[20], ands[19];
+  for (unsigned i = 0; i < 20; ++i) {
+    eqs[i].type = fpta_node_eq;
+    eqs[i].node_cmp.left_id = &cols[i];
+    eqs[i].node_cmp.right_value = fpta_value_sint(6);
+    nots[i].type = fpta_node_not;
+    nots[i].node_not = &eqs[i];
+    if (i) {
+      ands[i - 1].type = fpta_node_and;
+      ands[i - 1].node_and.a = (i > 1) ? &ands[i - 2] : &nots[0];
+      ands[i - 1].node_and.b = &nots[i];
+    }
+  }
+  check(&ands[18]);
+
+  // адаптивное упорядочивание: дорогой предикат строки AND c0 == 1
+  size_t calls = 0;
+  fpta_filter counted, c0, adaptive;
+  counted.type = fpta_node_fnrow;
+  counted.node_fnrow.context = nullptr /* unused */;
+  counted.node_fnrow.arg = &calls;
+  counted.node_fnrow.predicate = [](const fptu_ro *, void *, void *arg) {
+    *static_cast<size_t *>(arg) += 1;
+    return true;
+  };
+  c0.type = fpta_node_eq;
+  c0.node_cmp.left_id = &cols[0];
+  c0.node_cmp.right_value = fpta_value_sint(1);
+  adaptive.type = fpta_node_and;
+  adaptive.node_and.a = &counted;
+  adaptive.node_and.b = &c0;
+  check(&adaptive);
+  EXPECT_EQ(rows_count * 2, calls);
+
+  fpta_cursor *cursor = nullptr;
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &id, fpta_value_begin(), fpta_value_end(),
+                             &adaptive, fpta_ascending | fpta_adaptive_filter,
+                             &cursor));
+  fpta_cursor_stat stat;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_info(cursor, &stat));
+  EXPECT_EQ(0u, stat.filter_reorders);
+  EXPECT_EQ(0u, stat.filter_swaps);
+  calls = 0;
+  size_t found = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    int rc = fpta_cursor_move(cursor, fpta_first);
+    while (rc == FPTA_OK) {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &cols[0], &value));
+      EXPECT_EQ(1, value.sint);
+      found += 1;
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+  }
+  ASSERT_EQ(FPTA_OK, fpta_cursor_info(cursor, &stat));
+  EXPECT_EQ(1u, stat.filter_reorders);
+  EXPECT_EQ(1u, stat.filter_swaps);
+  EXPECT_EQ(size_t(rows_count / 7 * 2 + 2), found);
+  /* до перестановки предикат вызывается для каждой строки,
+   * а после только для строк с c0 == 1 */
+  EXPECT_GT(size_t(rows_count * 2 * 3 / 4), calls);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  // перестановка вложенного узла: (предикат AND c0 == 1) AND c3 != 6,
+  // заново генерируется только поддерево вложенного узла
+  fpta_filter nested;
+  nested.type = fpta_node_and;
+  nested.node_and.a = &adaptive;
+  nested.node_and.b = &ne;
+  std::vector<uint64_t> expected;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &id, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  do {
+    fptu_ro row;
+    fpta_value value;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &id, &value));
+    if (fpta_filter_match(&nested, row))
+      expected.push_back(value.uint);
+  } while (fpta_cursor_move(cursor, fpta_next) == FPTA_OK);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_FALSE(expected.empty());
+
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &id, fpta_value_begin(), fpta_value_end(),
+                             &nested, fpta_ascending | fpta_adaptive_filter,
+                             &cursor));
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<uint64_t> rows;
+    int rc = fpta_cursor_move(cursor, fpta_first);
+    while (rc == FPTA_OK) {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &id, &value));
+      rows.push_back(value.uint);
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(expected, rows);
+  }
+  ASSERT_EQ(FPTA_OK, fpta_cursor_info(cursor, &stat));
+  EXPECT_EQ(1u, stat.filter_reorders);
+  EXPECT_EQ(2u, stat.filter_swaps);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&id);
+  for (unsigned i = 0; i < columns_count; ++i)
+    fpta_name_destroy(&cols[i]);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Select, FilterIn) {
+  /* Проверка условия принадлежности множеству значений (fpta_node_in).
+   *
+   * Сценарий:
+   *  1. Создаем таблицу с колонками id (первичный ключ), name (строка)
+   *     и ratio (nullable, с плавающей точкой, отсутствует в каждой
+   *     третьей строке).
+   *
+   *  2. Формируем множества из тысяч целых чисел, в том числе
+   *     отрицательных и за пределами диапазона, строк и двоичных
+   *     данных, чисел разных типов для колонки с плавающей точкой,
+   *     а также несравнимых с колонкой значений.
+   *
+   *  3. Сверяем выборки курсоров, в том числе с условием NOT IN,
+   *     с ожидаемыми и с результатом эквивалентной цепочки условий
+   *     fpta_node_eq, объединенных посредством fpta_node_or. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime4testing,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  { // create table
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("id", fptu_int64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("name", fptu_cstr,
+                                            fpta_index_none, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("ratio", fptu_fp64,
+                                            fpta_noindex_nullable, &def));
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "items", &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_name table, id, name, ratio;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "items"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &name, "name"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &ratio, "ratio"));
+
+  const int rows_count = 1000;
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &id));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &name));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &ratio));
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+  for (int i = 0; i < rows_count; ++i) {
+    ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &id, fpta_value_sint(i - 500)));
+    const std::string str = "n" + std::to_string(i % 50);
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &name, fpta_value_str(str)));
+    if (i % 3) {
+      ASSERT_EQ(FPTA_OK,
+                fpta_upsert_column(pt, &ratio, fpta_value_float(i / 4.0)));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  free(pt);
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+
+  auto select = [&](fpta_filter *filter) {
+    std::vector<int> rows;
+    fpta_cursor *cursor = nullptr;
+    int rc = fpta_cursor_open(txn, &id, fpta_value_begin(), fpta_value_end(),
+                              filter, fpta_ascending, &cursor);
+    if (rc == FPTA_NODATA)
+      return rows;
+    EXPECT_EQ(FPTA_OK, rc);
+    while (rc == FPTA_OK) {
+      fptu_ro row;
+      fpta_value value;
+      EXPECT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      EXPECT_EQ(FPTA_OK, fpta_get_column(row, &id, &value));
+      rows.push_back(int(value.sint) + 500);
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    return rows;
+  };
+
+  // id IN {...}, каждое седьмое значение из 3000 в разных представлениях
+  std::vector<fpta_value> values;
+  std::vector<int> expected, complement;
+  for (int i = -1000; i < 2000; ++i)
+    if (i % 7 == 0)
+      values.push_back((i % 2) ? fpta_value_sint(i)
+                               : (i >= 0) ? fpta_value_uint(unsigned(i))
+                                          : fpta_value_float(i));
+  values.push_back(fpta_value_uint(UINT64_MAX));
+  values.push_back(fpta_value_float(NAN));
+  values.push_back(fpta_value_cstr("-493"));
+  for (int i = 0; i < rows_count; ++i)
+    ((i - 500) % 7 ? complement : expected).push_back(i);
+
+  fpta_filter in, not_in;
+  EXPECT_EQ(FPTA_OK,
+            fpta_filter_in_init(&in, &id, values.data(), values.size()));
+  EXPECT_EQ(fpta_node_in, in.type);
+  not_in.type = fpta_node_not;
+  not_in.node_not = &in;
+  EXPECT_EQ(expected, select(&in));
+  EXPECT_EQ(complement, select(&not_in));
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+
+  // name IN {"n7", "n13", binary "n21", "n99"} и эквивалентная цепочка OR
+  const fpta_value names[] = {
+      fpta_value_cstr("n7"), fpta_value_cstr("n13"),
+      fpta_value_binary("n21", 3), fpta_value_cstr("n99"),
+      fpta_value_cstr("n7")};
+  fpta_filter eqs[5], ors[4];
+  for (unsigned i = 0; i < 5; ++i) {
+    eqs[i].type = fpta_node_eq;
+    eqs[i].node_cmp.left_id = &name;
+    eqs[i].node_cmp.right_value = names[i];
+    if (i) {
+      ors[i - 1].type = fpta_node_or;
+      ors[i - 1].node_or.a = (i > 1) ? &ors[i - 2] : &eqs[0];
+      ors[i - 1].node_or.b = &eqs[i];
+    }
+  }
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_init(&in, &name, names, 5));
+  expected = select(&in);
+  EXPECT_EQ(60u, expected.size());
+  EXPECT_EQ(select(&ors[3]), expected);
+  EXPECT_EQ(rows_count - 60, int(select(&not_in).size()));
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+
+  // ratio IN {0.25, 2, 5u, 4.5, -1}, строки без значения не входят
+  const fpta_value ratios[] = {fpta_value_float(0.25), fpta_value_sint(2),
+                               fpta_value_uint(5), fpta_value_float(4.5),
+                               fpta_value_sint(-1)};
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_init(&in, &ratio, ratios, 5));
+  EXPECT_EQ(std::vector<int>({1, 8, 20}), select(&in));
+  EXPECT_EQ(rows_count - 3, int(select(&not_in).size()));
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+
+  // NaN не равен ни одному значению, в том числе NaN в строке, которую
+  // можно сформировать только в обход fpta_upsert_column()
+  const fpta_value nans[] = {fpta_value_float(NAN), fpta_value_float(0.25),
+                             fpta_value_float(-NAN)};
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_init(&in, &ratio, nans, 1));
+  EXPECT_TRUE(select(&in).empty());
+  EXPECT_EQ(rows_count, int(select(&not_in).size()));
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_init(&in, &ratio, nans, 3));
+  EXPECT_EQ(std::vector<int>({1}), select(&in));
+  pt = fptu_alloc(1, 8);
+  ASSERT_NE(nullptr, pt);
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, ratio.column.num, NAN));
+  EXPECT_FALSE(fpta_filter_match(&in, fptu_take_noshrink(pt)));
+  EXPECT_TRUE(fpta_filter_match(&not_in, fptu_take_noshrink(pt)));
+  ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, ratio.column.num, 0.25));
+  EXPECT_TRUE(fpta_filter_match(&in, fptu_take_noshrink(pt)));
+  free(pt);
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+
+  // несравнимые и пустые множества заменяются ложным условием
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_init(&in, &name, ratios, 5));
+  EXPECT_TRUE(select(&in).empty());
+  EXPECT_EQ(rows_count, int(select(&not_in).size()));
+  EXPECT_EQ(fpta_node_in, in.type);
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_init(&in, &ratio, nullptr, 0));
+  EXPECT_TRUE(select(&in).empty());
+  EXPECT_EQ(FPTA_OK, fpta_filter_in_destroy(&in));
+
+  // недопустимые значения и аргументы
+  const fpta_value invalid[] = {fpta_value_sint(1), fpta_value_null()};
+  EXPECT_EQ(FPTA_EINVAL, fpta_filter_in_init(&in, &id, invalid, 2));
+  EXPECT_EQ(FPTA_EINVAL, fpta_filter_in_init(&in, &id, nullptr, 1));
+  EXPECT_EQ(FPTA_EINVAL, fpta_filter_in_init(nullptr, &id, invalid, 1));
+  EXPECT_EQ(FPTA_EINVAL, fpta_filter_in_destroy(&eqs[0]));
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&id);
+  fpta_name_destroy(&name);
+  fpta_name_destroy(&ratio);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Select, CountKeyFilter) {
+  /* Проверка подсчета строк по индексу с фильтром только по ключевой колонке.
+   *
+   * Сценарий:
+   *  1. Создаем таблицу с колонками id (первичный ключ), grp (вторичный
+   *     индекс с дубликатами) и twin (без индекса, равна grp), вставляем
+   *     несколько тысяч строк, чтобы индекс занимал больше одной страницы.
+   *
+   *  2. Для диапазонов и фильтров по колонке grp сверяем результат
+   *     fpta_cursor_count() с ожидаемым и с подсчетом при эквивалентном
+   *     фильтре по колонке twin, который требует чтения строк.
+   *
+   *  3. Проверяем, что при фильтре по ключу строки не читаются, т.е.
+   *     не выполняется поиск по первичному ключу. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime4testing,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  { // create table
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("id", fptu_int64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                           "grp", fptu_int64,
+                           fpta_secondary_withdups_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("twin", fptu_int64,
+                                            fpta_index_none, &def));
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "items", &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_name table, id, grp, twin;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "items"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &grp, "grp"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &twin, "twin"));
+
+  // 5000 строк, по 5 строк для каждого значения grp от 0 до 999
+  const int rows_count = 5000, groups = 1000;
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &id));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &grp));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &twin));
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+  for (int i = 0; i < rows_count; ++i) {
+    ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &id, fpta_value_sint(i)));
+    const fpta_value value = fpta_value_sint(i % groups);
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &grp, value));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &twin, value));
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  free(pt);
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+
+  auto count = [&](fpta_value from, fpta_value to, fpta_filter *filter,
+                   size_t &lookups) {
+    fpta_cursor *cursor = nullptr;
+    size_t result = 0;
+    EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &grp, from, to, filter,
+                                        fpta_unsorted_dont_fetch, &cursor));
+    EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &result, SIZE_MAX));
+    fpta_cursor_stat stat;
+    EXPECT_EQ(FPTA_OK, fpta_cursor_info(cursor, &stat));
+    lookups = stat.pk_lookups;
+    /* Подсчет учитывается как один результат независимо от способа. */
+    EXPECT_EQ(1u, stat.results);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    return result;
+  };
+
+  /* NOT (x >= 100 AND x < 200) OR x == 150, т.е. все группы кроме
+   * 100..199, но включая 150, а также условие x != 7 */
+  fpta_filter ge[2], lt[2], eq[2], ne[2], both[2], outside[2], any[2];
+  fpta_name *const columns[2] = {&grp, &twin};
+  for (unsigned i = 0; i < 2; ++i) {
+    ge[i].type = fpta_node_ge;
+    ge[i].node_cmp.left_id = columns[i];
+    ge[i].node_cmp.right_value = fpta_value_sint(100);
+    lt[i].type = fpta_node_lt;
+    lt[i].node_cmp.left_id = columns[i];
+    lt[i].node_cmp.right_value = fpta_value_sint(200);
+    eq[i].type = fpta_node_eq;
+    eq[i].node_cmp.left_id = columns[i];
+    eq[i].node_cmp.right_value = fpta_value_sint(150);
+    ne[i].type = fpta_node_ne;
+    ne[i].node_cmp.left_id = columns[i];
+    ne[i].node_cmp.right_value = fpta_value_sint(7);
+    both[i].type = fpta_node_and;
+    both[i].node_and.a = &ge[i];
+    both[i].node_and.b = &lt[i];
+    outside[i].type = fpta_node_not;
+    outside[i].node_not = &both[i];
+    any[i].type = fpta_node_or;
+    any[i].node_or.a = &outside[i];
+    any[i].node_or.b = &eq[i];
+  }
+
+  struct {
+    fpta_value from, to;
+    fpta_filter *filters;
+    size_t expected;
+  } const cases[] = {
+      {fpta_value_begin(), fpta_value_end(), nullptr, 5000},
+      {fpta_value_sint(10), fpta_value_sint(990), nullptr, 4900},
+      {fpta_value_sint(10), fpta_value_sint(30), nullptr, 100},
+      {fpta_value_begin(), fpta_value_end(), ne, 4995},
+      {fpta_value_begin(), fpta_value_end(), any, 4505},
+      {fpta_value_sint(50), fpta_value_sint(250), any, 505},
+      {fpta_value_sint(120), fpta_value_sint(180), any, 5},
+      {fpta_value_sint(7), fpta_value_epsilon(), ne, 0},
+  };
+
+  for (const auto &c : cases) {
+    SCOPED_TRACE("range " + std::to_string(c.from) + " .. " +
+                 std::to_string(c.to) + (c.filters ? ", filter" : ""));
+    size_t lookups = 42;
+    EXPECT_EQ(c.expected,
+              count(c.from, c.to, c.filters ? &c.filters[0] : nullptr,
+                    lookups));
+    EXPECT_EQ(0u, lookups);
+    if (c.filters) {
+      EXPECT_EQ(c.expected, count(c.from, c.to, &c.filters[1], lookups));
+      EXPECT_LT(0u, lookups);
+    }
+  }
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&id);
+  fpta_name_destroy(&grp);
+  fpta_name_destroy(&twin);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+static bool batch_counted_predicate(const fptu_ro *row, void *context,
+                                    void *arg) {
+  (void)row;
+  (void)arg;
+  *static_cast<size_t *>(context) += 1;
+  return true;
+}
+
+TEST(Select, FilterBatch) {
+  /* Проверка пакетной проверки фильтра (fpta_filter_match_batch).
+   *
+   * Сценарий:
+   *  1. Создаем таблицу с первичным ключом id и nullable-колонками
+   *     int32, uint64, fp32 и fp64, в которых часть значений отсутствует,
+   *     а в колонках с плавающей точкой часть значений NaN (такие строки
+   *     формируются в обход fpta_upsert_column()).
+   *
+   *  2. Для сравнений каждой колонки с числами разных типов, в том числе
+   *     с NaN, отрицательными и большими беззнаковыми значениями, а также
+   *     для их комбинаций посредством AND/OR/NOT сверяем битовую карту
+   *     с построчным результатом fpta_filter_match().
+   *
+   *  3. Проверяем, что предикат в составе фильтра вызывается для того же
+   *     количества строк, что и при построчной проверке, а выборка
+   *     fpta_apply_batch_visitor() и fpta_parallel_visit() совпадает
+   *     с построчной проверкой, в том числе для строк с NaN. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime4testing,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  { // create table
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("id", fptu_int64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("i32", fptu_int32,
+                                            fpta_noindex_nullable, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("u64", fptu_uint64,
+                                            fpta_noindex_nullable, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("f32", fptu_fp32,
+                                            fpta_noindex_nullable, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("f64", fptu_fp64,
+                                            fpta_noindex_nullable, &def));
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "numbers", &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_name table, id, i32, u64, f32, f64;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "numbers"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &i32, "i32"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &u64, "u64"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &f32, "f32"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &f64, "f64"));
+
+  /* количество строк не кратно 64 для проверки неполной порции */
+  const int rows_count = 1000;
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &id));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &i32));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &u64));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &f32));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &f64));
+  fptu_rw *pt = fptu_alloc(5, 64);
+  ASSERT_NE(nullptr, pt);
+  for (int i = 0; i < rows_count; ++i) {
+    ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+    ASSERT_EQ(FPTA_OK, fpta_upsert_column(pt, &id, fpta_value_sint(i)));
+    if (i % 5) {
+      ASSERT_EQ(FPTA_OK, fpta_upsert_column(
+                             pt, &i32, fpta_value_sint(i * 37 % 201 - 100)));
+    }
+    if (i % 7) {
+      ASSERT_EQ(FPTA_OK,
+                fpta_upsert_column(
+                    pt, &u64,
+                    fpta_value_uint(uint64_t(i) * UINT64_C(0x9E3779B97F4A7C15) %
+                                    UINT64_C(0xFFFFFFFFFFFFFF00))));
+    }
+    if (i % 6 == 5) {
+      ASSERT_EQ(FPTU_OK,
+                fptu_upsert_fp32(pt, f32.column.num, (i % 4) ? NAN : -NAN));
+    } else if (i % 6 != 2) {
+      ASSERT_EQ(FPTA_OK, fpta_upsert_column(
+                             pt, &f32, fpta_value_float(i % 89 / 2.0 - 20)));
+    }
+    if (i % 8 == 7) {
+      ASSERT_EQ(FPTU_OK,
+                fptu_upsert_fp64(pt, f64.column.num, (i % 3) ? NAN : -NAN));
+    } else if (i % 4 != 3) {
+      ASSERT_EQ(FPTA_OK, fpta_upsert_column(
+                             pt, &f64, fpta_value_float(i % 97 / 4.0 - 10)));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  free(pt);
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+
+  std::vector<fptu_ro> rows;
+  {
+    fpta_cursor *cursor = nullptr;
+    EXPECT_EQ(FPTA_OK,
+              fpta_cursor_open(txn, &id, fpta_value_begin(), fpta_value_end(),
+                               nullptr, fpta_ascending, &cursor));
+    int rc = FPTA_OK;
+    while (rc == FPTA_OK) {
+      fptu_ro row;
+      EXPECT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      rows.push_back(row);
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  }
+  ASSERT_EQ(size_t(rows_count), rows.size());
+
+  auto verify = [&](const fpta_filter *filter) {
+    std::vector<uint64_t> bitmap((rows.size() + 63) / 64, ~UINT64_C(0));
+    EXPECT_EQ(FPTA_OK, fpta_filter_match_batch(filter, rows.data(),
+                                               rows.size(), bitmap.data()));
+    size_t matched = 0;
+    for (size_t i = 0; i < bitmap.size() * 64; ++i) {
+      const bool bit = (bitmap[i / 64] >> (i % 64)) & 1;
+      const bool expected =
+          i < rows.size() && fpta_filter_match(filter, rows[i]);
+      EXPECT_EQ(expected, bit) << "row " << i;
+      matched += bit;
+    }
+    return matched;
+  };
+
+  const fpta_value values[] = {
+      fpta_value_sint(0),         fpta_value_sint(-42),
+      fpta_value_sint(17),        fpta_value_uint(3),
+      fpta_value_uint(UINT64_MAX), fpta_value_uint(UINT64_C(1) << 63),
+      fpta_value_float(-2.5),     fpta_value_float(0.25),
+      fpta_value_float(1e19),     fpta_value_float(NAN)};
+  const fpta_filter_bits kinds[] = {fpta_node_lt, fpta_node_gt, fpta_node_le,
+                                    fpta_node_ge, fpta_node_eq, fpta_node_ne};
+  fpta_name *const columns[] = {&i32, &u64, &f32, &f64};
+
+  std::vector<fpta_filter> leaves;
+  for (fpta_name *column : columns)
+    for (const fpta_value &value : values)
+      for (fpta_filter_bits kind : kinds) {
+        fpta_filter leaf;
+        leaf.type = kind;
+        leaf.node_cmp.left_id = column;
+        leaf.node_cmp.right_value = value;
+        leaves.push_back(leaf);
+      }
+
+  size_t nonempty = 0;
+  for (const fpta_filter &leaf : leaves) {
+    const size_t matched = verify(&leaf);
+    nonempty += matched > 0 && matched < rows.size();
+    fpta_filter inverse;
+    inverse.type = fpta_node_not;
+    inverse.node_not = const_cast<fpta_filter *>(&leaf);
+    verify(&inverse);
+  }
+  EXPECT_LT(leaves.size() / 2, nonempty);
+
+  // комбинации с повторным использованием собранных значений колонки
+  for (size_t i = 0; i < leaves.size(); i += 7) {
+    fpta_filter &a = leaves[i];
+    fpta_filter &b = leaves[(i * 13 + 5) % leaves.size()];
+    fpta_filter &c = leaves[(i * 29 + 11) % leaves.size()];
+    fpta_filter inverse, both, either;
+    inverse.type = fpta_node_not;
+    inverse.node_not = &c;
+    both.type = fpta_node_and;
+    both.node_and.a = &a;
+    both.node_and.b = &b;
+    either.type = fpta_node_or;
+    either.node_or.a = &both;
+    either.node_or.b = &inverse;
+    verify(&both);
+    verify(&either);
+  }
+
+  // предикат вызывается для тех же строк, что и при построчной проверке
+  fpta_filter range_lo, range_hi, range, counted, filter;
+  range_lo.type = fpta_node_ge;
+  range_lo.node_cmp.left_id = &i32;
+  range_lo.node_cmp.right_value = fpta_value_sint(-20);
+  range_hi.type = fpta_node_lt;
+  range_hi.node_cmp.left_id = &i32;
+  range_hi.node_cmp.right_value = fpta_value_float(50.5);
+  range.type = fpta_node_and;
+  range.node_and.a = &range_lo;
+  range.node_and.b = &range_hi;
+  size_t calls = 0;
+  counted.type = fpta_node_fnrow;
+  counted.node_fnrow.predicate = batch_counted_predicate;
+  counted.node_fnrow.context = &calls;
+  counted.node_fnrow.arg = nullptr;
+  filter.type = fpta_node_and;
+  filter.node_and.a = &range;
+  filter.node_and.b = &counted;
+  const size_t matched = verify(&filter);
+  EXPECT_LT(0u, matched);
+  EXPECT_EQ(matched * 2, calls);
+
+  // выборки fpta_apply_batch_visitor() и fpta_parallel_visit() с проверкой
+  // фильтра пакетами, в том числе "больше" для колонок со значениями NaN
+  struct collector {
+    fpta_name *id;
+    std::vector<int64_t> keys;
+    std::vector<int64_t> worker_keys;
+    static int visitor(const fptu_ro *rows, size_t count, void *context) {
+      collector *self = static_cast<collector *>(context);
+      for (size_t i = 0; i < count; ++i) {
+        fpta_value value;
+        EXPECT_EQ(FPTA_OK, fpta_get_column(rows[i], self->id, &value));
+        self->keys.push_back(value.sint);
+      }
+      return FPTA_OK;
+    }
+    static int parallel(const fptu_ro *rows, size_t count, void *context,
+                        unsigned worker) {
+      EXPECT_EQ(0u, worker);
+      collector *self = static_cast<collector *>(context);
+      for (size_t i = 0; i < count; ++i) {
+        fpta_value value;
+        if (fpta_get_column(rows[i], self->id, &value) != FPTA_OK)
+          return FPTA_EOOPS;
+        self->worker_keys.push_back(value.sint);
+      }
+      return FPTA_OK;
+    }
+  };
+  fpta_filter gt_f32, gt_f64;
+  gt_f32.type = gt_f64.type = fpta_node_gt;
+  gt_f32.node_cmp.left_id = &f32;
+  gt_f32.node_cmp.right_value = fpta_value_sint(-3);
+  gt_f64.node_cmp.left_id = &f64;
+  gt_f64.node_cmp.right_value = fpta_value_float(-1.5);
+  for (fpta_filter *checked : {&range, &gt_f32, &gt_f64}) {
+    std::vector<int64_t> expected;
+    for (size_t i = 0; i < rows.size(); ++i)
+      if (fpta_filter_match(checked, rows[i]))
+        expected.push_back(int64_t(i));
+    EXPECT_FALSE(expected.empty());
+
+    collector visited;
+    visited.id = &id;
+    EXPECT_EQ(FPTA_OK,
+              fpta_apply_batch_visitor(txn, &id, fpta_value_begin(),
+                                       fpta_value_end(), checked,
+                                       fpta_ascending, collector::visitor,
+                                       &visited));
+    EXPECT_EQ(expected, visited.keys);
+
+    /* без fpta_shared_snapshot партиции просматриваются вызывающим
+     * потоком, но посредством того же пакетного фильтра */
+    EXPECT_EQ(FPTA_OK,
+              fpta_parallel_visit(txn, &id, fpta_value_begin(),
+                                  fpta_value_end(), checked, 1,
+                                  collector::parallel, &visited));
+    std::sort(visited.worker_keys.begin(), visited.worker_keys.end());
+    EXPECT_EQ(expected, visited.worker_keys);
+  }
+
+  // недопустимые аргументы
+  uint64_t word = 0;
+  EXPECT_EQ(FPTA_EINVAL, fpta_filter_match_batch(&range, nullptr, 1, &word));
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_filter_match_batch(&range, rows.data(), 1, nullptr));
+  EXPECT_EQ(FPTA_OK, fpta_filter_match_batch(&range, nullptr, 0, nullptr));
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&id);
+  fpta_name_destroy(&i32);
+  fpta_name_destroy(&u64);
+  fpta_name_destroy(&f32);
+  fpta_name_destroy(&f64);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//----------------------------------------------------------------------------
+
 TEST_P(Select, Range) {
   /* Smoke-проверка жизнеспособности курсоров с ограничениями диапазона.
    *
@@ -1785,6 +2965,848 @@ TEST_P(Select, Filter) {
   }
 }
 
+TEST_P(Select, Batch) {
+  /* Проверка пакетной выборки строк.
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter.
+   *
+   *  2. Без фильтра и с фильтром по значению колонки выбираем строки
+   *     построчно посредством fpta_cursor_get() и fpta_cursor_move().
+   *
+   *  3. Повторяем выборку пакетами разного размера и сверяем строки
+   *     и значения ключей с построчной выборкой.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  fpta_filter filter;
+  filter.type = fpta_node_eq;
+  filter.node_cmp.left_id = &col_2;
+  filter.node_cmp.right_value = fpta_value_uint(3);
+
+  for (fpta_filter *const where : {(fpta_filter *)nullptr, &filter}) {
+    SCOPED_TRACE(where ? "with filter" : "without filter");
+
+    // построчная выборка
+    fpta_cursor *cursor;
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_open(txn_guard.get(), &col_1, fpta_value_begin(),
+                               fpta_value_end(), where, ordering, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+    std::vector<fptu_ro> rows;
+    std::vector<fpta_value> keys;
+    int rc = (ordering & fpta_dont_fetch) ? fpta_cursor_move(cursor, fpta_first)
+                                          : int(FPTA_OK);
+    for (; rc == FPTA_OK; rc = fpta_cursor_move(cursor, fpta_next)) {
+      fptu_ro row;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      rows.push_back(row);
+      fpta_value key;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_key(cursor, &key));
+      keys.push_back(key);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(where ? count_value_3 : 42u, rows.size());
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+
+    for (const size_t capacity : {1, 5, 42, 100}) {
+      SCOPED_TRACE("capacity " + std::to_string(capacity));
+      ASSERT_EQ(FPTA_OK,
+                fpta_cursor_open(txn_guard.get(), &col_1, fpta_value_begin(),
+                                 fpta_value_end(), where, ordering, &cursor));
+      ASSERT_NE(nullptr, cursor);
+      cursor_guard.reset(cursor);
+
+      size_t fetched = 42;
+      std::vector<fptu_ro> batch_rows(capacity);
+      std::vector<fpta_value> batch_keys(capacity);
+      EXPECT_EQ(FPTA_EINVAL, fpta_cursor_get_batch(cursor, batch_rows.data(),
+                                                   0, &fetched));
+      EXPECT_EQ(0u, fetched);
+      if (ordering & fpta_dont_fetch) {
+        EXPECT_EQ(FPTA_ECURSOR, fpta_cursor_get_batch(cursor, batch_rows.data(),
+                                                      capacity, &fetched));
+        ASSERT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_first));
+      }
+
+      size_t total = 0;
+      while ((rc = fpta_cursor_get_batch_ex(cursor, batch_rows.data(),
+                                            batch_keys.data(), capacity,
+                                            &fetched)) == FPTA_OK) {
+        ASSERT_LT(0u, fetched);
+        ASSERT_GE(capacity, fetched);
+        ASSERT_GE(rows.size(), total + fetched);
+        for (size_t i = 0; i < fetched; ++i) {
+          EXPECT_EQ(rows[total + i].sys.iov_base, batch_rows[i].sys.iov_base);
+          EXPECT_EQ(rows[total + i].sys.iov_len, batch_rows[i].sys.iov_len);
+          EXPECT_EQ(keys[total + i].type, batch_keys[i].type);
+          EXPECT_EQ(keys[total + i].sint, batch_keys[i].sint);
+        }
+        total += fetched;
+      }
+      EXPECT_EQ(FPTA_NODATA, rc);
+      EXPECT_EQ(0u, fetched);
+      EXPECT_EQ(rows.size(), total);
+      EXPECT_EQ(FPTA_NODATA, fpta_cursor_eof(cursor));
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+    }
+  }
+}
+
+TEST_P(Select, SeekNth) {
+  /* Проверка позиционирования курсора по порядковому номеру строки.
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter,
+   *     а для индексов с дубликатами добавляем несколько дубликатов.
+   *
+   *  2. Без фильтра и с фильтром собираем строки выборки пошаговым
+   *     движением курсора.
+   *
+   *  3. Для каждого номера (включая выходящие за пределы выборки)
+   *     устанавливаем курсор посредством fpta_cursor_seek_nth() и сверяем
+   *     строку в позиции курсора.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  if (!fpta_index_is_unique(index)) {
+    // добавляем дубликаты для значений 5 и 30
+    fpta_db *db = db_quard.get();
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn_guard.release(), false));
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    ASSERT_NE(nullptr, txn);
+    txn_guard.reset(txn);
+    ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_1));
+    ASSERT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_2));
+    fptu_rw *pt = fptu_alloc(3, 42);
+    ASSERT_NE(nullptr, pt);
+    for (unsigned i = 0; i < 7; ++i) {
+      ASSERT_EQ(FPTA_OK, fptu_clear(pt));
+      const int value = (i < 3) ? 5 : 30;
+      EXPECT_EQ(FPTA_OK,
+                fpta_upsert_column(pt, &col_1, fpta_value_sint(value)));
+      EXPECT_EQ(FPTA_OK,
+                fpta_upsert_column(pt, &col_2, fpta_value_sint(100 + i)));
+      ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+    }
+    free(pt);
+    ASSERT_EQ(FPTA_OK, fpta_transaction_commit(txn_guard.release()));
+    txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+    ASSERT_NE(nullptr, txn);
+    txn_guard.reset(txn);
+  }
+
+  fpta_filter filter;
+  filter.type = fpta_node_ne;
+  filter.node_cmp.left_id = &col_2;
+  filter.node_cmp.right_value = fpta_value_uint(3);
+
+  for (fpta_filter *const where : {(fpta_filter *)nullptr, &filter}) {
+    SCOPED_TRACE(where ? "with filter" : "without filter");
+
+    // пошаговая выборка
+    fpta_cursor *cursor;
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_open(txn_guard.get(), &col_1, fpta_value_begin(),
+                               fpta_value_end(), where, ordering, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+    std::vector<const void *> rows;
+    int rc = fpta_cursor_move(cursor, fpta_first);
+    for (; rc == FPTA_OK; rc = fpta_cursor_move(cursor, fpta_next)) {
+      fptu_ro row;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      rows.push_back(row.sys.iov_base);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(fpta_index_is_unique(index) ? 42u : 49u,
+              rows.size() + (where ? count_value_3 : 0));
+
+    for (size_t nth = 0; nth < rows.size() + 2; ++nth) {
+      SCOPED_TRACE("nth " + std::to_string(nth));
+      if (nth < rows.size()) {
+        ASSERT_EQ(FPTA_OK, fpta_cursor_seek_nth(cursor, nth));
+        fptu_ro row;
+        ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+        EXPECT_EQ(rows[nth], row.sys.iov_base);
+      } else {
+        EXPECT_EQ(FPTA_NODATA, fpta_cursor_seek_nth(cursor, nth));
+        EXPECT_EQ(FPTA_NODATA, fpta_cursor_eof(cursor));
+      }
+    }
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+  }
+}
+
+TEST_P(Select, CountRange) {
+  /* Проверка подсчета строк без фильтра посредством fpta_count_range().
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter,
+   *     значения колонки col_1 от 0 до 41.
+   *
+   *  2. Для полного, точечного и частичных диапазонов (включая покрывающие
+   *     больше половины индекса) сверяем fpta_count_range() с ожидаемым
+   *     количеством и с результатом fpta_cursor_count() с фильтром, который
+   *     подсчитывает строки пошаговым движением курсора.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped || ordering != fpta_unsorted)
+    return;
+
+  fpta_filter filter;
+  filter.type = fpta_node_ge;
+  filter.node_cmp.left_id = &col_2;
+  filter.node_cmp.right_value = fpta_value_uint(0);
+
+  struct {
+    fpta_value from, to;
+    size_t expected;
+    bool ordered_only;
+  } const cases[] = {
+      {fpta_value_begin(), fpta_value_end(), 42, false},
+      {fpta_value_sint(17), fpta_value_epsilon(), 1, false},
+      {fpta_value_epsilon(), fpta_value_end(), 1, false},
+      {fpta_value_sint(-1), fpta_value_epsilon(), 0, false},
+      {fpta_value_sint(-100), fpta_value_sint(21), 21, true},
+      {fpta_value_sint(10), fpta_value_sint(31), 21, true},
+      {fpta_value_sint(3), fpta_value_sint(42), 39, true},
+      {fpta_value_begin(), fpta_value_sint(40), 40, true},
+      {fpta_value_sint(1), fpta_value_end(), 41, true},
+      {fpta_value_sint(31), fpta_value_sint(10), 0, true},
+  };
+
+  for (const auto &c : cases) {
+    SCOPED_TRACE("range " + std::to_string(c.from) + " .. " +
+                 std::to_string(c.to));
+    size_t count = 42 * 42;
+    if (c.ordered_only && fpta_index_is_unordered(index)) {
+      EXPECT_EQ(FPTA_NO_INDEX, fpta_count_range(txn_guard.get(), &col_1,
+                                                c.from, c.to, &count));
+      continue;
+    }
+    EXPECT_EQ(FPTA_OK, fpta_count_range(txn_guard.get(), &col_1, c.from, c.to,
+                                        &count));
+    EXPECT_EQ(c.expected, count);
+
+    fpta_cursor *cursor;
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_open(txn_guard.get(), &col_1, c.from, c.to, &filter,
+                               fpta_unsorted_dont_fetch, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &count, INT_MAX));
+    EXPECT_EQ(c.expected, count);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+  }
+}
+
+TEST_P(Select, MultiRange) {
+  /* Проверка выборки из нескольких диапазонов посредством
+   * fpta_cursor_open_ranges().
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter,
+   *     значения колонки col_1 от 0 до 41.
+   *
+   *  2. Открываем курсор на неупорядоченный набор пересекающихся, смежных,
+   *     пустых и точечных диапазонов (для неупорядоченных индексов только
+   *     точечных), без фильтра и с фильтром.
+   *
+   *  3. Сверяем выборку в прямом и обратном направлении, пакетную выборку,
+   *     подсчет строк и позиционирование между диапазонами с ожидаемыми
+   *     значениями с учетом порядка сортировки курсора.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  const bool unordered = fpta_index_is_unordered(index);
+  std::vector<fpta_range> ranges;
+  std::vector<int> expected;
+  if (unordered) {
+    ranges = {{fpta_value_sint(10), fpta_value_epsilon()},
+              {fpta_value_sint(3), fpta_value_epsilon()},
+              {fpta_value_epsilon(), fpta_value_sint(41)},
+              {fpta_value_sint(3), fpta_value_epsilon()},
+              {fpta_value_sint(-1), fpta_value_epsilon()}};
+    expected = {3, 10, 41};
+
+    const fpta_range invalid[] = {{fpta_value_sint(3), fpta_value_epsilon()},
+                                  {fpta_value_sint(5), fpta_value_sint(7)}};
+    fpta_cursor *cursor = (fpta_cursor *)&cursor;
+    EXPECT_EQ(FPTA_NO_INDEX,
+              fpta_cursor_open_ranges(txn_guard.get(), &col_1, invalid, 2,
+                                      nullptr, ordering, &cursor));
+    EXPECT_EQ(nullptr, cursor);
+  } else {
+    ranges = {{fpta_value_sint(30), fpta_value_sint(35)},
+              {fpta_value_sint(10), fpta_value_epsilon()},
+              {fpta_value_sint(2), fpta_value_sint(5)},
+              {fpta_value_sint(33), fpta_value_sint(40)},
+              {fpta_value_epsilon(), fpta_value_sint(3)},
+              {fpta_value_sint(20), fpta_value_sint(20)},
+              {fpta_value_sint(17), fpta_value_sint(12)},
+              {fpta_value_sint(41), fpta_value_end()}};
+    expected = {2, 3, 4, 10};
+    for (int i = 30; i < 40; ++i)
+      expected.push_back(i);
+    expected.push_back(41);
+  }
+
+  const fpta_range empty[] = {{fpta_value_sint(-1), fpta_value_epsilon()},
+                              {fpta_value_sint(20), fpta_value_sint(20)}};
+  fpta_cursor *cursor = (fpta_cursor *)&cursor;
+  if (ordering & fpta_dont_fetch) {
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_open_ranges(txn_guard.get(), &col_1, empty, 2,
+                                      nullptr, ordering, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+    EXPECT_EQ(FPTA_NODATA, fpta_cursor_move(cursor, fpta_first));
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+  } else {
+    EXPECT_EQ(FPTA_NODATA,
+              fpta_cursor_open_ranges(txn_guard.get(), &col_1, empty, 2,
+                                      nullptr, ordering, &cursor));
+    EXPECT_EQ(nullptr, cursor);
+  }
+
+  fpta_filter filter;
+  filter.type = fpta_node_ne;
+  filter.node_cmp.left_id = &col_2;
+  filter.node_cmp.right_value = fpta_value_uint(3);
+
+  for (fpta_filter *const where : {(fpta_filter *)nullptr, &filter}) {
+    SCOPED_TRACE(where ? "with filter" : "without filter");
+    std::vector<int> expected_rows;
+    for (const int value : expected)
+      // значение col_2 равно 3 для кратных 5 значений col_1
+      if (!where || value % 5 != 0)
+        expected_rows.push_back(value);
+    if (fpta_cursor_is_descending(ordering))
+      std::reverse(expected_rows.begin(), expected_rows.end());
+
+    ASSERT_EQ(FPTA_OK, fpta_cursor_open_ranges(txn_guard.get(), &col_1,
+                                               ranges.data(), ranges.size(),
+                                               where, ordering, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+
+    std::vector<int> forward, backward;
+    int rc = fpta_cursor_move(cursor, fpta_first);
+    for (; rc == FPTA_OK; rc = fpta_cursor_move(cursor, fpta_next)) {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_1, &value));
+      forward.push_back(int(value.sint));
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    rc = fpta_cursor_move(cursor, fpta_last);
+    for (; rc == FPTA_OK; rc = fpta_cursor_move(cursor, fpta_prev)) {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_1, &value));
+      backward.insert(backward.begin(), int(value.sint));
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(forward, backward);
+    if (!fpta_cursor_is_ordered(ordering))
+      std::sort(forward.begin(), forward.end());
+    EXPECT_EQ(expected_rows, forward);
+
+    // пакетная выборка продолжается через границы диапазонов
+    std::vector<int> batched;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_first));
+    for (;;) {
+      fptu_ro rows[4];
+      size_t fetched = 0;
+      rc = fpta_cursor_get_batch(cursor, rows, 4, &fetched);
+      if (rc != FPTA_OK)
+        break;
+      for (size_t i = 0; i < fetched; ++i) {
+        fpta_value value;
+        ASSERT_EQ(FPTA_OK, fpta_get_column(rows[i], &col_1, &value));
+        batched.push_back(int(value.sint));
+      }
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    if (!fpta_cursor_is_ordered(ordering))
+      std::sort(batched.begin(), batched.end());
+    EXPECT_EQ(expected_rows, batched);
+
+    size_t count = 42 * 42;
+    EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &count, INT_MAX));
+    EXPECT_EQ(expected_rows.size(), count);
+
+    if (fpta_cursor_is_ordered(ordering)) {
+      // неточный поиск в промежутке между диапазонами
+      fpta_value key = fpta_value_sint(7);
+      ASSERT_EQ(FPTA_OK, fpta_cursor_locate(cursor, false, &key, nullptr));
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_1, &value));
+      EXPECT_EQ(fpta_cursor_is_descending(ordering) ? 4 : (where ? 31 : 10),
+                value.sint);
+    }
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+  }
+}
+
+TEST_P(Select, FilterPushdown) {
+  /* Проверка сужения диапазона курсора по условиям фильтра.
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter.
+   *
+   *  2. Открываем курсоры на весь диапазон (а также на часть диапазона)
+   *     с фильтрами, содержащими условия на ключевую колонку col_1, в том
+   *     числе в сочетании с условиями на col_2 и противоречивые.
+   *
+   *  3. Сверяем выборку с ожидаемой, а для упорядоченных индексов также
+   *     проверяем по статистике курсора, что просматривается только
+   *     суженный диапазон. Проверяем, что фильтр не изменяется.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  const bool ordered = fpta_index_is_ordered(index);
+  fpta_filter ge, gt, lt, le, eq, eq2, col2, and1, and2, and3;
+  ge.type = fpta_node_ge;
+  ge.node_cmp.left_id = &col_1;
+  ge.node_cmp.right_value = fpta_value_sint(10);
+  gt = ge;
+  gt.type = fpta_node_gt;
+  lt = ge;
+  lt.type = fpta_node_lt;
+  lt.node_cmp.right_value = fpta_value_sint(20);
+  le = lt;
+  le.type = fpta_node_le;
+  le.node_cmp.right_value = fpta_value_sint(12);
+  eq = ge;
+  eq.type = fpta_node_eq;
+  eq.node_cmp.right_value = fpta_value_sint(7);
+  eq2 = eq;
+  eq2.node_cmp.right_value = fpta_value_sint(8);
+  col2.type = fpta_node_eq;
+  col2.node_cmp.left_id = &col_2;
+  col2.node_cmp.right_value = fpta_value_sint(3);
+  and1.type = and2.type = and3.type = fpta_node_and;
+
+  struct probe {
+    fpta_value from, to;
+    fpta_filter *filter;
+    std::vector<int> expected;
+    bool bounded /* условия ограничивают диапазон с обеих сторон */;
+  };
+  auto check = [&](const probe &item) {
+    fpta_cursor *cursor = nullptr;
+    const int rc =
+        fpta_cursor_open(txn_guard.get(), &col_1, item.from, item.to,
+                         item.filter, ordering, &cursor);
+    if (item.expected.empty() && !(ordering & fpta_dont_fetch)) {
+      EXPECT_EQ(FPTA_NODATA, rc);
+      EXPECT_EQ(nullptr, cursor);
+      return;
+    }
+    ASSERT_EQ(FPTA_OK, rc);
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+
+    std::vector<int> rows;
+    int err = fpta_cursor_move(cursor, fpta_first);
+    while (err == FPTA_OK) {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_1, &value));
+      rows.push_back(int(value.sint));
+      err = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, err);
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(item.expected, rows);
+
+    if (ordered && item.bounded) {
+      fpta_cursor_stat stat;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_info(cursor, &stat));
+      /* Не более одного шага за пределы суженного диапазона на каждый
+       * переход в начало (при открытии и посредством fpta_first). */
+      EXPECT_GE(item.expected.size() + 4, stat.index_scans);
+    }
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+  };
+
+  // col_1 >= 10 AND col_1 < 20
+  and1.node_and.a = &ge;
+  and1.node_and.b = &lt;
+  check({fpta_value_begin(), fpta_value_end(), &and1,
+         {10, 11, 12, 13, 14, 15, 16, 17, 18, 19},
+         true});
+  EXPECT_EQ(fpta_node_ge, ge.type);
+  EXPECT_EQ(fpta_node_lt, lt.type);
+  EXPECT_EQ(&ge, and1.node_and.a);
+  EXPECT_EQ(&lt, and1.node_and.b);
+
+  // (col_1 > 10 AND col_1 <= 12) AND col_2 == 3
+  and1.node_and.a = &gt;
+  and1.node_and.b = &le;
+  and2.node_and.a = &and1;
+  and2.node_and.b = &col2;
+  // условие <= не сужает полуоткрытый диапазон
+  check({fpta_value_begin(), fpta_value_end(), &and1, {11, 12}, false});
+  check({fpta_value_begin(), fpta_value_end(), &and2, {}, false});
+
+  // col_1 == 7 AND col_2 == 0, в том числе для неупорядоченных индексов
+  and1.node_and.a = &col2;
+  and1.node_and.b = &eq;
+  col2.node_cmp.right_value = fpta_value_sint(0);
+  check({fpta_value_begin(), fpta_value_end(), &and1, {7}, true});
+  check({fpta_value_begin(), fpta_value_end(), &eq, {7}, true});
+
+  // противоречивые условия col_1 == 7 AND col_1 == 8
+  and1.node_and.a = &eq;
+  and1.node_and.b = &eq2;
+  check({fpta_value_begin(), fpta_value_end(), &and1, {}, true});
+
+  if (ordered) {
+    // пересечение с заданным диапазоном [15, 30) AND col_1 < 20
+    and1.node_and.a = &ge;
+    and1.node_and.b = &lt;
+    and3.node_and.a = &and1;
+    and3.node_and.b = &lt;
+    check({fpta_value_sint(15), fpta_value_sint(30), &and3,
+           {15, 16, 17, 18, 19},
+           true});
+    // col_1 == 7 вне диапазона [15, 30)
+    check({fpta_value_sint(15), fpta_value_sint(30), &eq, {}, true});
+  }
+}
+
+TEST_P(Select, FilterProgram) {
+  /* Проверка вычисления фильтров курсора посредством линейной программы.
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter.
+   *
+   *  2. Составляем фильтры с вложенными узлами NOT/OR/AND, предикатами
+   *     и сравнениями, в том числе с количеством условий больше умещающегося
+   *     внутри курсора.
+   *
+   *  3. Сверяем выборку курсора с результатом fpta_filter_match() для всех
+   *     строк таблицы.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  auto check = [&](fpta_filter *filter) {
+    fpta_cursor *cursor = nullptr;
+    int rc = fpta_cursor_open(txn_guard.get(), &col_1, fpta_value_begin(),
+                              fpta_value_end(), filter, ordering, &cursor);
+    std::vector<int> rows;
+    if (rc != FPTA_NODATA) {
+      ASSERT_EQ(FPTA_OK, rc);
+      ASSERT_NE(nullptr, cursor);
+      cursor_guard.reset(cursor);
+      rc = fpta_cursor_move(cursor, fpta_first);
+      while (rc == FPTA_OK) {
+        fptu_ro row;
+        fpta_value value;
+        ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+        ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_1, &value));
+        rows.push_back(int(value.sint));
+        rc = fpta_cursor_move(cursor, fpta_next);
+      }
+      EXPECT_EQ(FPTA_NODATA, rc);
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+    }
+    std::sort(rows.begin(), rows.end());
+
+    std::vector<int> expected;
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_open(txn_guard.get(), &col_1, fpta_value_begin(),
+                               fpta_value_end(), nullptr, ordering, &cursor));
+    cursor_guard.reset(cursor);
+    rc = fpta_cursor_move(cursor, fpta_first);
+    while (rc == FPTA_OK) {
+      fptu_ro row;
+      fpta_value value;
+      ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_1, &value));
+      if (fpta_filter_match(filter, row))
+        expected.push_back(int(value.sint));
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, rows);
+  };
+
+  fpta_filter eq3, lt10, ne0, gt2, ge1, le3, ne4, odd, row_true, row_false;
+  eq3.type = fpta_node_eq;
+  eq3.node_cmp.left_id = &col_2;
+  eq3.node_cmp.right_value = fpta_value_sint(3);
+  ne0 = eq3;
+  ne0.type = fpta_node_ne;
+  ne0.node_cmp.right_value = fpta_value_sint(0);
+  gt2 = eq3;
+  gt2.type = fpta_node_gt;
+  gt2.node_cmp.right_value = fpta_value_sint(2);
+  ge1 = eq3;
+  ge1.type = fpta_node_ge;
+  ge1.node_cmp.right_value = fpta_value_sint(1);
+  le3 = eq3;
+  le3.type = fpta_node_le;
+  ne4 = ne0;
+  ne4.node_cmp.right_value = fpta_value_sint(4);
+  lt10.type = fpta_node_lt;
+  lt10.node_cmp.left_id = &col_1;
+  lt10.node_cmp.right_value = fpta_value_sint(10);
+  odd.type = fpta_node_fncol;
+  odd.node_fncol.column_id = &col_1;
+  odd.node_fncol.arg = nullptr /* unused */;
+  odd.node_fncol.predicate = filter_col_predicate_odd;
+  row_true.type = row_false.type = fpta_node_fnrow;
+  row_true.node_fnrow.context = row_false.node_fnrow.context = nullptr;
+  row_true.node_fnrow.arg = row_false.node_fnrow.arg = nullptr;
+  row_true.node_fnrow.predicate = filter_row_predicate_true;
+  row_false.node_fnrow.predicate = filter_row_predicate_false;
+
+  fpta_filter not_lt10, not_and, not_or, or1, or2, or3, and1, and2, and3, and4,
+      and5, and6, and7, and8;
+  not_lt10.type = not_and.type = not_or.type = fpta_node_not;
+  or1.type = or2.type = or3.type = fpta_node_or;
+  and1.type = and2.type = and3.type = and4.type = and5.type = and6.type =
+      and7.type = and8.type = fpta_node_and;
+
+  // NOT (col_2 == 3 OR odd(col_1))
+  or1.node_or.a = &eq3;
+  or1.node_or.b = &odd;
+  not_or.node_not = &or1;
+  check(&not_or);
+
+  // (col_2 > 2 AND odd(col_1)) OR NOT (col_1 < 10)
+  and1.node_and.a = &gt2;
+  and1.node_and.b = &odd;
+  not_lt10.node_not = &lt10;
+  or2.node_or.a = &and1;
+  or2.node_or.b = &not_lt10;
+  check(&or2);
+
+  // NOT (col_2 >= 1 AND col_2 <= 3) OR row_false()
+  and2.node_and.a = &ge1;
+  and2.node_and.b = &le3;
+  not_and.node_not = &and2;
+  or3.node_or.a = &not_and;
+  or3.node_or.b = &row_false;
+  check(&or3);
+
+  // девять условий, программа не умещается внутри курсора:
+  // (col_2 == 3 OR NOT (col_1 < 10)) AND (col_2 > 2 AND odd(col_1))
+  // AND (col_2 != 0 AND col_2 >= 1) AND (col_2 <= 3 AND col_2 != 4)
+  // AND row_true()
+  or1.node_or.a = &eq3;
+  or1.node_or.b = &not_lt10;
+  and3.node_and.a = &ne0;
+  and3.node_and.b = &ge1;
+  and4.node_and.a = &le3;
+  and4.node_and.b = &ne4;
+  and5.node_and.a = &or1;
+  and5.node_and.b = &and1;
+  and6.node_and.a = &and3;
+  and6.node_and.b = &and4;
+  and7.node_and.a = &and5;
+  and7.node_and.b = &and6;
+  and8.node_and.a = &and7;
+  and8.node_and.b = &row_true;
+  check(&and8);
+  // и одиннадцать, с заменой row_true() на условия из предыдущей проверки
+  and8.node_and.b = &or3;
+  check(&and8);
+
+  // длинные цепочки: col_1 != 0 AND ... AND col_1 != 2999 с вложенностью
+  // слева, и col_1 == 0 OR ... OR col_1 == 2999 с вложенностью справа
+  const unsigned chain = 3000;
+  std::vector<fpta_filter> leaves(chain), nodes(chain - 1);
+  for (unsigned i = 0; i < chain; ++i) {
+    leaves[i].type = fpta_node_ne;
+    leaves[i].node_cmp.left_id = &col_1;
+    leaves[i].node_cmp.right_value = fpta_value_sint(i * 3);
+  }
+  for (unsigned i = 0; i + 1 < chain; ++i) {
+    nodes[i].type = fpta_node_and;
+    nodes[i].node_and.a = i ? &nodes[i - 1] : &leaves[0];
+    nodes[i].node_and.b = &leaves[i + 1];
+  }
+  check(&nodes.back());
+  for (unsigned i = 0; i < chain; ++i)
+    leaves[i].type = fpta_node_eq;
+  for (unsigned i = 0; i + 1 < chain; ++i) {
+    nodes[i].type = fpta_node_or;
+    nodes[i].node_or.a = &leaves[i];
+    nodes[i].node_or.b = (i + 2 < chain) ? &nodes[i + 1] : &leaves[i + 1];
+  }
+  check(&nodes.front());
+}
+
+TEST_P(Select, Readahead) {
+  /* Проверка управления упреждающим чтением.
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter.
+   *
+   *  2. Просматриваем все строки курсором в режиме по-умолчанию
+   *     и с fpta_readahead, сверяем количество строк и количество подсказок
+   *     упреждающего чтения в статистике курсора.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  fpta_cursor *cursor = nullptr;
+  for (const auto mode : {fpta_unsorted, fpta_readahead}) {
+    SCOPED_TRACE("readahead mode " + std::to_string(mode));
+    ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn_guard.get(), &col_1,
+                                        fpta_value_begin(), fpta_value_end(),
+                                        nullptr, ordering | mode, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    cursor_guard.reset(cursor);
+
+    size_t rows = 0;
+    int rc = fpta_cursor_move(cursor, fpta_first);
+    while (rc == FPTA_OK) {
+      ++rows;
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(42u, rows);
+
+    fpta_cursor_stat stat;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_info(cursor, &stat));
+    if (mode != fpta_readahead) {
+      /* По-умолчанию подсказки не выдаются. */
+      EXPECT_EQ(0u, stat.readaheads);
+    } else {
+#if !defined(_WIN32) && !defined(_WIN64)
+      /* Серии из 42 переходов достаточно для обнаружения просмотра. */
+      EXPECT_LE(1u, stat.readaheads);
+#endif
+      EXPECT_GT(rows, stat.readaheads);
+    }
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor_guard.release()));
+  }
+}
+
+static int collect_visitor(const fptu_ro *row, void *context, void *) {
+  static_cast<std::vector<fptu_ro> *>(context)->push_back(*row);
+  return FPTA_OK;
+}
+
+TEST_P(Select, Visit) {
+  /* Проверка просмотра выборки посредством fpta::visit().
+   *
+   * Сценарий:
+   *  1. Используем базу с одной таблицей из 42 строк, как в Select.Filter.
+   *
+   *  2. Без фильтра и с фильтром по значению колонки собираем строки
+   *     посредством fpta_apply_visitor().
+   *
+   *  3. Повторяем просмотр посредством fpta::visit() и сверяем строки,
+   *     а также проверяем прерывание просмотра функтором.
+   */
+  SCOPED_TRACE("index " + std::to_string(index) + ", ordering " +
+               std::to_string(ordering) +
+               (valid_ops ? ", (valid case)" : ", (invalid case)"));
+
+  if (!valid_ops || skipped)
+    return;
+
+  fpta_filter filter;
+  filter.type = fpta_node_eq;
+  filter.node_cmp.left_id = &col_2;
+  filter.node_cmp.right_value = fpta_value_uint(3);
+
+  for (fpta_filter *const where : {(fpta_filter *)nullptr, &filter}) {
+    SCOPED_TRACE(where ? "with filter" : "without filter");
+
+    std::vector<fptu_ro> rows;
+    size_t count = 0;
+    EXPECT_EQ(FPTA_NODATA,
+              fpta_apply_visitor(txn_guard.get(), &col_1, fpta_value_begin(),
+                                 fpta_value_end(), where, ordering, 0, 100,
+                                 nullptr, nullptr, &count, collect_visitor,
+                                 &rows, nullptr));
+    EXPECT_EQ(where ? count_value_3 : 42u, rows.size());
+    EXPECT_EQ(rows.size(), count);
+
+    size_t n = 0;
+    EXPECT_EQ(FPTA_OK,
+              fpta::visit(txn_guard.get(), &col_1, fpta_value_begin(),
+                          fpta_value_end(), where, ordering,
+                          [&](const fptu_ro &row) {
+                            EXPECT_GT(rows.size(), n);
+                            if (n < rows.size()) {
+                              EXPECT_EQ(rows[n].sys.iov_base, row.sys.iov_base);
+                              EXPECT_EQ(rows[n].sys.iov_len, row.sys.iov_len);
+                            }
+                            ++n;
+                            return FPTA_OK;
+                          }));
+    EXPECT_EQ(rows.size(), n);
+
+    // прерывание просмотра функтором
+    n = 0;
+    EXPECT_EQ(int(FPTA_DEADBEEF),
+              fpta::visit(txn_guard.get(), &col_1, fpta_value_begin(),
+                          fpta_value_end(), where, [&](const fptu_ro &) {
+                            return (++n < 2) ? FPTA_OK : FPTA_DEADBEEF;
+                          }));
+    EXPECT_EQ(2u, n);
+
+    // пустая выборка
+    n = 0;
+    EXPECT_EQ(FPTA_OK,
+              fpta::visit(txn_guard.get(), &col_1, fpta_value_sint(-1),
+                          fpta_value_sint(-1), where,
+                          [&](const fptu_ro &) { return ++n, FPTA_OK; }));
+    EXPECT_EQ(0u, n);
+  }
+}
+
 #ifdef INSTANTIATE_TEST_SUITE_P
 INSTANTIATE_TEST_SUITE_P(
     Combine, Select,
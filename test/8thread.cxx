@@ -16,6 +16,8 @@
  */
 
 #include "fpta_test.h"
+#include <atomic>
+#include <chrono>
 #include <functional> // for std::ref
 #include <string>
 
@@ -923,6 +925,656 @@ TEST(Threaded, AsyncSchemaChange) {
   ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
 }
 
+//------------------------------------------------------------------------------
+
+static void read_scaling_proc(fpta_db *db, std::atomic<bool> &start_flag,
+                              std::atomic<bool> &done_flag, size_t &counter) {
+  while (!start_flag)
+    std::this_thread::yield();
+  size_t count = 0;
+  while (!done_flag) {
+    for (int i = 0; i < 100; ++i) {
+      fpta_txn *txn = nullptr;
+      ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+      ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    }
+    count += 100;
+  }
+  counter = count;
+}
+
+TEST(Threaded, DISABLED_ReadScaling) {
+  /* Замер пропускной способности циклов begin/end для транзакций чтения
+   * в зависимости от количества потоков при изменяемой схеме, т.е. когда
+   * каждая транзакция регистрируется в счетчиках читателей схемы.
+   *
+   * Результат зависит от окружения и ничего не проверяет, поэтому тест
+   * выполняется только явно, посредством --gtest_also_run_disabled_tests. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  const unsigned limit =
+      std::max(8u, std::min(32u, std::thread::hardware_concurrency()));
+  for (unsigned threadNum = 1; threadNum <= limit; threadNum <<= 1) {
+    std::atomic<bool> start_flag(false), done_flag(false);
+    std::vector<size_t> counters(threadNum);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < threadNum; ++i)
+      threads.push_back(std::thread(read_scaling_proc, db, std::ref(start_flag),
+                                    std::ref(done_flag),
+                                    std::ref(counters[i])));
+
+    const auto start = std::chrono::steady_clock::now();
+    start_flag = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    done_flag = true;
+    for (auto &thread : threads)
+      thread.join();
+    const std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start;
+
+    size_t total = 0;
+    for (auto count : counters)
+      total += count;
+    std::cout << "[ BENCHMARK] read txn begin/end, " << threadNum
+              << " thread(s): " << unsigned(total / duration.count())
+              << " cycles/s" << std::endl;
+  }
+
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//------------------------------------------------------------------------------
+
+struct group_insert {
+  fpta_name table, pk;
+  uint64_t key;
+
+  group_insert() {
+    EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+  }
+  ~group_insert() {
+    fpta_name_destroy(&table);
+    fpta_name_destroy(&pk);
+  }
+
+  int operator()(fpta_txn *txn) {
+    int rc = fpta_name_refresh_couple(txn, &table, &pk);
+    if (rc != FPTA_OK)
+      return rc;
+    fptu_rw *row = fptu_alloc(1, 8);
+    if (!row)
+      return FPTA_ENOMEM;
+    rc = fpta_upsert_column(row, &pk, fpta_value_uint(key));
+    if (rc == FPTA_OK)
+      rc = fpta_insert_row(txn, &table, fptu_take_noshrink(row));
+    free(row);
+    return rc;
+  }
+
+  static int closure(fpta_txn *txn, void *ctx) {
+    return (*static_cast<group_insert *>(ctx))(txn);
+  }
+};
+
+static void group_commit_proc(fpta_db *db, unsigned thread_num, unsigned reps,
+                              bool grouped) {
+  group_insert insert;
+  for (unsigned i = 0; i < reps; ++i) {
+    insert.key = uint64_t(thread_num) << 32 | (i + 1);
+    if (grouped) {
+      ASSERT_EQ(FPTA_OK,
+                fpta_submit_write(db, group_insert::closure, &insert));
+      if (i % 16 == 0) {
+        /* Дубликат ключа откатывается без влияния на остальных. */
+        insert.key = 0;
+        ASSERT_EQ(FPTA_KEYEXIST,
+                  fpta_submit_write(db, group_insert::closure, &insert));
+      }
+    } else {
+      fpta_txn *txn = nullptr;
+      ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+      ASSERT_EQ(FPTA_OK, insert(txn));
+      ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    }
+  }
+}
+
+TEST(Threaded, GroupCommit) {
+  /* Сравнение пропускной способности пишущих транзакций в режиме fpta_sync
+   * при индивидуальной и групповой фиксации. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  const unsigned threadNum = 8, reps = 100;
+  for (const bool grouped : {false, true}) {
+    if (REMOVE_FILE(testdb_name) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+    if (REMOVE_FILE(testdb_name_lck) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+
+    fpta_db *db = nullptr;
+    ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_sync,
+                                    fpta_regime_default, 1, true, &db));
+    ASSERT_NE(nullptr, db);
+
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("pk", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+    group_insert insert;
+    insert.key = 0;
+    ASSERT_EQ(FPTA_OK, fpta_submit_write(db, group_insert::closure, &insert));
+    EXPECT_EQ(FPTA_EINVAL, fpta_submit_write(db, nullptr, nullptr));
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < threadNum; ++i)
+      threads.push_back(
+          std::thread(group_commit_proc, db, i + 1, reps, grouped));
+    for (auto &thread : threads)
+      thread.join();
+    const std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "[ BENCHMARK] " << (grouped ? "group" : "individual")
+              << " commit, " << threadNum << " threads: "
+              << unsigned(threadNum * reps / duration.count()) << " TPS"
+              << std::endl;
+
+    size_t row_count = 0;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &insert.table));
+    EXPECT_EQ(FPTA_OK,
+              fpta_table_info(txn, &insert.table, &row_count, nullptr));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    EXPECT_EQ(threadNum * reps + 1, row_count);
+
+    EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  }
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//------------------------------------------------------------------------------
+
+static uint64_t durable_insert(fpta_db *db, uint64_t key) {
+  group_insert insert;
+  insert.key = key;
+  fpta_txn *txn = nullptr;
+  uint64_t version = 0;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  EXPECT_EQ(FPTA_OK, insert(txn));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_versions(txn, &version, nullptr));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  return version;
+}
+
+static bool durable_wait_background(fpta_db *db, uint64_t version) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::chrono::steady_clock::now() < deadline) {
+    uint64_t durable = 0;
+    EXPECT_EQ(FPTA_OK, fpta_db_durable_version(db, &durable));
+    if (durable >= version)
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+TEST(Threaded, BackgroundFlush) {
+  /* Проверка фонового формирования сильных точек фиксации по периоду
+   * и по объему, а также ожидания устойчивости заданной версии. */
+  const bool skipped = GTEST_IS_EXECUTION_TIMEOUT();
+  if (skipped)
+    return;
+
+  for (unsigned variant = 0; variant < 3; ++variant) {
+    if (REMOVE_FILE(testdb_name) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+    if (REMOVE_FILE(testdb_name_lck) != 0) {
+      ASSERT_EQ(ENOENT, errno);
+    }
+
+    fpta_db_creation_params_ex_t creation_params;
+    memset(&creation_params, 0, sizeof(creation_params));
+    creation_params.base.params_size = sizeof(creation_params);
+    creation_params.base.file_mode = 0644;
+    creation_params.base.size_lower = creation_params.base.size_upper = 1 << 20;
+    creation_params.base.pagesize = -1;
+    creation_params.base.growth_step = -1;
+    creation_params.base.shrink_threshold = -1;
+    switch (variant) {
+    case 0 /* без фонового потока */:
+      break;
+    case 1 /* по периоду */:
+      creation_params.flush_period_ms = 20;
+      break;
+    case 2 /* по объему */:
+      creation_params.flush_threshold = 1;
+      break;
+    }
+    SCOPED_TRACE("variant " + std::to_string(variant));
+
+    fpta_db *db = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_db_create_or_open(nullptr, testdb_name, fpta_lazy,
+                                              fpta_regime_default, true, &db,
+                                              &creation_params.base));
+    ASSERT_NE(nullptr, db);
+
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("pk", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+    uint64_t version = durable_insert(db, 1);
+    uint64_t durable = ~uint64_t(0);
+    EXPECT_EQ(FPTA_OK, fpta_db_durable_version(db, &durable));
+    EXPECT_GE(version, durable);
+    EXPECT_EQ(FPTA_EINVAL, fpta_db_wait_durable(db, version + 1));
+
+    EXPECT_EQ(FPTA_OK, fpta_db_wait_durable(db, version));
+    EXPECT_EQ(FPTA_OK, fpta_db_durable_version(db, &durable));
+    EXPECT_LE(version, durable);
+
+    version = durable_insert(db, 2);
+    if (variant > 0)
+      EXPECT_TRUE(durable_wait_background(db, version));
+    else {
+      EXPECT_EQ(FPTA_OK, fpta_db_durable_version(db, &durable));
+      EXPECT_GT(version, durable);
+    }
+
+    /* Конкурентные ожидания устойчивости разных версий. */
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < 4; ++i)
+      threads.push_back(std::thread([db, i]() {
+        for (unsigned n = 0; n < 25; ++n) {
+          const uint64_t v = durable_insert(db, 100 + i * 100 + n);
+          EXPECT_EQ(FPTA_OK, fpta_db_wait_durable(db, v));
+        }
+      }));
+    for (auto &thread : threads)
+      thread.join();
+
+    EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  }
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//------------------------------------------------------------------------------
+
+static void shared_scan_proc(fpta_txn *txn, uint64_t from, uint64_t to,
+                             size_t &count) {
+  /* Собственные идентификаторы и курсор у каждого потока. */
+  fpta_name table, pk;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &pk, fpta_value_uint(from),
+                                      fpta_value_uint(to), nullptr,
+                                      fpta_unsorted_dont_fetch, &cursor));
+  if (cursor) {
+    EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &count, INT_MAX));
+    EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  }
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&pk);
+}
+
+TEST(Threaded, SharedSnapshot) {
+  /* Сценарий:
+   *  - одна транзакция чтения разделяется между несколькими потоками,
+   *    каждый из которых просматривает свой диапазон ключей;
+   *  - параллельно пишущая транзакция добавляет строки, которые
+   *    не должны быть видны в разделяемом снимке. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  EXPECT_EQ(FPTA_EFLAG, fpta_transaction_share(txn));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_shared_snapshot,
+                                  32, true, &db));
+  ASSERT_NE(nullptr, db);
+  fpta_db_stat_t stat;
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_NE(0, stat.regime_flags & fpta_shared_snapshot);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  const unsigned threadNum = 4, per_thread = 1000;
+  {
+    group_insert insert;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    for (unsigned i = 0; i < threadNum * per_thread; ++i) {
+      insert.key = i * 2;
+      ASSERT_EQ(FPTA_OK, insert(txn));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_share(txn));
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_park(txn));
+  EXPECT_EQ(FPTA_EPERM, fpta_transaction_restart(txn));
+
+  /* Заполняем пропуски между ключами, пока потоки читают снимок. */
+  std::thread writer([db]() {
+    group_insert insert;
+    for (unsigned i = 0; i < threadNum * per_thread; i += 7) {
+      fpta_txn *wtxn = nullptr;
+      ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &wtxn));
+      insert.key = i * 2 + 1;
+      const int rc = insert(wtxn);
+      EXPECT_EQ(FPTA_OK, rc);
+      ASSERT_EQ(FPTA_OK, fpta_transaction_end(wtxn, rc != FPTA_OK));
+    }
+  });
+
+  std::vector<size_t> counters(threadNum);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < threadNum; ++i)
+    threads.push_back(std::thread(
+        shared_scan_proc, txn, uint64_t(i) * per_thread * 2,
+        uint64_t(i + 1) * per_thread * 2, std::ref(counters[i])));
+  for (auto &thread : threads)
+    thread.join();
+  writer.join();
+
+  for (auto count : counters)
+    EXPECT_EQ(per_thread, count);
+
+  /* Транзакция может быть завершена в любом потоке. */
+  std::thread ender(
+      [txn]() { EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false)); });
+  ender.join();
+
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+struct parallel_collector {
+  fpta_name *pk;
+  int stop_after /* результат функтора после первого пакета */;
+  std::vector<std::vector<uint64_t>> keys /* по номеру потока */;
+
+  static int visitor(const fptu_ro *rows, size_t count, void *context,
+                     unsigned worker) {
+    parallel_collector *self = static_cast<parallel_collector *>(context);
+    EXPECT_GT(self->keys.size(), worker);
+    for (size_t i = 0; i < count; ++i) {
+      fpta_value value;
+      EXPECT_EQ(FPTA_OK, fpta_get_column(rows[i], self->pk, &value));
+      self->keys[worker].push_back(value.uint);
+    }
+    return self->stop_after;
+  }
+
+  std::vector<uint64_t> merge() const {
+    std::vector<uint64_t> all;
+    for (const auto &part : keys)
+      all.insert(all.end(), part.begin(), part.end());
+    std::sort(all.begin(), all.end());
+    return all;
+  }
+};
+
+TEST(Threaded, ParallelVisit) {
+  /* Сценарий:
+   *  - создаем таблицу и заполняем её строками;
+   *  - просматриваем всю таблицу, диапазон с фильтром и точечный диапазон
+   *    посредством fpta_parallel_visit() и проверяем, что каждая строка
+   *    передана функтору ровно один раз;
+   *  - проверяем прерывание просмотра функтором. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_shared_snapshot,
+                                  32, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  const unsigned threadNum = 4, rows = 20000;
+  {
+    group_insert insert;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    for (unsigned i = 0; i < rows; ++i) {
+      insert.key = i;
+      ASSERT_EQ(FPTA_OK, insert(txn));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_name table, pk;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &pk, "pk"));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &pk));
+
+  parallel_collector collector;
+  collector.pk = &pk;
+  collector.stop_after = FPTA_OK;
+  collector.keys.resize(threadNum);
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_parallel_visit(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                                nullptr, 0, parallel_collector::visitor,
+                                &collector));
+
+  /* Вся таблица. */
+  ASSERT_EQ(FPTA_OK,
+            fpta_parallel_visit(txn, &pk, fpta_value_begin(), fpta_value_end(),
+                                nullptr, threadNum, parallel_collector::visitor,
+                                &collector));
+  std::vector<uint64_t> all = collector.merge();
+  ASSERT_EQ(rows, all.size());
+  for (unsigned i = 0; i < rows; ++i)
+    ASSERT_EQ(i, all[i]);
+
+  /* Диапазон с фильтром. */
+  fpta_filter filter;
+  filter.type = fpta_node_lt;
+  filter.node_cmp.left_id = &pk;
+  filter.node_cmp.right_value = fpta_value_uint(12000);
+  collector.keys.assign(threadNum, std::vector<uint64_t>());
+  ASSERT_EQ(FPTA_OK,
+            fpta_parallel_visit(txn, &pk, fpta_value_uint(1000),
+                                fpta_value_uint(15000), &filter, threadNum,
+                                parallel_collector::visitor, &collector));
+  all = collector.merge();
+  ASSERT_EQ(11000u, all.size());
+  for (unsigned i = 0; i < all.size(); ++i)
+    ASSERT_EQ(i + 1000, all[i]);
+
+  /* Точечный диапазон не делится и просматривается вызывающим потоком. */
+  collector.keys.assign(threadNum, std::vector<uint64_t>());
+  ASSERT_EQ(FPTA_OK,
+            fpta_parallel_visit(txn, &pk, fpta_value_uint(42),
+                                fpta_value_epsilon(), nullptr, threadNum,
+                                parallel_collector::visitor, &collector));
+  EXPECT_EQ(std::vector<uint64_t>(1, 42), collector.keys[0]);
+  EXPECT_EQ(std::vector<uint64_t>(1, 42), collector.merge());
+
+  /* Прерывание функтором. */
+  collector.keys.assign(threadNum, std::vector<uint64_t>());
+  collector.stop_after = 42;
+  EXPECT_EQ(42, fpta_parallel_visit(txn, &pk, fpta_value_begin(),
+                                    fpta_value_end(), nullptr, threadNum,
+                                    parallel_collector::visitor, &collector));
+  EXPECT_GT(rows, collector.merge().size());
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&pk);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Threaded, Prewarm) {
+  /* Сценарий:
+   *  - создаем таблицу и заполняем её строками;
+   *  - прогреваем все таблицы без ограничения бюджета и проверяем,
+   *    что обработан весь запланированный объем;
+   *  - прогреваем заданную таблицу с ограничением бюджета;
+   *  - прерываем прогрев, в том числе закрытием БД. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  32, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  {
+    group_insert insert;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    for (unsigned i = 0; i < 20000; ++i) {
+      insert.key = i;
+      ASSERT_EQ(FPTA_OK, insert(txn));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+
+  fpta_prewarm_info info;
+  EXPECT_EQ(FPTA_NODATA, fpta_db_prewarm_info(db, &info));
+  EXPECT_EQ(FPTA_NODATA, fpta_db_prewarm_stop(db, false));
+  EXPECT_EQ(FPTA_EFLAG, fpta_db_prewarm(db, nullptr, 0, fpta_prewarm_rows, 0));
+
+  /* Все таблицы, без ограничения бюджета. */
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm(db, nullptr, 0,
+                                     fpta_prewarm_default | fpta_prewarm_rows,
+                                     0));
+  EXPECT_EQ(FPTA_OK, fpta_db_prewarm_stop(db, false));
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm_info(db, &info));
+  EXPECT_FALSE(info.running);
+  EXPECT_EQ(FPTA_OK, info.error);
+  EXPECT_EQ(1u, info.planned_trees);
+  EXPECT_EQ(1u, info.warmed_trees);
+  EXPECT_LT(0u, info.planned_bytes);
+  EXPECT_EQ(info.planned_bytes, info.warmed_bytes);
+  const size_t total_bytes = info.planned_bytes;
+
+  /* Заданная таблица, бюджет на четверть объема. */
+  fpta_name table;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  fpta_name *const tables[] = {&table};
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm(db, tables, 1, fpta_prewarm_primary,
+                                     total_bytes / 4));
+  EXPECT_EQ(FPTA_OK, fpta_db_prewarm_stop(db, false));
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm_info(db, &info));
+  EXPECT_EQ(FPTA_OK, info.error);
+  EXPECT_EQ(total_bytes / 4, info.planned_bytes);
+  EXPECT_EQ(info.planned_bytes, info.warmed_bytes);
+
+  /* Вторичных индексов нет, прогревать нечего. */
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm(db, tables, 1, fpta_prewarm_secondary, 0));
+  EXPECT_EQ(FPTA_OK, fpta_db_prewarm_stop(db, false));
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm_info(db, &info));
+  EXPECT_EQ(0u, info.planned_trees);
+  EXPECT_EQ(0u, info.planned_bytes);
+  fpta_name_destroy(&table);
+
+  /* Прерывание прогрева. */
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm(db, nullptr, 0, fpta_prewarm_default, 0));
+  const int rc = fpta_db_prewarm_stop(db, true);
+  EXPECT_TRUE(rc == FPTA_OK || rc == FPTA_TXN_CANCELLED);
+
+  /* Закрытие БД прерывает прогрев. */
+  ASSERT_EQ(FPTA_OK, fpta_db_prewarm(db, nullptr, 0, fpta_prewarm_default, 0));
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
 //------------------------------------------------------------------------------
 #else
 TEST(ReadMe, CXX_STD_Threads_NotAvailadble) {}